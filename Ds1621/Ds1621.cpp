@@ -11,21 +11,22 @@
  *--------------------------------------------------------
  */
 
-#include <wiringPiI2C.h>
 #include <exception>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include "Ds1621.h"
+#include "../I2cBus/I2cProfiler.h"
 
 //---------------------------------------------------
 /**
   * Constructor
+  * @param bus is the I2C bus the device is connected to
   * @param szAddres is the I2C addres of the device
 */
 //---------------------------------------------------
-Ds1621::Ds1621(unsigned char szAddres){
+Ds1621::Ds1621(I2cBus& bus, unsigned char szAddres){
+    m_pBus = &bus;
     m_szAddres = szAddres;
     m_isDeviceInitialized = false;
 }
@@ -45,9 +46,9 @@ Ds1621::~Ds1621(){
 */
 //---------------------------------------------------
 void Ds1621::init(){
+    M_I2C_PROFILE_SCOPE("Ds1621::init")
     // Setup the device
-    m_nDeviceFD = wiringPiI2CSetup (m_szAddres) ;
-    if( -1 != m_nDeviceFD){
+    if(true == m_pBus->isDeviceUp()){
         try{
             setConfig(getConfig());
             m_isDeviceInitialized = true;
@@ -65,6 +66,7 @@ void Ds1621::init(){
 */
 //---------------------------------------------------
 float Ds1621::getLRTemp(){
+    M_I2C_PROFILE_SCOPE("Ds1621::getLRTemp")
     int nTemp;
 
     // Sanity check
@@ -72,7 +74,7 @@ float Ds1621::getLRTemp(){
 
     // Start convert
     startStopConvert(false);
-    nTemp = (signed int)wiringPiI2CReadReg16(m_nDeviceFD,K_DS1621_READ_TEMP);
+    nTemp = (signed int)m_pBus->readRegister16(m_szAddres,K_DS1621_READ_TEMP);
     // Format temperature
     return formatTemp(nTemp);
 }
@@ -85,6 +87,7 @@ float Ds1621::getLRTemp(){
 */
 //---------------------------------------------------
 float Ds1621::getHRTemp(){
+    M_I2C_PROFILE_SCOPE("Ds1621::getHRTemp")
     signed char szTemp;
     unsigned char szConfig = getConfig();
     signed char szCountRemain;
@@ -109,9 +112,9 @@ float Ds1621::getHRTemp(){
     // Wait end of conversion
     waitEndOfConversion();
 
-    szTemp          = (signed char)wiringPiI2CReadReg8(m_nDeviceFD,K_DS1621_READ_TEMP);
-    szCountRemain   = (signed char)wiringPiI2CReadReg16(m_nDeviceFD,K_DS1621_READ_COUNTER);
-    szCountPerC     = (signed char)wiringPiI2CReadReg16(m_nDeviceFD,K_DS1621_READ_SLOPE);
+    szTemp          = (signed char)m_pBus->readRegister8(m_szAddres,K_DS1621_READ_TEMP);
+    szCountRemain   = (signed char)m_pBus->readRegister16(m_szAddres,K_DS1621_READ_COUNTER);
+    szCountPerC     = (signed char)m_pBus->readRegister16(m_szAddres,K_DS1621_READ_SLOPE);
 
     // From DS1621 DataSheet
     // Temperature = TempRead - 0.25 + ((szCountPerC - szCountRemain) / szCountPerC)
@@ -145,6 +148,7 @@ float Ds1621::getHRTemp(){
 */
 //---------------------------------------------------
 bool Ds1621::isTHF(void){
+    M_I2C_PROFILE_SCOPE("Ds1621::isTHF")
     // Sanity check
     M_B_DS1621_IS_DEVICE_UP
 
@@ -161,6 +165,7 @@ bool Ds1621::isTHF(void){
 */
 //---------------------------------------------------
 bool Ds1621::isTLF(void){
+    M_I2C_PROFILE_SCOPE("Ds1621::isTLF")
     // Sanity check
     M_B_DS1621_IS_DEVICE_UP
 
@@ -177,6 +182,7 @@ bool Ds1621::isTLF(void){
 */
 //---------------------------------------------------
 bool Ds1621::isOneShot(void){
+    M_I2C_PROFILE_SCOPE("Ds1621::isOneShot")
     // Sanity check
     M_B_DS1621_IS_DEVICE_UP
 
@@ -195,6 +201,7 @@ bool Ds1621::isOneShot(void){
 */
 //---------------------------------------------------
 float Ds1621::setThresholdTemp(float fTemp,bool isLow){
+    M_I2C_PROFILE_SCOPE("Ds1621::setThresholdTemp")
     unsigned char szCmd = K_DS1621_ACCES_TH;
     signed int nTemp;
 
@@ -238,6 +245,7 @@ float Ds1621::setThresholdTemp(float fTemp,bool isLow){
 */
 //---------------------------------------------------
 float Ds1621::getThresholdTemp(bool isLow){
+    M_I2C_PROFILE_SCOPE("Ds1621::getThresholdTemp")
     signed int nTemp;
     unsigned char szCmd = K_DS1621_ACCES_TH;
 
@@ -247,7 +255,7 @@ float Ds1621::getThresholdTemp(bool isLow){
     if(true == isLow){
         szCmd = K_DS1621_ACCES_TL;
     }
-    nTemp = (signed int)wiringPiI2CReadReg16(m_nDeviceFD,szCmd);
+    nTemp = (signed int)m_pBus->readRegister16(m_szAddres,szCmd);
     // Format temperature
     return formatTemp(nTemp);
 }
@@ -260,6 +268,7 @@ float Ds1621::getThresholdTemp(bool isLow){
 */
 //---------------------------------------------------
 bool Ds1621::displayConfig(){
+    M_I2C_PROFILE_SCOPE("Ds1621::displayConfig")
     float fThresholdHigh, fThresholdLow;
     unsigned char szConfig = getConfig();
 
@@ -350,7 +359,7 @@ unsigned char Ds1621::getConfig(void){
     // receipt of the Start Convert T protocol. If 1SHOT is “0”, the DS1621 will continuously perform
     // temperature conversions. This bit is nonvolatile.
 
-    szConfig = (unsigned char)wiringPiI2CReadReg8(m_nDeviceFD,K_DS1621_ACCES_CONFIG);
+    szConfig = (unsigned char)m_pBus->readRegister8(m_szAddres,K_DS1621_ACCES_CONFIG);
     return szConfig;
 }
 
@@ -366,7 +375,7 @@ void Ds1621::waitEndOfConversion(void){
     do {
        // Get Config register and test bit DONE
        szConfig = getConfig();
-       usleep(400);
+       m_pBus->delay(400);
     }while((szConfig & K_DS1621_DONE_CONFIG) != K_DS1621_DONE_CONFIG);
 }
 
@@ -421,11 +430,7 @@ float Ds1621::formatTemp(signed int nTemp){
 */
 //---------------------------------------------------
 void Ds1621::writei2c(unsigned char szData){
-    int nRes;
-    nRes = wiringPiI2CWrite(m_nDeviceFD,szData);
-    if(0 != nRes){
-        throw std::runtime_error("[Error] i2c write error");
-    }
+    m_pBus->write(m_szAddres,szData);
 }
 
 //---------------------------------------------------
@@ -438,11 +443,7 @@ void Ds1621::writei2c(unsigned char szData){
 */
 //---------------------------------------------------
 void Ds1621::writeRegister8bitsi2c(unsigned char szRegister, unsigned char szData){
-    int nRes;
-    nRes = wiringPiI2CWriteReg8(m_nDeviceFD,szRegister,szData);
-    if(0 != nRes){
-        throw std::runtime_error("[Error] i2c 8 bits register write error");
-    }
+    m_pBus->writeRegister8(m_szAddres,szRegister,szData);
 }
 
 //---------------------------------------------------
@@ -455,11 +456,7 @@ void Ds1621::writeRegister8bitsi2c(unsigned char szRegister, unsigned char szDat
 */
 //---------------------------------------------------
 void Ds1621::writeRegister16bitsi2c(unsigned char szRegister, int nData){
-    int nRes;
-    nRes = wiringPiI2CWriteReg16(m_nDeviceFD,szRegister,nData);
-    if(0 != nRes){
-        throw std::runtime_error("[Error] i2c 16 bits register write error");
-    }
+    m_pBus->writeRegister16(m_szAddres,szRegister,(unsigned int)nData);
 }
 
 //---------------------------------------------------
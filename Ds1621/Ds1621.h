@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include "../I2cBus/I2cBus.h"
+
 // Commands
 const unsigned char K_DS1621_START_CONVERT      = 0xEE;
 const unsigned char K_DS1621_STOP_CONVERT       = 0x22;
@@ -42,10 +44,11 @@ class Ds1621{
         //---------------------------------------------------
         /**
           * Constructor
+          * @param bus is the I2C bus the device is connected to
           * @param szAddres is the I2C addres of the device
         */
         //---------------------------------------------------
-        Ds1621(unsigned char szAddres);
+        Ds1621(I2cBus& bus, unsigned char szAddres);
 
         //---------------------------------------------------
         /**
@@ -160,8 +163,8 @@ class Ds1621{
         // I2C Addres of the device
         unsigned char m_szAddres;
 
-        // File descriptor of the device
-        int m_nDeviceFD;
+        // I2C bus of the device
+        I2cBus* m_pBus;
 
         //---------------------------------------------------
         /**
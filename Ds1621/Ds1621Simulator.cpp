@@ -0,0 +1,420 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: Ds1621Simulator.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <math.h>
+#include <string.h>
+#include "Ds1621Simulator.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  *
+  * The sensor powers on idle, in continuous mode, with a constant
+  * temperature of K_DS1621_SIM_DEFAULT_TEMP
+*/
+//---------------------------------------------------
+Ds1621Simulator::Ds1621Simulator(){
+    setTemperature(K_DS1621_SIM_DEFAULT_TEMP);
+    m_szConfig          = K_DS1621_DONE_CONFIG;
+    m_nTemp             = 0;
+    // TH and TL come from the E2 memory, the thermostat never trips with these ones
+    m_nTh               = (signed int)(K_DS1621_SIM_MAX_TEMP * 2);
+    m_nTl               = (signed int)(K_DS1621_SIM_MIN_TEMP * 2);
+    m_szCountRemain     = 0;
+    m_isThermostatOn    = false;
+    m_isConverting      = false;
+    m_nConversionEnd    = 0;
+    m_nSampleTime       = 0;
+    m_isSampleRead      = false;
+    m_nEepromUntil      = 0;
+    m_szCommand         = 0;
+    m_nIndex            = 0;
+    m_szMsb             = 0;
+    resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+Ds1621Simulator::~Ds1621Simulator(){
+}
+
+//---------------------------------------------------
+/**
+  * setTemperature : make the temperature constant
+  *
+  * @param fTemp is the temperature in C
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::setTemperature(float fTemp){
+    m_nNbPoints = 0;
+    m_nPeriod   = 0;
+    addPoint(0, fTemp);
+}
+
+//---------------------------------------------------
+/**
+  * addPoint : add a point to the temperature waveform
+  *
+  * @param nTime is the virtual time in ns, after the one of the previous point
+  * @param fTemp is the temperature in C
+  *
+  * The temperature is linear between two points and holds after the last one
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::addPoint(unsigned long long nTime, float fTemp){
+    if(m_nNbPoints >= K_DS1621_SIM_MAX_POINTS){
+        throw std::runtime_error("[Error] too many points in the waveform");
+    }
+    if((0 != m_nNbPoints) && (nTime <= m_nPointTime[m_nNbPoints - 1])){
+        throw std::invalid_argument("[Error] addPoint time must increase");
+    }
+    m_nPointTime[m_nNbPoints]   = nTime;
+    m_fPointTemp[m_nNbPoints]   = fTemp;
+    m_nNbPoints++;
+}
+
+//---------------------------------------------------
+/**
+  * setPeriod : repeat the temperature waveform
+  *
+  * @param nPeriod is the period in ns, after the time of the last point, 0 to hold the last point
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::setPeriod(unsigned long long nPeriod){
+    if((0 != nPeriod) && (nPeriod <= m_nPointTime[m_nNbPoints - 1])){
+        throw std::invalid_argument("[Error] setPeriod must be after the last point");
+    }
+    m_nPeriod = nPeriod;
+}
+
+//---------------------------------------------------
+/**
+  * getTemperature : temperature of the waveform
+  *
+  * @param nTime is the virtual time in ns
+  * @return the temperature in C
+*/
+//---------------------------------------------------
+float
+Ds1621Simulator::getTemperature(unsigned long long nTime){
+    unsigned int nPoint;
+    unsigned long long nNextTime;
+    float fNextTemp;
+
+    if(0 != m_nPeriod){
+        nTime %= m_nPeriod;
+    }
+    if(nTime <= m_nPointTime[0]){
+        return m_fPointTemp[0];
+    }
+    for(nPoint = 1; (nPoint < m_nNbPoints) && (m_nPointTime[nPoint] <= nTime); nPoint++){
+    }
+    if(nPoint < m_nNbPoints){
+        nNextTime   = m_nPointTime[nPoint];
+        fNextTemp   = m_fPointTemp[nPoint];
+    }else if(0 != m_nPeriod){
+        // The last point goes back to the first one of the next period
+        nNextTime   = m_nPeriod + m_nPointTime[0];
+        fNextTemp   = m_fPointTemp[0];
+    }else{
+        return m_fPointTemp[m_nNbPoints - 1];
+    }
+    nPoint--;
+    return m_fPointTemp[nPoint] + (fNextTemp - m_fPointTemp[nPoint])
+           * (float)(nTime - m_nPointTime[nPoint]) / (float)(nNextTime - m_nPointTime[nPoint]);
+}
+
+//---------------------------------------------------
+/**
+  * resetStats : set the counters to 0
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::resetStats(){
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//---------------------------------------------------
+/**
+  * start : the sensor is addressed by a START or a repeated START
+  *
+  * @param isRead if true, the master will read
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::start(bool, unsigned long long nTime){
+    update(nTime);
+    // A read goes on with the command of the previous write
+    m_nIndex = 0;
+}
+
+//---------------------------------------------------
+/**
+  * writeByte : the sensor receives a command or a data
+  *
+  * @param szData is the received byte
+  * @param nTime is the virtual time in ns of the acknowledge
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::writeByte(unsigned char szData, unsigned long long nTime){
+    unsigned int nIndex = m_nIndex++;
+
+    update(nTime);
+    if(0 == nIndex){
+        m_szCommand = szData;
+        switch(m_szCommand){
+            case K_DS1621_START_CONVERT:
+                if(false == m_isConverting){
+                    m_isConverting      = true;
+                    m_nConversionEnd    = nTime + K_DS1621_SIM_CONVERSION_TIME;
+                    m_szConfig         &= ~K_DS1621_DONE_CONFIG;
+                }
+                break;
+            case K_DS1621_STOP_CONVERT:
+                if(true == m_isConverting){
+                    m_isConverting      = false;
+                    m_szConfig         |= K_DS1621_DONE_CONFIG;
+                    m_stats.nAbortedConversions++;
+                }
+                break;
+            case K_DS1621_READ_TEMP:
+            case K_DS1621_READ_COUNTER:
+            case K_DS1621_READ_SLOPE:
+            case K_DS1621_ACCES_CONFIG:
+            case K_DS1621_ACCES_TH:
+            case K_DS1621_ACCES_TL:
+                break;
+            default:
+                m_stats.nUnknownCommands++;
+                break;
+        }
+        return;
+    }
+    switch(m_szCommand){
+        case K_DS1621_ACCES_CONFIG:
+            if(1 == nIndex){
+                writeConfig(szData, nTime);
+            }
+            break;
+        case K_DS1621_ACCES_TH:
+        case K_DS1621_ACCES_TL:
+            // MSB then LSB, the register is written with the LSB
+            if(1 == nIndex){
+                m_szMsb = szData;
+            }else if(2 == nIndex){
+                writeThreshold((K_DS1621_ACCES_TH == m_szCommand) ? &m_nTh : &m_nTl, szData, nTime);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readByte : the sensor sends a byte of the register of the last command
+  *
+  * @param nTime is the virtual time in ns of the first bit
+  * @return the sent byte
+  *
+*/
+//---------------------------------------------------
+unsigned char
+Ds1621Simulator::readByte(unsigned long long nTime){
+    unsigned int nIndex = m_nIndex++;
+
+    update(nTime);
+    switch(m_szCommand){
+        case K_DS1621_ACCES_CONFIG:
+            if(nTime < m_nEepromUntil){
+                return m_szConfig | K_DS1621_NVB_CONFIG;
+            }
+            return m_szConfig;
+        case K_DS1621_READ_TEMP:
+            if(0 == nIndex){
+                m_stats.nTempReads++;
+                m_stats.nSampleAge += nTime - m_nSampleTime;
+                if(true == m_isSampleRead){
+                    m_stats.nStaleReads++;
+                }
+                m_isSampleRead = true;
+            }
+            return readTemperature(m_nTemp, nIndex);
+        case K_DS1621_ACCES_TH:
+            return readTemperature(m_nTh, nIndex);
+        case K_DS1621_ACCES_TL:
+            return readTemperature(m_nTl, nIndex);
+        case K_DS1621_READ_COUNTER:
+            return (0 == nIndex) ? m_szCountRemain : 0;
+        case K_DS1621_READ_SLOPE:
+            return (0 == nIndex) ? K_DS1621_SIM_COUNT_PER_C : 0;
+        default:
+            return 0xFF;
+    }
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * update : end the conversions done at a time
+  *
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::update(unsigned long long nTime){
+    while((true == m_isConverting) && (m_nConversionEnd <= nTime)){
+        convert(m_nConversionEnd);
+        if(0 != (m_szConfig & K_DS1621_1SHOT_CONFIG)){
+            // DONE is only seen in one shot mode, a continuous conversion is always in progress
+            m_isConverting  = false;
+            m_szConfig     |= K_DS1621_DONE_CONFIG;
+        }else{
+            m_nConversionEnd += K_DS1621_SIM_CONVERSION_TIME;
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * convert : load the registers with a sample of the waveform
+  *
+  * @param nTime is the virtual time in ns of the end of the conversion
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::convert(unsigned long long nTime){
+    float fTemp = getTemperature(nTime);
+    signed int nRead;
+
+    if(fTemp < K_DS1621_SIM_MIN_TEMP){
+        fTemp = K_DS1621_SIM_MIN_TEMP;
+    }
+    if(fTemp > K_DS1621_SIM_MAX_TEMP){
+        fTemp = K_DS1621_SIM_MAX_TEMP;
+    }
+    // 0.5 C resolution
+    m_nTemp = (signed int)floor(fTemp * 2.0 + 0.5);
+    // From DS1621 DataSheet
+    // Temperature = TempRead - 0.25 + ((CountPerC - CountRemain) / CountPerC)
+    // TempRead is the register without its 0.5 bit
+    nRead = m_nTemp >> 1;
+    m_szCountRemain = (unsigned char)floor(K_DS1621_SIM_COUNT_PER_C * (1.0 - (fTemp + 0.25 - nRead)) + 0.5);
+
+    // The flags stay set until the master clears them
+    if(m_nTemp >= m_nTh){
+        m_szConfig         |= K_DS1621_THF_CONFIG;
+        m_isThermostatOn    = true;
+    }
+    if(m_nTemp <= m_nTl){
+        m_szConfig         |= K_DS1621_TLF_CONFIG;
+        m_isThermostatOn    = false;
+    }
+    m_nSampleTime   = nTime;
+    m_isSampleRead  = false;
+    m_stats.nConversions++;
+}
+
+//---------------------------------------------------
+/**
+  * writeConfig : the master writes the configuration
+  *
+  * @param szConfig is the written value
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::writeConfig(unsigned char szConfig, unsigned long long nTime){
+    unsigned char szNonVolatile = K_DS1621_POL_CONFIG | K_DS1621_1SHOT_CONFIG;
+
+    // THF and TLF are only cleared, DONE and NVB are read only
+    m_szConfig &= szConfig | ~(K_DS1621_THF_CONFIG | K_DS1621_TLF_CONFIG);
+    if((szConfig & szNonVolatile) != (m_szConfig & szNonVolatile)){
+        startEeprom(nTime);
+        m_szConfig = (m_szConfig & ~szNonVolatile) | (szConfig & szNonVolatile);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writeThreshold : the master writes TH or TL
+  *
+  * @param pThreshold is the register
+  * @param szLsb is the second written byte, the MSB is in m_szMsb
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::writeThreshold(signed int* pThreshold, unsigned char szLsb, unsigned long long nTime){
+    startEeprom(nTime);
+    *pThreshold = ((signed int)(signed char)m_szMsb << 1) | ((0 != (szLsb & 0x80)) ? 1 : 0);
+}
+
+//---------------------------------------------------
+/**
+  * startEeprom : start a copy to the E2 memory
+  *
+  * @param nTime is the virtual time in ns
+  *
+  * The write is still done when NVB is set so that the drivers go on,
+  * it is counted as a violation
+*/
+//---------------------------------------------------
+void
+Ds1621Simulator::startEeprom(unsigned long long nTime){
+    if(nTime < m_nEepromUntil){
+        m_stats.nEepromViolations++;
+    }
+    m_nEepromUntil = nTime + K_DS1621_SIM_EEPROM_TIME;
+    m_stats.nEepromWrites++;
+}
+
+//---------------------------------------------------
+/**
+  * readTemperature : byte of a temperature register
+  *
+  * @param nTemp is the temperature in half degrees
+  * @param nIndex is 0 for the MSB, 1 for the LSB
+  * @return the byte, 9 bits two's complement
+*/
+//---------------------------------------------------
+unsigned char
+Ds1621Simulator::readTemperature(signed int nTemp, unsigned int nIndex){
+    if(0 == nIndex){
+        return (unsigned char)(nTemp >> 1);
+    }
+    if(1 == nIndex){
+        return (0 != (nTemp & 1)) ? 0x80 : 0;
+    }
+    return 0xFF;
+}
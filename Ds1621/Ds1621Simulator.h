@@ -0,0 +1,272 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: Ds1621Simulator.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "../I2cBus/SimulatedBus.h"
+#include "Ds1621.h"
+
+// Time of a temperature conversion, in ns
+const unsigned int  K_DS1621_SIM_CONVERSION_TIME    = 750000000;
+// Time of a copy to the E2 memory, NVB is set meanwhile, in ns
+const unsigned int  K_DS1621_SIM_EEPROM_TIME        = 10000000;
+// Value of the slope accumulator, counts per degree
+const unsigned char K_DS1621_SIM_COUNT_PER_C        = 16;
+// Range of the sensor
+const float         K_DS1621_SIM_MIN_TEMP           = -55.0;
+const float         K_DS1621_SIM_MAX_TEMP           = 125.0;
+const float         K_DS1621_SIM_DEFAULT_TEMP       = 25.0;
+// Points of a temperature waveform
+const unsigned int  K_DS1621_SIM_MAX_POINTS         = 64;
+
+// Protocol events seen by the sensor
+struct Ds1621SimStats{
+    unsigned long long nConversions;
+    // Conversions stopped by STOP_CONVERT before their end
+    unsigned long long nAbortedConversions;
+    unsigned long long nTempReads;
+    // Temperature reads giving the same conversion as the previous read
+    unsigned long long nStaleReads;
+    // Sum of the ages of the read temperatures, from the end of their conversion, in ns
+    unsigned long long nSampleAge;
+    unsigned long long nEepromWrites;
+    // Writes to TH, TL, POL or 1SHOT while NVB was set, a real sensor may lose them
+    unsigned long long nEepromViolations;
+    unsigned long long nUnknownCommands;
+};
+
+class Ds1621Simulator : public I2cSimDevice{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          *
+          * The sensor powers on idle, in continuous mode, with a constant
+          * temperature of K_DS1621_SIM_DEFAULT_TEMP
+        */
+        //---------------------------------------------------
+        Ds1621Simulator();
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~Ds1621Simulator();
+
+        //---------------------------------------------------
+        /**
+          * setTemperature : make the temperature constant
+          *
+          * @param fTemp is the temperature in C
+          *
+        */
+        //---------------------------------------------------
+        void setTemperature(float fTemp);
+
+        //---------------------------------------------------
+        /**
+          * addPoint : add a point to the temperature waveform
+          *
+          * @param nTime is the virtual time in ns, after the one of the previous point
+          * @param fTemp is the temperature in C
+          *
+          * The temperature is linear between two points and holds after the last one
+        */
+        //---------------------------------------------------
+        void addPoint(unsigned long long nTime, float fTemp);
+
+        //---------------------------------------------------
+        /**
+          * setPeriod : repeat the temperature waveform
+          *
+          * @param nPeriod is the period in ns, after the time of the last point, 0 to hold the last point
+          *
+        */
+        //---------------------------------------------------
+        void setPeriod(unsigned long long nPeriod);
+
+        //---------------------------------------------------
+        /**
+          * getTemperature : temperature of the waveform
+          *
+          * @param nTime is the virtual time in ns
+          * @return the temperature in C
+        */
+        //---------------------------------------------------
+        float getTemperature(unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * getSampleTime :
+          *
+          * @return the virtual time in ns of the end of the last conversion
+        */
+        //---------------------------------------------------
+        inline unsigned long long getSampleTime(){ return m_nSampleTime;}
+
+        //---------------------------------------------------
+        /**
+          * isToutHigh :
+          *
+          * @return true if the thermostat output is high, POL applied
+        */
+        //---------------------------------------------------
+        inline bool isToutHigh(){ return (m_isThermostatOn == (0 != (m_szConfig & K_DS1621_POL_CONFIG)));}
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the protocol events seen by the sensor
+        */
+        //---------------------------------------------------
+        inline const Ds1621SimStats& getStats(){ return m_stats;}
+
+        //---------------------------------------------------
+        /**
+          * resetStats : set the counters to 0
+          *
+        */
+        //---------------------------------------------------
+        void resetStats();
+
+        //---------------------------------------------------
+        /**
+          * start : the sensor is addressed by a START or a repeated START
+          *
+          * @param isRead if true, the master will read
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void start(bool isRead, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * writeByte : the sensor receives a command or a data
+          *
+          * @param szData is the received byte
+          * @param nTime is the virtual time in ns of the acknowledge
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeByte(unsigned char szData, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * readByte : the sensor sends a byte of the register of the last command
+          *
+          * @param nTime is the virtual time in ns of the first bit
+          * @return the sent byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readByte(unsigned long long nTime);
+
+    private:
+        // Temperature waveform
+        unsigned long long m_nPointTime[K_DS1621_SIM_MAX_POINTS];
+        float m_fPointTemp[K_DS1621_SIM_MAX_POINTS];
+        unsigned int m_nNbPoints;
+        unsigned long long m_nPeriod;
+
+        // Registers, the temperatures are in half degrees
+        unsigned char m_szConfig;
+        signed int m_nTemp;
+        signed int m_nTh;
+        signed int m_nTl;
+        unsigned char m_szCountRemain;
+        bool m_isThermostatOn;
+
+        // Conversion
+        bool m_isConverting;
+        unsigned long long m_nConversionEnd;
+        unsigned long long m_nSampleTime;
+        bool m_isSampleRead;
+        unsigned long long m_nEepromUntil;
+
+        // Current transfer
+        unsigned char m_szCommand;
+        unsigned int m_nIndex;
+        unsigned char m_szMsb;
+
+        // Counters
+        Ds1621SimStats m_stats;
+
+        //---------------------------------------------------
+        /**
+          * update : end the conversions done at a time
+          *
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        void update(unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * convert : load the registers with a sample of the waveform
+          *
+          * @param nTime is the virtual time in ns of the end of the conversion
+          *
+        */
+        //---------------------------------------------------
+        void convert(unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * writeConfig : the master writes the configuration
+          *
+          * @param szConfig is the written value
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        void writeConfig(unsigned char szConfig, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * writeThreshold : the master writes TH or TL
+          *
+          * @param pThreshold is the register
+          * @param szLsb is the second written byte, the MSB is in m_szMsb
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        void writeThreshold(signed int* pThreshold, unsigned char szLsb, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * startEeprom : start a copy to the E2 memory
+          *
+          * @param nTime is the virtual time in ns
+          *
+          * The write is still done when NVB is set so that the drivers go on,
+          * it is counted as a violation
+        */
+        //---------------------------------------------------
+        void startEeprom(unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * readTemperature : byte of a temperature register
+          *
+          * @param nTemp is the temperature in half degrees
+          * @param nIndex is 0 for the MSB, 1 for the LSB
+          * @return the byte, 9 bits two's complement
+        */
+        //---------------------------------------------------
+        unsigned char readTemperature(signed int nTemp, unsigned int nIndex);
+};
@@ -0,0 +1,119 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cBus.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include "I2cBus.h"
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+I2cBus::~I2cBus(){
+}
+
+//---------------------------------------------------
+/**
+  * writeBlock : write several bytes to a device in one message
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write
+  * @param nLength is the number of bytes
+  * @note a PCF8574 latches each byte, default sends one write per byte
+  *
+*/
+//---------------------------------------------------
+void
+I2cBus::writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength){
+    unsigned int nI;
+
+    for(nI = 0; nI < nLength; nI++){
+        write(szAddres, pData[nI]);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * beginTransaction : start to group the transfers
+  *
+  * @note a bus may send the grouped transfers at once, default does nothing
+  *
+*/
+//---------------------------------------------------
+void
+I2cBus::beginTransaction(){
+}
+
+//---------------------------------------------------
+/**
+  * endTransaction : send the grouped transfers
+  *
+*/
+//---------------------------------------------------
+void
+I2cBus::endTransaction(){
+}
+
+//---------------------------------------------------
+/**
+  * abortTransaction : leave a transaction without sending
+  *
+  * @note the transfers already sent are not undone, the caller must assume a partial delivery
+  *
+*/
+//---------------------------------------------------
+void
+I2cBus::abortTransaction(){
+}
+
+//---------------------------------------------------
+/**
+  * delay : wait between two transfers
+  *
+  * @param nMicroSeconds is the time to wait
+  *
+*/
+//---------------------------------------------------
+void
+I2cBus::delay(unsigned int nMicroSeconds){
+    usleep(nMicroSeconds);
+}
+
+//---------------------------------------------------
+/**
+  * getTime : get the time of the bus
+  *
+  * @return a monotonic time in nanoseconds
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+I2cBus::getTime(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//---------------------------------------------------
+/**
+  * getIoctlCount : get the number of syscalls done on the adapter
+  *
+  * @return the number of syscalls since the bus was created, 0 if not known
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+I2cBus::getIoctlCount(){
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cBus.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+class I2cBus{
+    public:
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~I2cBus();
+
+        //---------------------------------------------------
+        /**
+          * init : Init the bus
+          *
+        */
+        //---------------------------------------------------
+        virtual void init() = 0;
+
+        //---------------------------------------------------
+        /**
+          * isDeviceUp :
+          *
+          * @return true if the bus was initialized
+        */
+        //---------------------------------------------------
+        virtual bool isDeviceUp() = 0;
+
+        //---------------------------------------------------
+        /**
+          * write : write a byte to a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void write(unsigned char szAddres, unsigned char szData) = 0;
+
+        //---------------------------------------------------
+        /**
+          * read : read a byte from a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char read(unsigned char szAddres) = 0;
+
+        //---------------------------------------------------
+        /**
+          * writeRegister8 : write 8 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData) = 0;
+
+        //---------------------------------------------------
+        /**
+          * writeRegister16 : write 16 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param nData is the data to write, low byte is sent first
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData) = 0;
+
+        //---------------------------------------------------
+        /**
+          * readRegister8 : read 8 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readRegister8(unsigned char szAddres, unsigned char szRegister) = 0;
+
+        //---------------------------------------------------
+        /**
+          * readRegister16 : read 16 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data, the first received byte is the low byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned int readRegister16(unsigned char szAddres, unsigned char szRegister) = 0;
+
+        //---------------------------------------------------
+        /**
+          * writeBlock : write several bytes to a device in one message
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write
+          * @param nLength is the number of bytes
+          * @note a PCF8574 latches each byte, default sends one write per byte
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * beginTransaction : start to group the transfers
+          *
+          * @note a bus may send the grouped transfers at once, default does nothing
+          *
+        */
+        //---------------------------------------------------
+        virtual void beginTransaction();
+
+        //---------------------------------------------------
+        /**
+          * endTransaction : send the grouped transfers
+          *
+        */
+        //---------------------------------------------------
+        virtual void endTransaction();
+
+        //---------------------------------------------------
+        /**
+          * abortTransaction : leave a transaction without sending
+          *
+          * @note the transfers already sent are not undone, the caller must assume a partial delivery
+          *
+        */
+        //---------------------------------------------------
+        virtual void abortTransaction();
+
+        //---------------------------------------------------
+        /**
+          * delay : wait between two transfers
+          *
+          * @param nMicroSeconds is the time to wait
+          *
+        */
+        //---------------------------------------------------
+        virtual void delay(unsigned int nMicroSeconds);
+
+        //---------------------------------------------------
+        /**
+          * getTime : get the time of the bus
+          *
+          * @return a monotonic time in nanoseconds
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getTime();
+
+        //---------------------------------------------------
+        /**
+          * getIoctlCount : get the number of syscalls done on the adapter
+          *
+          * @return the number of syscalls since the bus was created, 0 if not known
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getIoctlCount();
+};
+
+//---------------------------------------------------
+/**
+  * I2cTransaction : group the transfers of a scope
+  *
+  * @note the transfers are grouped where the bus allows it, a read or a full
+  *       queue sends the pending ones before commit(); when the scope is left
+  *       by an exception, the transfers not yet sent are dropped, so the
+  *       devices may have received a part of them
+*/
+//---------------------------------------------------
+class I2cTransaction{
+    public:
+        I2cTransaction(I2cBus* pBus){
+            m_pBus = pBus;
+            m_pBus->beginTransaction();
+        }
+        ~I2cTransaction(){
+            if(NULL != m_pBus){
+                m_pBus->abortTransaction();
+            }
+        }
+        void commit(){
+            I2cBus* pBus = m_pBus;
+            m_pBus = NULL;
+            if(NULL != pBus){
+                pBus->endTransaction();
+            }
+        }
+    private:
+        I2cBus* m_pBus;
+};
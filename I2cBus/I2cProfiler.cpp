@@ -0,0 +1,282 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cProfiler.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <string.h>
+#include <time.h>
+#include "I2cProfiler.h"
+
+std::atomic<bool> I2cProfiler::s_isEnabled(false);
+std::atomic<I2cBus*> I2cProfiler::s_pClock(NULL);
+I2cProfileEntry I2cProfiler::s_entries[K_I2C_PROFILE_MAX_ENTRIES];
+unsigned int I2cProfiler::s_nNbEntries = 0;
+thread_local I2cProfileEntry* I2cProfiler::s_pCurrent = NULL;
+std::mutex I2cProfiler::s_mutex;
+
+//---------------------------------------------------
+/**
+  * setEnabled : start or stop the profiling
+  *
+  * @param isEnabled if true, the profiled calls and the traced bus operations are counted
+  * @note disabled profiling costs a single test per profiled call,
+  *       define I2C_PROFILER_DISABLED to remove the profiled scopes at compile time
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::setEnabled(bool isEnabled){
+    s_isEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------
+/**
+  * setClock : select the time of the latencies
+  *
+  * @param pBus is the bus giving the time, NULL for the monotonic clock
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::setClock(I2cBus* pBus){
+    s_pClock.store(pBus, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------
+/**
+  * reset : forget all the counters
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::reset(){
+    std::lock_guard<std::mutex> lock(s_mutex);
+    memset(s_entries, 0, sizeof(s_entries));
+    s_nNbEntries = 0;
+}
+
+//---------------------------------------------------
+/**
+  * getEntry :
+  *
+  * @param nEntry is the entry number
+  * @return the counters of the entry
+*/
+//---------------------------------------------------
+const I2cProfileEntry&
+I2cProfiler::getEntry(unsigned int nEntry){
+    if(nEntry >= s_nNbEntries){
+        throw std::invalid_argument("[Error] getEntry arg out of range");
+    }
+    return s_entries[nEntry];
+}
+
+//---------------------------------------------------
+/**
+  * findEntry :
+  *
+  * @param pName is the name of the API call
+  * @return the counters of the call, NULL if it was not seen
+*/
+//---------------------------------------------------
+const I2cProfileEntry*
+I2cProfiler::findEntry(const char* pName){
+    std::lock_guard<std::mutex> lock(s_mutex);
+    unsigned int nI;
+    for(nI = 0; nI < s_nNbEntries; nI++){
+        if(0 == strcmp(s_entries[nI].pName, pName)){
+            return &s_entries[nI];
+        }
+    }
+    return NULL;
+}
+
+//---------------------------------------------------
+/**
+  * dump : print the counters and the latency histograms
+  *
+  * @param pFile is where to print
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::dump(FILE* pFile){
+    unsigned int nI, nBucket;
+    const I2cProfileEntry* pEntry;
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    fprintf(pFile, "%-44s %7s %8s %8s %8s %7s %10s %10s %10s\n",
+            "call", "calls", "writes", "reads", "ioctls", "sleeps", "sleep us", "avg us", "max us");
+    for(nI = 0; nI < s_nNbEntries; nI++){
+        pEntry = &s_entries[nI];
+        fprintf(pFile, "%-44s %7llu %8llu %8llu %8llu %7llu %10llu %10llu %10llu\n",
+                pEntry->pName, pEntry->nCalls, pEntry->nWrites, pEntry->nReads, pEntry->nIoctls,
+                pEntry->nDelays, pEntry->nDelayTime,
+                (0 == pEntry->nCalls) ? 0 : pEntry->nTime / pEntry->nCalls / 1000, pEntry->nMaxTime / 1000);
+        if(0 == pEntry->nCalls){
+            continue;
+        }
+        // Latency histogram, each bucket is labelled with its lower bound in us
+        fprintf(pFile, "%44s", "latency us:");
+        for(nBucket = 0; nBucket < K_I2C_PROFILE_NB_BUCKETS; nBucket++){
+            if(0 != pEntry->nHistogram[nBucket]){
+                fprintf(pFile, " %u:%llu", (0 == nBucket) ? 0 : (1U << nBucket), pEntry->nHistogram[nBucket]);
+            }
+        }
+        fprintf(pFile, "\n");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * count : add bus operations to the running call
+  *
+  * @param nWrites is the number of writes
+  * @param nReads is the number of reads
+  * @param nIoctls is the number of syscalls
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::count(unsigned int nWrites, unsigned int nReads, unsigned long long nIoctls){
+    I2cProfileEntry* pEntry;
+
+    if(false == isEnabled()){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_mutex);
+    pEntry = (NULL != s_pCurrent) ? s_pCurrent : createEntry(K_I2C_PROFILE_UNSCOPED);
+    pEntry->nWrites += nWrites;
+    pEntry->nReads  += nReads;
+    pEntry->nIoctls += nIoctls;
+}
+
+//---------------------------------------------------
+/**
+  * countDelay : add a sleep to the running call
+  *
+  * @param nMicroSeconds is the time of the sleep
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::countDelay(unsigned int nMicroSeconds){
+    I2cProfileEntry* pEntry;
+
+    if(false == isEnabled()){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_mutex);
+    pEntry = (NULL != s_pCurrent) ? s_pCurrent : createEntry(K_I2C_PROFILE_UNSCOPED);
+    pEntry->nDelays++;
+    pEntry->nDelayTime += nMicroSeconds;
+}
+
+//---------------------------------------------------
+/**
+  * enter : start a profiled call
+  *
+  * @param pName is the name of the call
+  * @param nStart receives the start time
+  * @return true if the call is the outermost one, only this one is counted
+  *
+*/
+//---------------------------------------------------
+bool
+I2cProfiler::enter(const char* pName, unsigned long long& nStart){
+    if(NULL != s_pCurrent){
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_pCurrent = createEntry(pName);
+        s_pCurrent->nCalls++;
+    }
+    nStart = getTime();
+    return true;
+}
+
+//---------------------------------------------------
+/**
+  * leave : end the outermost profiled call
+  *
+  * @param nStart is the start time given by enter()
+  *
+*/
+//---------------------------------------------------
+void
+I2cProfiler::leave(unsigned long long nStart){
+    unsigned long long nTime = getTime() - nStart;
+    unsigned long long nMicroSeconds = nTime / 1000;
+    unsigned int nBucket = 0;
+
+    while((nMicroSeconds > 1) && (nBucket < K_I2C_PROFILE_NB_BUCKETS - 1)){
+        nMicroSeconds >>= 1;
+        nBucket++;
+    }
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_pCurrent->nTime += nTime;
+    if(nTime > s_pCurrent->nMaxTime){
+        s_pCurrent->nMaxTime = nTime;
+    }
+    s_pCurrent->nHistogram[nBucket]++;
+    s_pCurrent = NULL;
+}
+
+//---------------------------------------------------
+/**
+  * createEntry : get the counters of a call, created if needed
+  *
+  * @param pName is the name of the call
+  * @return the counters, the unscoped entry if the table is full
+  * @note s_mutex must be held
+*/
+//---------------------------------------------------
+I2cProfileEntry*
+I2cProfiler::createEntry(const char* pName){
+    unsigned int nI;
+    bool isUnscoped = (0 == strcmp(pName, K_I2C_PROFILE_UNSCOPED));
+
+    // Names are string literals, the pointer is checked first
+    for(nI = 0; nI < s_nNbEntries; nI++){
+        if((s_entries[nI].pName == pName) || (0 == strcmp(s_entries[nI].pName, pName))){
+            return &s_entries[nI];
+        }
+    }
+    // The last entry is kept for the unscoped operations
+    if((false == isUnscoped) && (s_nNbEntries >= K_I2C_PROFILE_MAX_ENTRIES - 1)){
+        return createEntry(K_I2C_PROFILE_UNSCOPED);
+    }
+    memset(&s_entries[s_nNbEntries], 0, sizeof(I2cProfileEntry));
+    s_entries[s_nNbEntries].pName = pName;
+    return &s_entries[s_nNbEntries++];
+}
+
+//---------------------------------------------------
+/**
+  * getTime :
+  *
+  * @return the time in ns
+*/
+//---------------------------------------------------
+unsigned long long
+I2cProfiler::getTime(){
+    struct timespec now;
+    I2cBus* pClock = getClock();
+
+    if(NULL != pClock){
+        return pClock->getTime();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
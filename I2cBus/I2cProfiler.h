@@ -0,0 +1,240 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cProfiler.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include "I2cBus.h"
+
+// Number of API calls the profiler can tell apart
+const unsigned int  K_I2C_PROFILE_MAX_ENTRIES       = 64;
+// Latency histogram buckets, bucket N counts the calls from 2^N to 2^(N+1) us
+const unsigned int  K_I2C_PROFILE_NB_BUCKETS        = 24;
+// Name of the entry of the transfers done outside of any profiled call
+#define K_I2C_PROFILE_UNSCOPED                      "(unscoped)"
+
+// Counters of an API call
+struct I2cProfileEntry{
+    const char* pName;
+    unsigned long long nCalls;
+    // Bus operations done by the call and the calls it made
+    unsigned long long nWrites;
+    unsigned long long nReads;
+    unsigned long long nIoctls;
+    unsigned long long nDelays;
+    unsigned long long nDelayTime;
+    // Time spent in the call in ns
+    unsigned long long nTime;
+    unsigned long long nMaxTime;
+    unsigned long long nHistogram[K_I2C_PROFILE_NB_BUCKETS];
+};
+
+class I2cProfiler{
+    public:
+        //---------------------------------------------------
+        /**
+          * setEnabled : start or stop the profiling
+          *
+          * @param isEnabled if true, the profiled calls and the traced bus operations are counted
+          * @note disabled profiling costs a single test per profiled call,
+          *       define I2C_PROFILER_DISABLED to remove the profiled scopes at compile time
+          *
+        */
+        //---------------------------------------------------
+        static void setEnabled(bool isEnabled);
+
+        //---------------------------------------------------
+        /**
+          * isEnabled :
+          *
+          * @return true if the profiling is running
+        */
+        //---------------------------------------------------
+        static inline bool isEnabled(){ return s_isEnabled.load(std::memory_order_relaxed);}
+
+        //---------------------------------------------------
+        /**
+          * setClock : select the time of the latencies
+          *
+          * @param pBus is the bus giving the time, NULL for the monotonic clock
+          *
+        */
+        //---------------------------------------------------
+        static void setClock(I2cBus* pBus);
+
+        //---------------------------------------------------
+        /**
+          * getClock :
+          *
+          * @return the bus giving the time, NULL for the monotonic clock
+        */
+        //---------------------------------------------------
+        static inline I2cBus* getClock(){ return s_pClock.load(std::memory_order_relaxed);}
+
+        //---------------------------------------------------
+        /**
+          * reset : forget all the counters
+          *
+        */
+        //---------------------------------------------------
+        static void reset();
+
+        //---------------------------------------------------
+        /**
+          * getNbEntries :
+          *
+          * @return the number of API calls seen
+        */
+        //---------------------------------------------------
+        static inline unsigned int getNbEntries(){ return s_nNbEntries;}
+
+        //---------------------------------------------------
+        /**
+          * getEntry :
+          *
+          * @param nEntry is the entry number
+          * @return the counters of the entry
+        */
+        //---------------------------------------------------
+        static const I2cProfileEntry& getEntry(unsigned int nEntry);
+
+        //---------------------------------------------------
+        /**
+          * findEntry :
+          *
+          * @param pName is the name of the API call
+          * @return the counters of the call, NULL if it was not seen
+        */
+        //---------------------------------------------------
+        static const I2cProfileEntry* findEntry(const char* pName);
+
+        //---------------------------------------------------
+        /**
+          * dump : print the counters and the latency histograms
+          *
+          * @param pFile is where to print
+          *
+        */
+        //---------------------------------------------------
+        static void dump(FILE* pFile);
+
+        //---------------------------------------------------
+        /**
+          * count : add bus operations to the running call
+          *
+          * @param nWrites is the number of writes
+          * @param nReads is the number of reads
+          * @param nIoctls is the number of syscalls
+          *
+        */
+        //---------------------------------------------------
+        static void count(unsigned int nWrites, unsigned int nReads, unsigned long long nIoctls);
+
+        //---------------------------------------------------
+        /**
+          * countDelay : add a sleep to the running call
+          *
+          * @param nMicroSeconds is the time of the sleep
+          *
+        */
+        //---------------------------------------------------
+        static void countDelay(unsigned int nMicroSeconds);
+
+        //---------------------------------------------------
+        /**
+          * enter : start a profiled call
+          *
+          * @param pName is the name of the call
+          * @param nStart receives the start time
+          * @return true if the call is the outermost one, only this one is counted
+          *
+        */
+        //---------------------------------------------------
+        static bool enter(const char* pName, unsigned long long& nStart);
+
+        //---------------------------------------------------
+        /**
+          * leave : end the outermost profiled call
+          *
+          * @param nStart is the start time given by enter()
+          *
+        */
+        //---------------------------------------------------
+        static void leave(unsigned long long nStart);
+
+    private:
+        // true when the profiling is running, read by every profiled call of every thread
+        static std::atomic<bool> s_isEnabled;
+        // Time of the latencies
+        static std::atomic<I2cBus*> s_pClock;
+        // Counters of the API calls
+        static I2cProfileEntry s_entries[K_I2C_PROFILE_MAX_ENTRIES];
+        static unsigned int s_nNbEntries;
+        // Outermost call running in the thread, NULL if none
+        static thread_local I2cProfileEntry* s_pCurrent;
+        // The counters are shared by the threads, a KS0108Renderer draws in its own one
+        static std::mutex s_mutex;
+
+        //---------------------------------------------------
+        /**
+          * createEntry : get the counters of a call, created if needed
+          *
+          * @param pName is the name of the call
+          * @return the counters, the unscoped entry if the table is full
+          * @note s_mutex must be held
+        */
+        //---------------------------------------------------
+        static I2cProfileEntry* createEntry(const char* pName);
+
+        //---------------------------------------------------
+        /**
+          * getTime :
+          *
+          * @return the time in ns
+        */
+        //---------------------------------------------------
+        static unsigned long long getTime();
+};
+
+//---------------------------------------------------
+/**
+  * I2cProfileScope : profile the scope of an API call
+  *
+  * @note nested scopes are counted in the outermost one
+*/
+//---------------------------------------------------
+class I2cProfileScope{
+    public:
+        I2cProfileScope(const char* pName){
+            m_isActive = false;
+            if(true == I2cProfiler::isEnabled()){
+                m_isActive = I2cProfiler::enter(pName, m_nStart);
+            }
+        }
+        ~I2cProfileScope(){
+            if(true == m_isActive){
+                I2cProfiler::leave(m_nStart);
+            }
+        }
+    private:
+        bool m_isActive;
+        unsigned long long m_nStart;
+};
+
+#ifdef I2C_PROFILER_DISABLED
+#define M_I2C_PROFILE_SCOPE(name)
+#else
+#define M_I2C_PROFILE_SCOPE(name)                   I2cProfileScope profileScope(name);
+#endif
@@ -0,0 +1,366 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cRdwrBus.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "I2cRdwrBus.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param szBusNumber is the number N of the /dev/i2c-N adapter
+  *
+  * All the transfers are done with the I2C_RDWR ioctl, so several
+  * messages to several devices can be sent with a single syscall
+*/
+//---------------------------------------------------
+I2cRdwrBus::I2cRdwrBus(unsigned char szBusNumber){
+    m_szBusNumber           = szBusNumber;
+    m_nDeviceFD             = -1;
+    m_nTransactionDepth     = 0;
+    m_nIoctls               = 0;
+    m_nMsgCount             = 0;
+    m_nBufferLength         = 0;
+    m_isLastMergeable       = false;
+    m_isDeviceInitialized   = false;
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+I2cRdwrBus::~I2cRdwrBus(){
+    if(-1 != m_nDeviceFD){
+        close(m_nDeviceFD);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * init : open the adapter
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::init(){
+    char szDevice[32];
+
+    snprintf(szDevice, sizeof(szDevice), "/dev/i2c-%d", m_szBusNumber);
+    m_nDeviceFD = open(szDevice, O_RDWR);
+    if(-1 != m_nDeviceFD){
+        m_isDeviceInitialized = true;
+    }else{
+        printf("[I2cRdwrBus] unable to open %s\n",szDevice);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * beginTransaction : start to queue the messages
+  *
+  * @note transactions can be nested, messages are sent by the last endTransaction
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::beginTransaction(){
+    m_nTransactionDepth++;
+}
+
+//---------------------------------------------------
+/**
+  * endTransaction : send the queued messages with a single ioctl
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::endTransaction(){
+    if(m_nTransactionDepth > 0){
+        m_nTransactionDepth--;
+    }
+    if(0 == m_nTransactionDepth){
+        submit();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * abortTransaction : leave a transaction without sending
+  *
+  * @note the queued messages are dropped when the last transaction is left,
+  *       the ones a read or a full queue already submitted are not
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::abortTransaction(){
+    if(m_nTransactionDepth > 0){
+        m_nTransactionDepth--;
+    }
+    if(0 == m_nTransactionDepth){
+        m_nMsgCount     = 0;
+        m_nBufferLength = 0;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * write : write a byte to a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szData is the data to write
+  * @note inside a transaction the byte is only queued
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::write(unsigned char szAddres, unsigned char szData){
+    queue(szAddres, &szData, 1, true);
+    if(0 == m_nTransactionDepth){
+        submit();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * read : read a byte from a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @return the read data
+  * @note the queued messages are sent with the read in the same ioctl
+  *
+*/
+//---------------------------------------------------
+unsigned char
+I2cRdwrBus::read(unsigned char szAddres){
+    unsigned int nIndex;
+
+    nIndex = queue(szAddres, NULL, 1, false);
+    // The caller needs the data now
+    submit();
+    return m_szBuffer[nIndex];
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister8 : write 8 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData){
+    unsigned char szMsg[2];
+
+    szMsg[0] = szRegister;
+    szMsg[1] = szData;
+    queue(szAddres, szMsg, sizeof(szMsg), false);
+    if(0 == m_nTransactionDepth){
+        submit();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister16 : write 16 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param nData is the data to write, low byte is sent first
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData){
+    unsigned char szMsg[3];
+
+    szMsg[0] = szRegister;
+    szMsg[1] = nData & 0xFF;
+    szMsg[2] = (nData >> 8) & 0xFF;
+    queue(szAddres, szMsg, sizeof(szMsg), false);
+    if(0 == m_nTransactionDepth){
+        submit();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readRegister8 : read 8 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+I2cRdwrBus::readRegister8(unsigned char szAddres, unsigned char szRegister){
+    unsigned int nIndex;
+
+    // Register pointer then repeated start for the read, in the same ioctl
+    makeRoom(2, 1 + 1);
+    queue(szAddres, &szRegister, 1, false);
+    nIndex = queue(szAddres, NULL, 1, false);
+    submit();
+    return m_szBuffer[nIndex];
+}
+
+//---------------------------------------------------
+/**
+  * readRegister16 : read 16 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data, the first received byte is the low byte
+  *
+*/
+//---------------------------------------------------
+unsigned int
+I2cRdwrBus::readRegister16(unsigned char szAddres, unsigned char szRegister){
+    unsigned int nIndex;
+
+    // Register pointer then repeated start for the read, in the same ioctl
+    makeRoom(2, 1 + 2);
+    queue(szAddres, &szRegister, 1, false);
+    nIndex = queue(szAddres, NULL, 2, false);
+    submit();
+    return m_szBuffer[nIndex] | (m_szBuffer[nIndex + 1] << 8);
+}
+
+//---------------------------------------------------
+/**
+  * writeBlock : write several bytes to a device in one message
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write
+  * @param nLength is the number of bytes
+  * @note inside a transaction the bytes are only queued
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength){
+    unsigned int nChunk;
+
+    // A block longer than the buffer is cut in several messages
+    while(nLength > 0){
+        nChunk = (nLength < K_I2C_RDWR_MAX_BYTES - 1) ? nLength : K_I2C_RDWR_MAX_BYTES - 1;
+        queue(szAddres, pData, nChunk, true);
+        pData   += nChunk;
+        nLength -= nChunk;
+    }
+    if(0 == m_nTransactionDepth){
+        submit();
+    }
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * queue : add a message to the queued messages
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write, NULL for a read
+  * @param nLength is the number of bytes to write or to read
+  * @param isMergeable if true, a single byte write can be appended to the previous write message
+  * @return the index of the first byte of the message in the buffer
+  *
+*/
+//---------------------------------------------------
+unsigned int
+I2cRdwrBus::queue(unsigned char szAddres, const unsigned char* pData, unsigned int nLength, bool isMergeable){
+    struct i2c_msg* pLast;
+    unsigned int nIndex;
+    unsigned int nI;
+
+    if(false == m_isDeviceInitialized){
+        throw std::runtime_error("[Error] i2c adapter not opened");
+    }
+    makeRoom(1, nLength);
+    // Only a message longer than the buffer does not fit in an empty ioctl
+    if((m_nBufferLength > K_I2C_RDWR_MAX_BYTES) || (nLength > K_I2C_RDWR_MAX_BYTES - m_nBufferLength)){
+        throw std::invalid_argument("[Error] i2c message too long");
+    }
+    nIndex = m_nBufferLength;
+    for(nI = 0; nI < nLength; nI++){
+        m_szBuffer[nIndex + nI] = (NULL != pData) ? pData[nI] : 0x00;
+    }
+    m_nBufferLength += nLength;
+
+    // Consecutive writes to the same device are sent in one message,
+    // a PCF8574 latches each byte of a multi-byte write
+    pLast = (m_nMsgCount > 0) ? &m_msgs[m_nMsgCount - 1] : NULL;
+    if((true == isMergeable) && (true == m_isLastMergeable) && (NULL != pLast) && (pLast->addr == szAddres) &&
+       (pLast->buf + pLast->len == &m_szBuffer[nIndex])){
+        pLast->len += nLength;
+    }else{
+        m_msgs[m_nMsgCount].addr    = szAddres;
+        m_msgs[m_nMsgCount].flags   = (NULL == pData) ? I2C_M_RD : 0;
+        m_msgs[m_nMsgCount].len     = nLength;
+        m_msgs[m_nMsgCount].buf     = &m_szBuffer[nIndex];
+        m_nMsgCount++;
+    }
+    m_isLastMergeable = isMergeable;
+    return nIndex;
+}
+
+//---------------------------------------------------
+/**
+  * makeRoom : send the queued messages if new ones do not fit in the same ioctl
+  *
+  * @param nMsgs is the number of messages to queue
+  * @param nBytes is the number of bytes of these messages
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::makeRoom(unsigned int nMsgs, unsigned int nBytes){
+    if((m_nMsgCount + nMsgs > K_I2C_RDWR_MAX_MSGS) || (m_nBufferLength + nBytes > K_I2C_RDWR_MAX_BYTES)){
+        submit();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * submit : send all the queued messages
+  *
+*/
+//---------------------------------------------------
+void
+I2cRdwrBus::submit(){
+    struct i2c_rdwr_ioctl_data rdwr;
+    int nRes;
+
+    if(0 == m_nMsgCount){
+        return;
+    }
+    rdwr.msgs   = m_msgs;
+    rdwr.nmsgs  = m_nMsgCount;
+    m_nIoctls++;
+    nRes = ioctl(m_nDeviceFD, I2C_RDWR, &rdwr);
+    m_nMsgCount     = 0;
+    m_nBufferLength = 0;
+    if(nRes < 0){
+        throw std::runtime_error("[Error] i2c rdwr ioctl error");
+    }
+}
@@ -0,0 +1,243 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cRdwrBus.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "I2cBus.h"
+
+// Max number of messages in a single I2C_RDWR ioctl
+const unsigned int  K_I2C_RDWR_MAX_MSGS             = I2C_RDWR_IOCTL_MAX_MSGS;
+// Max number of bytes queued in a single I2C_RDWR ioctl
+const unsigned int  K_I2C_RDWR_MAX_BYTES            = 256;
+
+class I2cRdwrBus : public I2cBus{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param szBusNumber is the number N of the /dev/i2c-N adapter
+          *
+          * All the transfers are done with the I2C_RDWR ioctl, so several
+          * messages to several devices can be sent with a single syscall
+        */
+        //---------------------------------------------------
+        I2cRdwrBus(unsigned char szBusNumber);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~I2cRdwrBus();
+
+        //---------------------------------------------------
+        /**
+          * init : open the adapter
+          *
+        */
+        //---------------------------------------------------
+        virtual void init();
+
+        //---------------------------------------------------
+        /**
+          * isDeviceUp :
+          *
+          * @return true if the adapter was opened
+        */
+        //---------------------------------------------------
+        virtual bool isDeviceUp(){ return m_isDeviceInitialized;}
+
+        //---------------------------------------------------
+        /**
+          * beginTransaction : start to queue the messages
+          *
+          * @note transactions can be nested, messages are sent by the last endTransaction
+          *
+        */
+        //---------------------------------------------------
+        virtual void beginTransaction();
+
+        //---------------------------------------------------
+        /**
+          * endTransaction : send the queued messages with a single ioctl
+          *
+        */
+        //---------------------------------------------------
+        virtual void endTransaction();
+
+        //---------------------------------------------------
+        /**
+          * abortTransaction : leave a transaction without sending
+          *
+          * @note the queued messages are dropped when the last transaction is left,
+          *       the ones a read or a full queue already submitted are not
+          *
+        */
+        //---------------------------------------------------
+        virtual void abortTransaction();
+
+        //---------------------------------------------------
+        /**
+          * write : write a byte to a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szData is the data to write
+          * @note inside a transaction the byte is only queued
+          *
+        */
+        //---------------------------------------------------
+        virtual void write(unsigned char szAddres, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * read : read a byte from a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the read data
+          * @note the queued messages are sent with the read in the same ioctl
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char read(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister8 : write 8 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister16 : write 16 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param nData is the data to write, low byte is sent first
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData);
+
+        //---------------------------------------------------
+        /**
+          * readRegister8 : read 8 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readRegister8(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * readRegister16 : read 16 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data, the first received byte is the low byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned int readRegister16(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * writeBlock : write several bytes to a device in one message
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write
+          * @param nLength is the number of bytes
+          * @note inside a transaction the bytes are only queued
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * getIoctlCount : get the number of syscalls done on the adapter
+          *
+          * @return the number of syscalls since the bus was created
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getIoctlCount(){ return m_nIoctls;}
+
+    private:
+        // Flag to know if operations are valid or not
+        bool m_isDeviceInitialized;
+
+        // Number of the adapter
+        unsigned char m_szBusNumber;
+
+        // File descriptor of the adapter
+        int m_nDeviceFD;
+
+        // Number of I2C_RDWR ioctls
+        unsigned long long m_nIoctls;
+
+        // Nesting level of the transactions
+        unsigned int m_nTransactionDepth;
+
+        // Queued messages and their data
+        struct i2c_msg m_msgs[K_I2C_RDWR_MAX_MSGS];
+        unsigned int m_nMsgCount;
+        unsigned char m_szBuffer[K_I2C_RDWR_MAX_BYTES];
+        unsigned int m_nBufferLength;
+        // true if the last queued message is a write that can be extended
+        bool m_isLastMergeable;
+
+        //---------------------------------------------------
+        /**
+          * queue : add a message to the queued messages
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write, NULL for a read
+          * @param nLength is the number of bytes to write or to read
+          * @param isMergeable if true, a single byte write can be appended to the previous write message
+          * @return the index of the first byte of the message in the buffer
+          *
+        */
+        //---------------------------------------------------
+        unsigned int queue(unsigned char szAddres, const unsigned char* pData, unsigned int nLength, bool isMergeable);
+
+        //---------------------------------------------------
+        /**
+          * makeRoom : send the queued messages if new ones do not fit in the same ioctl
+          *
+          * @param nMsgs is the number of messages to queue
+          * @param nBytes is the number of bytes of these messages
+          *
+        */
+        //---------------------------------------------------
+        void makeRoom(unsigned int nMsgs, unsigned int nBytes);
+
+        //---------------------------------------------------
+        /**
+          * submit : send all the queued messages
+          *
+        */
+        //---------------------------------------------------
+        void submit();
+
+};
@@ -0,0 +1,332 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cTraceBus.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include "I2cTraceBus.h"
+#include "I2cProfiler.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param bus is the bus doing the transfers
+  *
+  * Every operation is forwarded to the bus and counted by the I2cProfiler
+  * in the running API call, the bus also gives the time of the profiler
+  * @note nothing is counted while the profiler is disabled
+*/
+//---------------------------------------------------
+I2cTraceBus::I2cTraceBus(I2cBus& bus){
+    m_pBus          = &bus;
+    m_nIoctls       = bus.getIoctlCount();
+    m_pTraceFile    = NULL;
+    I2cProfiler::setClock(this);
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+I2cTraceBus::~I2cTraceBus(){
+    if(this == I2cProfiler::getClock()){
+        I2cProfiler::setClock(NULL);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * setTraceFile : log every operation
+  *
+  * @param pFile is where to log, NULL to stop logging
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::setTraceFile(FILE* pFile){
+    m_pTraceFile = pFile;
+}
+
+//---------------------------------------------------
+/**
+  * init : Init the bus
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::init(){
+    m_pBus->init();
+}
+
+//---------------------------------------------------
+/**
+  * isDeviceUp :
+  *
+  * @return true if the bus was initialized
+*/
+//---------------------------------------------------
+bool
+I2cTraceBus::isDeviceUp(){
+    return m_pBus->isDeviceUp();
+}
+
+//---------------------------------------------------
+/**
+  * write : write a byte to a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::write(unsigned char szAddres, unsigned char szData){
+    trace("W", szAddres, -1, szData);
+    m_pBus->write(szAddres, szData);
+    count(1, 0);
+}
+
+//---------------------------------------------------
+/**
+  * read : read a byte from a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+I2cTraceBus::read(unsigned char szAddres){
+    unsigned char szData = m_pBus->read(szAddres);
+    count(0, 1);
+    trace("R", szAddres, -1, szData);
+    return szData;
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister8 : write 8 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData){
+    trace("W8", szAddres, szRegister, szData);
+    m_pBus->writeRegister8(szAddres, szRegister, szData);
+    count(1, 0);
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister16 : write 16 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param nData is the data to write, low byte is sent first
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData){
+    trace("W16", szAddres, szRegister, nData);
+    m_pBus->writeRegister16(szAddres, szRegister, nData);
+    count(1, 0);
+}
+
+//---------------------------------------------------
+/**
+  * readRegister8 : read 8 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+I2cTraceBus::readRegister8(unsigned char szAddres, unsigned char szRegister){
+    unsigned char szData = m_pBus->readRegister8(szAddres, szRegister);
+    count(0, 1);
+    trace("R8", szAddres, szRegister, szData);
+    return szData;
+}
+
+//---------------------------------------------------
+/**
+  * readRegister16 : read 16 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data, the first received byte is the low byte
+  *
+*/
+//---------------------------------------------------
+unsigned int
+I2cTraceBus::readRegister16(unsigned char szAddres, unsigned char szRegister){
+    unsigned int nData = m_pBus->readRegister16(szAddres, szRegister);
+    count(0, 1);
+    trace("R16", szAddres, szRegister, nData);
+    return nData;
+}
+
+//---------------------------------------------------
+/**
+  * writeBlock : write several bytes to a device in one message
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write
+  * @param nLength is the number of bytes
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength){
+    unsigned int nI;
+
+    if(NULL != m_pTraceFile){
+        fprintf(m_pTraceFile, "%12llu %-3s 0x%02x", m_pBus->getTime() / 1000, "WB", szAddres);
+        for(nI = 0; nI < nLength; nI++){
+            fprintf(m_pTraceFile, " 0x%02x", pData[nI]);
+        }
+        fprintf(m_pTraceFile, "\n");
+    }
+    m_pBus->writeBlock(szAddres, pData, nLength);
+    count(1, 0);
+}
+
+//---------------------------------------------------
+/**
+  * beginTransaction : start to group the transfers
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::beginTransaction(){
+    m_pBus->beginTransaction();
+}
+
+//---------------------------------------------------
+/**
+  * endTransaction : send the grouped transfers
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::endTransaction(){
+    m_pBus->endTransaction();
+    // The grouped transfers may only be sent now
+    count(0, 0);
+}
+
+//---------------------------------------------------
+/**
+  * abortTransaction : leave a transaction without sending
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::abortTransaction(){
+    m_pBus->abortTransaction();
+    count(0, 0);
+}
+
+//---------------------------------------------------
+/**
+  * delay : wait between two transfers
+  *
+  * @param nMicroSeconds is the time to wait
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::delay(unsigned int nMicroSeconds){
+    if(NULL != m_pTraceFile){
+        fprintf(m_pTraceFile, "%12llu D   %u us\n", m_pBus->getTime() / 1000, nMicroSeconds);
+    }
+    m_pBus->delay(nMicroSeconds);
+    I2cProfiler::countDelay(nMicroSeconds);
+}
+
+//---------------------------------------------------
+/**
+  * getTime : get the time of the bus
+  *
+  * @return the time of the traced bus in nanoseconds
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+I2cTraceBus::getTime(){
+    return m_pBus->getTime();
+}
+
+//---------------------------------------------------
+/**
+  * getIoctlCount : get the number of syscalls done on the adapter
+  *
+  * @return the number of syscalls of the traced bus
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+I2cTraceBus::getIoctlCount(){
+    return m_pBus->getIoctlCount();
+}
+
+//---------------------------------------------------
+/**
+  * count : count an operation in the running API call
+  *
+  * @param nWrites is the number of writes
+  * @param nReads is the number of reads
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::count(unsigned int nWrites, unsigned int nReads){
+    unsigned long long nIoctls = m_pBus->getIoctlCount();
+
+    // The counter of a simulated bus goes back to 0 when its statistics are reset
+    I2cProfiler::count(nWrites, nReads, (nIoctls >= m_nIoctls) ? nIoctls - m_nIoctls : nIoctls);
+    m_nIoctls = nIoctls;
+}
+
+//---------------------------------------------------
+/**
+  * trace : log an operation
+  *
+  * @param pOperation is the operation name
+  * @param szAddres is the I2C addres of the device
+  * @param nRegister is the register, -1 if none
+  * @param nData is the data, -1 if none
+  *
+*/
+//---------------------------------------------------
+void
+I2cTraceBus::trace(const char* pOperation, unsigned char szAddres, int nRegister, int nData){
+    if(NULL == m_pTraceFile){
+        return;
+    }
+    fprintf(m_pTraceFile, "%12llu %-3s 0x%02x", m_pBus->getTime() / 1000, pOperation, szAddres);
+    if(nRegister >= 0){
+        fprintf(m_pTraceFile, " reg 0x%02x", nRegister);
+    }
+    if(nData >= 0){
+        fprintf(m_pTraceFile, " 0x%02x", nData);
+    }
+    fprintf(m_pTraceFile, "\n");
+}
@@ -0,0 +1,236 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: I2cTraceBus.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "I2cBus.h"
+
+class I2cTraceBus : public I2cBus{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param bus is the bus doing the transfers
+          *
+          * Every operation is forwarded to the bus and counted by the I2cProfiler
+          * in the running API call, the bus also gives the time of the profiler
+          * @note nothing is counted while the profiler is disabled
+        */
+        //---------------------------------------------------
+        I2cTraceBus(I2cBus& bus);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~I2cTraceBus();
+
+        //---------------------------------------------------
+        /**
+          * setTraceFile : log every operation
+          *
+          * @param pFile is where to log, NULL to stop logging
+          *
+        */
+        //---------------------------------------------------
+        void setTraceFile(FILE* pFile);
+
+        //---------------------------------------------------
+        /**
+          * init : Init the bus
+          *
+        */
+        //---------------------------------------------------
+        virtual void init();
+
+        //---------------------------------------------------
+        /**
+          * isDeviceUp :
+          *
+          * @return true if the bus was initialized
+        */
+        //---------------------------------------------------
+        virtual bool isDeviceUp();
+
+        //---------------------------------------------------
+        /**
+          * write : write a byte to a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void write(unsigned char szAddres, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * read : read a byte from a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char read(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister8 : write 8 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister16 : write 16 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param nData is the data to write, low byte is sent first
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData);
+
+        //---------------------------------------------------
+        /**
+          * readRegister8 : read 8 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readRegister8(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * readRegister16 : read 16 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data, the first received byte is the low byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned int readRegister16(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * writeBlock : write several bytes to a device in one message
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write
+          * @param nLength is the number of bytes
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * beginTransaction : start to group the transfers
+          *
+        */
+        //---------------------------------------------------
+        virtual void beginTransaction();
+
+        //---------------------------------------------------
+        /**
+          * endTransaction : send the grouped transfers
+          *
+        */
+        //---------------------------------------------------
+        virtual void endTransaction();
+
+        //---------------------------------------------------
+        /**
+          * abortTransaction : leave a transaction without sending
+          *
+        */
+        //---------------------------------------------------
+        virtual void abortTransaction();
+
+        //---------------------------------------------------
+        /**
+          * delay : wait between two transfers
+          *
+          * @param nMicroSeconds is the time to wait
+          *
+        */
+        //---------------------------------------------------
+        virtual void delay(unsigned int nMicroSeconds);
+
+        //---------------------------------------------------
+        /**
+          * getTime : get the time of the bus
+          *
+          * @return the time of the traced bus in nanoseconds
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getTime();
+
+        //---------------------------------------------------
+        /**
+          * getIoctlCount : get the number of syscalls done on the adapter
+          *
+          * @return the number of syscalls of the traced bus
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getIoctlCount();
+
+    private:
+        // Bus doing the transfers
+        I2cBus* m_pBus;
+
+        // Syscalls of the traced bus already counted
+        unsigned long long m_nIoctls;
+
+        // Log of the operations, NULL if not logged
+        FILE* m_pTraceFile;
+
+        //---------------------------------------------------
+        /**
+          * count : count an operation in the running API call
+          *
+          * @param nWrites is the number of writes
+          * @param nReads is the number of reads
+          *
+        */
+        //---------------------------------------------------
+        void count(unsigned int nWrites, unsigned int nReads);
+
+        //---------------------------------------------------
+        /**
+          * trace : log an operation
+          *
+          * @param pOperation is the operation name
+          * @param szAddres is the I2C addres of the device
+          * @param nRegister is the register, -1 if none
+          * @param nData is the data, -1 if none
+          *
+        */
+        //---------------------------------------------------
+        void trace(const char* pOperation, unsigned char szAddres, int nRegister, int nData);
+};
@@ -0,0 +1,121 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: Pcf8574Simulator.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <string.h>
+#include "Pcf8574Simulator.h"
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+Pcf8574Peripheral::~Pcf8574Peripheral(){
+}
+
+//---------------------------------------------------
+/**
+  * Constructor
+  *
+  * The port is quasi-bidirectional: a latched 0 pulls the pin low,
+  * a latched 1 is a weak pull up, so a pin can only be read
+  * after a 1 was written to it
+*/
+//---------------------------------------------------
+Pcf8574Simulator::Pcf8574Simulator(){
+    m_pPeripheral   = NULL;
+    m_nPort         = 0;
+    // All the pins are high after power on
+    m_szLatch       = 0xFF;
+    resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+Pcf8574Simulator::~Pcf8574Simulator(){
+}
+
+//---------------------------------------------------
+/**
+  * connect : wire a peripheral to the port
+  *
+  * @param pPeripheral is the peripheral, NULL if the port is left open
+  * @param nPort is the number given back to the peripheral
+  * @note the expander does not own the peripheral
+  *
+*/
+//---------------------------------------------------
+void
+Pcf8574Simulator::connect(Pcf8574Peripheral* pPeripheral, unsigned int nPort){
+    m_pPeripheral   = pPeripheral;
+    m_nPort         = nPort;
+}
+
+//---------------------------------------------------
+/**
+  * resetStats : set the counters to 0
+  *
+*/
+//---------------------------------------------------
+void
+Pcf8574Simulator::resetStats(){
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//---------------------------------------------------
+/**
+  * writeByte : latch a byte on the port
+  *
+  * @param szData is the received byte
+  * @param nTime is the virtual time in ns of the acknowledge
+  *
+*/
+//---------------------------------------------------
+void
+Pcf8574Simulator::writeByte(unsigned char szData, unsigned long long nTime){
+    // The outputs change on the acknowledge of each byte
+    m_szLatch = szData;
+    m_stats.nWrites++;
+    if(NULL != m_pPeripheral){
+        m_pPeripheral->portChanged(m_nPort, m_szLatch, nTime);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readByte : sample the pins of the port
+  *
+  * @param nTime is the virtual time in ns of the first bit
+  * @return the levels of the pins
+  *
+*/
+//---------------------------------------------------
+unsigned char
+Pcf8574Simulator::readByte(unsigned long long nTime){
+    unsigned char szDriven = 0;
+    unsigned char szLevels = 0xFF;
+
+    m_stats.nReads++;
+    if(NULL != m_pPeripheral){
+        szLevels = m_pPeripheral->drivePort(m_nPort, szDriven, nTime);
+    }
+    // A pin latched low wins against the peripheral
+    if(0 != (szDriven & szLevels & ~m_szLatch)){
+        m_stats.nContentions++;
+    }
+    return m_szLatch & (szLevels | ~szDriven);
+}
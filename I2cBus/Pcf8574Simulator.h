@@ -0,0 +1,153 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: Pcf8574Simulator.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "SimulatedBus.h"
+
+// Counters of a simulated expander
+struct Pcf8574SimStats{
+    // Bytes latched on the port and bytes read from the port
+    unsigned long long nWrites;
+    unsigned long long nReads;
+    // Reads of a pin driven high by the peripheral while the latch pulls it low
+    unsigned long long nContentions;
+};
+
+// What is wired to the port of a simulated expander
+class Pcf8574Peripheral{
+    public:
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~Pcf8574Peripheral();
+
+        //---------------------------------------------------
+        /**
+          * portChanged : the outputs of a port were written
+          *
+          * @param nPort is the port number given to the expander
+          * @param szLatch is the new latch, a 1 is a weak pull up the peripheral can pull down
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void portChanged(unsigned int nPort, unsigned char szLatch, unsigned long long nTime) = 0;
+
+        //---------------------------------------------------
+        /**
+          * drivePort : levels put on a port by the peripheral
+          *
+          * @param nPort is the port number given to the expander
+          * @param szDriven receives the pins driven by the peripheral
+          * @param nTime is the virtual time in ns
+          * @return the levels of the driven pins
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char drivePort(unsigned int nPort, unsigned char& szDriven, unsigned long long nTime) = 0;
+};
+
+class Pcf8574Simulator : public I2cSimDevice{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          *
+          * The port is quasi-bidirectional: a latched 0 pulls the pin low,
+          * a latched 1 is a weak pull up, so a pin can only be read
+          * after a 1 was written to it
+        */
+        //---------------------------------------------------
+        Pcf8574Simulator();
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~Pcf8574Simulator();
+
+        //---------------------------------------------------
+        /**
+          * connect : wire a peripheral to the port
+          *
+          * @param pPeripheral is the peripheral, NULL if the port is left open
+          * @param nPort is the number given back to the peripheral
+          * @note the expander does not own the peripheral
+          *
+        */
+        //---------------------------------------------------
+        void connect(Pcf8574Peripheral* pPeripheral, unsigned int nPort);
+
+        //---------------------------------------------------
+        /**
+          * getLatch :
+          *
+          * @return the last written byte, 0xFF after power on
+        */
+        //---------------------------------------------------
+        inline unsigned char getLatch(){ return m_szLatch;}
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the counters of the expander
+        */
+        //---------------------------------------------------
+        inline const Pcf8574SimStats& getStats(){ return m_stats;}
+
+        //---------------------------------------------------
+        /**
+          * resetStats : set the counters to 0
+          *
+        */
+        //---------------------------------------------------
+        void resetStats();
+
+        //---------------------------------------------------
+        /**
+          * writeByte : latch a byte on the port
+          *
+          * @param szData is the received byte
+          * @param nTime is the virtual time in ns of the acknowledge
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeByte(unsigned char szData, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * readByte : sample the pins of the port
+          *
+          * @param nTime is the virtual time in ns of the first bit
+          * @return the levels of the pins
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readByte(unsigned long long nTime);
+
+    private:
+        // Wired peripheral, NULL if none
+        Pcf8574Peripheral* m_pPeripheral;
+        unsigned int m_nPort;
+
+        // Output latch
+        unsigned char m_szLatch;
+
+        // Counters
+        Pcf8574SimStats m_stats;
+};
@@ -0,0 +1,443 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: SimulatedBus.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SimulatedBus.h"
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+I2cSimDevice::~I2cSimDevice(){
+}
+
+//---------------------------------------------------
+/**
+  * start : the device is addressed by a START or a repeated START
+  *
+  * @param isRead if true, the master will read
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+I2cSimDevice::start(bool, unsigned long long){
+}
+
+//---------------------------------------------------
+/**
+  * stop : a STOP ends the transfer with the device
+  *
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+I2cSimDevice::stop(unsigned long long){
+}
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param nClock is the SCL frequency in Hz
+  *
+  * The bus runs in virtual time: transfers advance the time according
+  * to the clock and delay() does not sleep
+*/
+//---------------------------------------------------
+SimulatedBus::SimulatedBus(unsigned int nClock){
+    memset(m_pDevices, 0, sizeof(m_pDevices));
+    m_pCurrentDevice        = NULL;
+    m_nTime                 = 0;
+    m_nTransactionDepth     = 0;
+    m_isDeviceInitialized   = false;
+    setClock(nClock);
+    resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+SimulatedBus::~SimulatedBus(){
+}
+
+//---------------------------------------------------
+/**
+  * init : Init the bus
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::init(){
+    m_isDeviceInitialized = true;
+}
+
+//---------------------------------------------------
+/**
+  * attach : connect a device to the bus
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pDevice is the device, NULL to disconnect
+  * @note the bus does not own the device
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::attach(unsigned char szAddres, I2cSimDevice* pDevice){
+    if(szAddres < K_I2C_SIM_NB_ADDRES){
+        m_pDevices[szAddres] = pDevice;
+    }else{
+        throw std::invalid_argument("[Error] i2c addres out of range");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * setClock : change the SCL frequency
+  *
+  * @param nClock is the frequency in Hz
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::setClock(unsigned int nClock){
+    if(0 != nClock){
+        m_nClock    = nClock;
+        m_nBitTime  = 1000000000ULL / nClock;
+    }else{
+        throw std::invalid_argument("[Error] i2c clock must not be 0");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * resetStats : clear the counters of the bus
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::resetStats(){
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//---------------------------------------------------
+/**
+  * write : write a byte to a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::write(unsigned char szAddres, unsigned char szData){
+    startMessage(szAddres, false);
+    sendByte(szData);
+    endMessage();
+}
+
+//---------------------------------------------------
+/**
+  * read : read a byte from a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+SimulatedBus::read(unsigned char szAddres){
+    unsigned char szData;
+    startMessage(szAddres, true);
+    szData = receiveByte();
+    endMessage();
+    return szData;
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister8 : write 8 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData){
+    startMessage(szAddres, false);
+    sendByte(szRegister);
+    sendByte(szData);
+    endMessage();
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister16 : write 16 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param nData is the data to write, low byte is sent first
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData){
+    startMessage(szAddres, false);
+    sendByte(szRegister);
+    sendByte(nData & 0xFF);
+    sendByte((nData >> 8) & 0xFF);
+    endMessage();
+}
+
+//---------------------------------------------------
+/**
+  * readRegister8 : read 8 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+SimulatedBus::readRegister8(unsigned char szAddres, unsigned char szRegister){
+    unsigned char szData;
+    // Register pointer then repeated start for the read
+    startMessage(szAddres, false);
+    sendByte(szRegister);
+    startMessage(szAddres, true);
+    szData = receiveByte();
+    endMessage();
+    return szData;
+}
+
+//---------------------------------------------------
+/**
+  * readRegister16 : read 16 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data, the first received byte is the low byte
+  *
+*/
+//---------------------------------------------------
+unsigned int
+SimulatedBus::readRegister16(unsigned char szAddres, unsigned char szRegister){
+    unsigned int nData;
+    // Register pointer then repeated start for the read
+    startMessage(szAddres, false);
+    sendByte(szRegister);
+    startMessage(szAddres, true);
+    nData = receiveByte();
+    nData |= receiveByte() << 8;
+    endMessage();
+    return nData;
+}
+
+//---------------------------------------------------
+/**
+  * writeBlock : write several bytes to a device in one message
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write
+  * @param nLength is the number of bytes
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength){
+    unsigned int nI;
+
+    startMessage(szAddres, false);
+    for(nI = 0; nI < nLength; nI++){
+        sendByte(pData[nI]);
+    }
+    endMessage();
+}
+
+//---------------------------------------------------
+/**
+  * beginTransaction : start to group the transfers
+  *
+  * @note grouped messages are joined by repeated STARTs
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::beginTransaction(){
+    m_nTransactionDepth++;
+}
+
+//---------------------------------------------------
+/**
+  * endTransaction : send the grouped transfers
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::endTransaction(){
+    if(m_nTransactionDepth > 0){
+        m_nTransactionDepth--;
+    }
+    if((0 == m_nTransactionDepth) && (NULL != m_pCurrentDevice)){
+        stopTransfer();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * abortTransaction : leave a transaction without sending
+  *
+  * @note the simulated messages were already delivered
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::abortTransaction(){
+    endTransaction();
+}
+
+//---------------------------------------------------
+/**
+  * delay : advance the virtual time
+  *
+  * @param nMicroSeconds is the time to wait
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::delay(unsigned int nMicroSeconds){
+    m_nTime += nMicroSeconds * 1000ULL;
+    m_stats.nDelays++;
+    m_stats.nDelayTime += nMicroSeconds * 1000ULL;
+}
+
+//---------------------------------------------------
+/**
+  * getTime : get the virtual time of the bus
+  *
+  * @return the virtual time in nanoseconds
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+SimulatedBus::getTime(){
+    return m_nTime;
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * startMessage : START or repeated START, then the addres byte
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param isRead if true, the master will read
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::startMessage(unsigned char szAddres, bool isRead){
+    I2cSimDevice* pDevice;
+
+    if(false == m_isDeviceInitialized){
+        throw std::runtime_error("[Error] i2c bus not initialized");
+    }
+    pDevice = (szAddres < K_I2C_SIM_NB_ADDRES) ? m_pDevices[szAddres] : NULL;
+    // START, or repeated START inside a transfer, and the addres byte
+    m_nTime += m_nBitTime * (1 + K_I2C_SIM_BITS_PER_BYTE);
+    m_stats.nBusTime += m_nBitTime * (1 + K_I2C_SIM_BITS_PER_BYTE);
+    m_stats.nMessages++;
+    if(NULL == pDevice){
+        // Nobody acknowledges the addres
+        if(NULL != m_pCurrentDevice){
+            stopTransfer();
+        }else{
+            m_stats.nTransfers++;
+        }
+        throw std::runtime_error("[Error] i2c no device at addres");
+    }
+    m_pCurrentDevice = pDevice;
+    m_pCurrentDevice->start(isRead, m_nTime);
+}
+
+//---------------------------------------------------
+/**
+  * sendByte : send a byte to the device of the current message
+  *
+  * @param szData is the data to send
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::sendByte(unsigned char szData){
+    m_nTime += m_nBitTime * K_I2C_SIM_BITS_PER_BYTE;
+    m_stats.nBusTime += m_nBitTime * K_I2C_SIM_BITS_PER_BYTE;
+    m_stats.nBytesWritten++;
+    m_pCurrentDevice->writeByte(szData, m_nTime);
+}
+
+//---------------------------------------------------
+/**
+  * receiveByte : receive a byte from the device of the current message
+  *
+  * @return the received data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+SimulatedBus::receiveByte(){
+    unsigned char szData;
+    szData = m_pCurrentDevice->readByte(m_nTime);
+    m_nTime += m_nBitTime * K_I2C_SIM_BITS_PER_BYTE;
+    m_stats.nBusTime += m_nBitTime * K_I2C_SIM_BITS_PER_BYTE;
+    m_stats.nBytesRead++;
+    return szData;
+}
+
+//---------------------------------------------------
+/**
+  * endMessage : STOP the transfer unless a transaction is running
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::endMessage(){
+    if(0 == m_nTransactionDepth){
+        stopTransfer();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * stopTransfer : STOP condition
+  *
+*/
+//---------------------------------------------------
+void
+SimulatedBus::stopTransfer(){
+    m_nTime += m_nBitTime;
+    m_stats.nBusTime += m_nBitTime;
+    m_stats.nTransfers++;
+    m_pCurrentDevice->stop(m_nTime);
+    m_pCurrentDevice = NULL;
+}
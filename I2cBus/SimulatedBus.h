@@ -0,0 +1,388 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: SimulatedBus.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "I2cBus.h"
+
+// Default clock of the simulated bus
+const unsigned int  K_I2C_SIM_DEFAULT_CLOCK         = 100000;
+// Number of 7 bits I2C addresses
+const unsigned int  K_I2C_SIM_NB_ADDRES             = 128;
+// Bits on the wire for a byte and its acknowledge
+const unsigned int  K_I2C_SIM_BITS_PER_BYTE         = 9;
+
+// A device connected to the simulated bus
+class I2cSimDevice{
+    public:
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~I2cSimDevice();
+
+        //---------------------------------------------------
+        /**
+          * start : the device is addressed by a START or a repeated START
+          *
+          * @param isRead if true, the master will read
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void start(bool isRead, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * writeByte : the device receives a byte
+          *
+          * @param szData is the received byte
+          * @param nTime is the virtual time in ns of the acknowledge
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeByte(unsigned char szData, unsigned long long nTime) = 0;
+
+        //---------------------------------------------------
+        /**
+          * readByte : the device sends a byte
+          *
+          * @param nTime is the virtual time in ns of the first bit
+          * @return the sent byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readByte(unsigned long long nTime) = 0;
+
+        //---------------------------------------------------
+        /**
+          * stop : a STOP ends the transfer with the device
+          *
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void stop(unsigned long long nTime);
+};
+
+// Counters of the simulated bus
+struct I2cSimStats{
+    // Syscalls a real bus would need: single transfers and transactions
+    unsigned long long nTransfers;
+    // START and repeated START conditions
+    unsigned long long nMessages;
+    unsigned long long nBytesWritten;
+    unsigned long long nBytesRead;
+    // Calls to delay() and the time they took
+    unsigned long long nDelays;
+    unsigned long long nDelayTime;
+    // Time spent on the wire in ns
+    unsigned long long nBusTime;
+};
+
+class SimulatedBus : public I2cBus{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param nClock is the SCL frequency in Hz
+          *
+          * The bus runs in virtual time: transfers advance the time according
+          * to the clock and delay() does not sleep
+        */
+        //---------------------------------------------------
+        SimulatedBus(unsigned int nClock = K_I2C_SIM_DEFAULT_CLOCK);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~SimulatedBus();
+
+        //---------------------------------------------------
+        /**
+          * init : Init the bus
+          *
+        */
+        //---------------------------------------------------
+        virtual void init();
+
+        //---------------------------------------------------
+        /**
+          * isDeviceUp :
+          *
+          * @return true if the bus was initialized
+        */
+        //---------------------------------------------------
+        virtual bool isDeviceUp(){ return m_isDeviceInitialized;}
+
+        //---------------------------------------------------
+        /**
+          * attach : connect a device to the bus
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pDevice is the device, NULL to disconnect
+          * @note the bus does not own the device
+          *
+        */
+        //---------------------------------------------------
+        void attach(unsigned char szAddres, I2cSimDevice* pDevice);
+
+        //---------------------------------------------------
+        /**
+          * setClock : change the SCL frequency
+          *
+          * @param nClock is the frequency in Hz
+          *
+        */
+        //---------------------------------------------------
+        void setClock(unsigned int nClock);
+
+        //---------------------------------------------------
+        /**
+          * getClock :
+          *
+          * @return the SCL frequency in Hz
+        */
+        //---------------------------------------------------
+        inline unsigned int getClock(){ return m_nClock;}
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the counters of the bus
+        */
+        //---------------------------------------------------
+        inline const I2cSimStats& getStats(){ return m_stats;}
+
+        //---------------------------------------------------
+        /**
+          * resetStats : clear the counters of the bus
+          *
+        */
+        //---------------------------------------------------
+        void resetStats();
+
+        //---------------------------------------------------
+        /**
+          * write : write a byte to a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void write(unsigned char szAddres, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * read : read a byte from a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char read(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister8 : write 8 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister16 : write 16 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param nData is the data to write, low byte is sent first
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData);
+
+        //---------------------------------------------------
+        /**
+          * readRegister8 : read 8 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readRegister8(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * readRegister16 : read 16 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data, the first received byte is the low byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned int readRegister16(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * writeBlock : write several bytes to a device in one message
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write
+          * @param nLength is the number of bytes
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * beginTransaction : start to group the transfers
+          *
+          * @note grouped messages are joined by repeated STARTs
+          *
+        */
+        //---------------------------------------------------
+        virtual void beginTransaction();
+
+        //---------------------------------------------------
+        /**
+          * endTransaction : send the grouped transfers
+          *
+        */
+        //---------------------------------------------------
+        virtual void endTransaction();
+
+        //---------------------------------------------------
+        /**
+          * abortTransaction : leave a transaction without sending
+          *
+          * @note the simulated messages were already delivered
+          *
+        */
+        //---------------------------------------------------
+        virtual void abortTransaction();
+
+        //---------------------------------------------------
+        /**
+          * delay : advance the virtual time
+          *
+          * @param nMicroSeconds is the time to wait
+          *
+        */
+        //---------------------------------------------------
+        virtual void delay(unsigned int nMicroSeconds);
+
+        //---------------------------------------------------
+        /**
+          * getTime : get the virtual time of the bus
+          *
+          * @return the virtual time in nanoseconds
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getTime();
+
+        //---------------------------------------------------
+        /**
+          * getIoctlCount : get the number of syscalls done on the adapter
+          *
+          * @return the number of syscalls a real bus would need, reset by resetStats()
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getIoctlCount(){ return m_stats.nTransfers;}
+
+    private:
+        // Flag to know if operations are valid or not
+        bool m_isDeviceInitialized;
+
+        // Connected devices
+        I2cSimDevice* m_pDevices[K_I2C_SIM_NB_ADDRES];
+
+        // Device of the current message, NULL if the bus is free
+        I2cSimDevice* m_pCurrentDevice;
+
+        // SCL frequency and duration of a bit in ns
+        unsigned int m_nClock;
+        unsigned long long m_nBitTime;
+
+        // Virtual time in ns
+        unsigned long long m_nTime;
+
+        // Nesting level of the transactions
+        unsigned int m_nTransactionDepth;
+
+        // Counters
+        I2cSimStats m_stats;
+
+        //---------------------------------------------------
+        /**
+          * startMessage : START or repeated START, then the addres byte
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param isRead if true, the master will read
+          *
+        */
+        //---------------------------------------------------
+        void startMessage(unsigned char szAddres, bool isRead);
+
+        //---------------------------------------------------
+        /**
+          * sendByte : send a byte to the device of the current message
+          *
+          * @param szData is the data to send
+          *
+        */
+        //---------------------------------------------------
+        void sendByte(unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * receiveByte : receive a byte from the device of the current message
+          *
+          * @return the received data
+          *
+        */
+        //---------------------------------------------------
+        unsigned char receiveByte();
+
+        //---------------------------------------------------
+        /**
+          * endMessage : STOP the transfer unless a transaction is running
+          *
+        */
+        //---------------------------------------------------
+        void endMessage();
+
+        //---------------------------------------------------
+        /**
+          * stopTransfer : STOP condition
+          *
+        */
+        //---------------------------------------------------
+        void stopTransfer();
+};
@@ -0,0 +1,228 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: WiringPiBus.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <wiringPiI2C.h>
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "WiringPiBus.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  *
+  * Transfers are done with the wiringPiI2C functions,
+  * one file descriptor is opened per device
+*/
+//---------------------------------------------------
+WiringPiBus::WiringPiBus(){
+    unsigned int nI;
+    for(nI = 0; nI < K_I2C_NB_ADDRES; nI++){
+        m_nDeviceFD[nI] = -1;
+    }
+    m_nIoctls = 0;
+    m_isDeviceInitialized = false;
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+WiringPiBus::~WiringPiBus(){
+    unsigned int nI;
+    for(nI = 0; nI < K_I2C_NB_ADDRES; nI++){
+        if(-1 != m_nDeviceFD[nI]){
+            close(m_nDeviceFD[nI]);
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * init : Init the bus
+  *
+*/
+//---------------------------------------------------
+void
+WiringPiBus::init(){
+    m_isDeviceInitialized = true;
+}
+
+//---------------------------------------------------
+/**
+  * write : write a byte to a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+WiringPiBus::write(unsigned char szAddres, unsigned char szData){
+    int nRes;
+    nRes = wiringPiI2CWrite(getDeviceFD(szAddres),szData);
+    if(0 != nRes){
+        throw std::runtime_error("[Error] i2c write error");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * read : read a byte from a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+WiringPiBus::read(unsigned char szAddres){
+    int nRes;
+    nRes = wiringPiI2CRead(getDeviceFD(szAddres));
+    if(nRes < 0){
+        throw std::runtime_error("[Error] i2c read error");
+    }
+    return (unsigned char)nRes;
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister8 : write 8 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param szData is the data to write
+  *
+*/
+//---------------------------------------------------
+void
+WiringPiBus::writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData){
+    int nRes;
+    nRes = wiringPiI2CWriteReg8(getDeviceFD(szAddres),szRegister,szData);
+    if(0 != nRes){
+        throw std::runtime_error("[Error] i2c 8 bits register write error");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writeRegister16 : write 16 bits data into a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to write
+  * @param nData is the data to write, low byte is sent first
+  *
+*/
+//---------------------------------------------------
+void
+WiringPiBus::writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData){
+    int nRes;
+    nRes = wiringPiI2CWriteReg16(getDeviceFD(szAddres),szRegister,nData);
+    if(0 != nRes){
+        throw std::runtime_error("[Error] i2c 16 bits register write error");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readRegister8 : read 8 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data
+  *
+*/
+//---------------------------------------------------
+unsigned char
+WiringPiBus::readRegister8(unsigned char szAddres, unsigned char szRegister){
+    int nRes;
+    nRes = wiringPiI2CReadReg8(getDeviceFD(szAddres),szRegister);
+    if(nRes < 0){
+        throw std::runtime_error("[Error] i2c 8 bits register read error");
+    }
+    return (unsigned char)nRes;
+}
+
+//---------------------------------------------------
+/**
+  * readRegister16 : read 16 bits data from a register
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param szRegister is the register to read
+  * @return the read data, the first received byte is the low byte
+  *
+*/
+//---------------------------------------------------
+unsigned int
+WiringPiBus::readRegister16(unsigned char szAddres, unsigned char szRegister){
+    int nRes;
+    nRes = wiringPiI2CReadReg16(getDeviceFD(szAddres),szRegister);
+    if(nRes < 0){
+        throw std::runtime_error("[Error] i2c 16 bits register read error");
+    }
+    return (unsigned int)nRes;
+}
+
+//---------------------------------------------------
+/**
+  * writeBlock : write several bytes to a device in one message
+  *
+  * @param szAddres is the I2C addres of the device
+  * @param pData is the data to write
+  * @param nLength is the number of bytes
+  *
+*/
+//---------------------------------------------------
+void
+WiringPiBus::writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength){
+    ssize_t nRes;
+    // A plain write on the file descriptor is a single message
+    nRes = ::write(getDeviceFD(szAddres), pData, nLength);
+    if((ssize_t)nLength != nRes){
+        throw std::runtime_error("[Error] i2c block write error");
+    }
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * getDeviceFD : get the file descriptor of a device
+  *
+  * @param szAddres is the I2C addres of the device
+  * @return the file descriptor
+  * @note the device is opened the first time it is used
+  *
+*/
+//---------------------------------------------------
+int
+WiringPiBus::getDeviceFD(unsigned char szAddres){
+    if(false == m_isDeviceInitialized){
+        throw std::runtime_error("[Error] i2c bus not initialized");
+    }
+    if(szAddres >= K_I2C_NB_ADDRES){
+        throw std::invalid_argument("[Error] i2c addres out of range");
+    }
+    if(-1 == m_nDeviceFD[szAddres]){
+        m_nDeviceFD[szAddres] = wiringPiI2CSetup(szAddres);
+        if(-1 == m_nDeviceFD[szAddres]){
+            throw std::runtime_error("[Error] i2c device setup error");
+        }
+    }
+    // The caller does a single transfer with it
+    m_nIoctls++;
+    return m_nDeviceFD[szAddres];
+}
@@ -0,0 +1,170 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: WiringPiBus.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "I2cBus.h"
+
+// Number of 7 bits I2C addresses
+const unsigned int  K_I2C_NB_ADDRES                 = 128;
+
+class WiringPiBus : public I2cBus{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          *
+          * Transfers are done with the wiringPiI2C functions,
+          * one file descriptor is opened per device
+        */
+        //---------------------------------------------------
+        WiringPiBus();
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~WiringPiBus();
+
+        //---------------------------------------------------
+        /**
+          * init : Init the bus
+          *
+        */
+        //---------------------------------------------------
+        virtual void init();
+
+        //---------------------------------------------------
+        /**
+          * isDeviceUp :
+          *
+          * @return true if the bus was initialized
+        */
+        //---------------------------------------------------
+        virtual bool isDeviceUp(){ return m_isDeviceInitialized;}
+
+        //---------------------------------------------------
+        /**
+          * write : write a byte to a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void write(unsigned char szAddres, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * read : read a byte from a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char read(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister8 : write 8 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param szData is the data to write
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister8(unsigned char szAddres, unsigned char szRegister, unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * writeRegister16 : write 16 bits data into a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to write
+          * @param nData is the data to write, low byte is sent first
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeRegister16(unsigned char szAddres, unsigned char szRegister, unsigned int nData);
+
+        //---------------------------------------------------
+        /**
+          * readRegister8 : read 8 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char readRegister8(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * readRegister16 : read 16 bits data from a register
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param szRegister is the register to read
+          * @return the read data, the first received byte is the low byte
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned int readRegister16(unsigned char szAddres, unsigned char szRegister);
+
+        //---------------------------------------------------
+        /**
+          * writeBlock : write several bytes to a device in one message
+          *
+          * @param szAddres is the I2C addres of the device
+          * @param pData is the data to write
+          * @param nLength is the number of bytes
+          *
+        */
+        //---------------------------------------------------
+        virtual void writeBlock(unsigned char szAddres, const unsigned char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * getIoctlCount : get the number of syscalls done on the adapter
+          *
+          * @return the number of syscalls since the bus was created
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned long long getIoctlCount(){ return m_nIoctls;}
+
+    private:
+        // Flag to know if operations are valid or not
+        bool m_isDeviceInitialized;
+
+        // File descriptor of each device, -1 if not opened yet
+        int m_nDeviceFD[K_I2C_NB_ADDRES];
+
+        // Number of wiringPiI2C transfers, each one is a syscall
+        unsigned long long m_nIoctls;
+
+        //---------------------------------------------------
+        /**
+          * getDeviceFD : get the file descriptor of a device
+          *
+          * @param szAddres is the I2C addres of the device
+          * @return the file descriptor
+          * @note the device is opened the first time it is used
+          *
+        */
+        //---------------------------------------------------
+        int getDeviceFD(unsigned char szAddres);
+};
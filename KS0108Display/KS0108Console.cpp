@@ -0,0 +1,219 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Console.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "KS0108Console.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param display is the initialized display to write to
+  *
+  * The console scrolls with the start line register, each new line
+  * only redraws the page that enters the screen
+  * @note the screen is not cleared, call clear() before the first write
+*/
+//---------------------------------------------------
+KS0108Console::KS0108Console(KS0108Display& display){
+    m_pDisplay          = &display;
+    m_szTopPage         = 0;
+    m_szRow             = 0;
+    m_szCol             = 0;
+    m_isNewLinePending  = false;
+    m_szTextCol         = 0;
+    m_szTextLength      = 0;
+    memset(m_szText, 0, sizeof(m_szText));
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+KS0108Console::~KS0108Console(){
+}
+
+//---------------------------------------------------
+/**
+  * clear : clear the screen and move the cursor to the top left corner
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::clear(){
+    // cls() also moves the start line back to 0
+    m_pDisplay->cls();
+    m_szTopPage         = 0;
+    m_szRow             = 0;
+    m_szCol             = 0;
+    m_isNewLinePending  = false;
+    m_szTextCol         = 0;
+    m_szTextLength      = 0;
+}
+
+//---------------------------------------------------
+/**
+  * write : append a stream of bytes to the console
+  *
+  * @param pData is the pointer at the data to write
+  * @param nLength is the number of bytes to write
+  * @note lines are wrapped at K_KS0108_CONSOLE_COLS, '\n', '\r' and '\t' are handled,
+  *       other control characters are ignored
+  * @note the panel is updated once per call, unless the display is in retained mode
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::write(const char* pData, unsigned int nLength){
+    unsigned int nI;
+    bool isRetained;
+
+    if(NULL == pData){
+        throw std::invalid_argument("[Error] write NULL data");
+    }
+    if(false == m_pDisplay->isDeviceUp()){
+        return;
+    }
+
+    // Pages are only sent once all the bytes are in the frame buffer
+    isRetained = m_pDisplay->isRetainedMode();
+    m_pDisplay->setRetainedMode(true);
+    try{
+        for(nI = 0; nI < nLength; nI++){
+            putChar((unsigned char)pData[nI]);
+        }
+        drawText();
+        // In retained mode the scroll is sent by flush() after the new rows
+        m_pDisplay->setStartLine(m_szTopPage * K_KS0108_PAGES_PER_CTRL);
+    }catch(...){
+        m_pDisplay->setRetainedMode(isRetained);
+        throw;
+    }
+    // The new rows then the scroll are sent unless the caller keeps them for its own flush()
+    m_pDisplay->setRetainedMode(isRetained);
+}
+
+//---------------------------------------------------
+/**
+  * print : append a string to the console
+  *
+  * @param pData is the pointer at the string to write
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::print(const char* pData){
+    if(NULL != pData){
+        write(pData, strlen(pData));
+    }else{
+        throw std::invalid_argument("[Error] print NULL data");
+    }
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * putChar : append a single byte to the console
+  *
+  * @param szChar is the byte to append
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::putChar(unsigned char szChar){
+    switch(szChar){
+        case '\n':
+            // The row is only created when something is written on it,
+            // so the last line of a log stays on the bottom row
+            drawText();
+            if(true == m_isNewLinePending){
+                newLine();
+            }
+            m_isNewLinePending = true;
+            return;
+
+        case '\r':
+            drawText();
+            m_szCol = 0;
+            return;
+
+        case '\t':
+            do{
+                putChar(' ');
+            }while((0 != (m_szCol % K_KS0108_CONSOLE_TAB_SIZE)) && (m_szCol < K_KS0108_CONSOLE_COLS));
+            return;
+    }
+
+    if(szChar >= 0x80){
+        // Only the first byte of an UTF-8 sequence is displayed
+        if(szChar < 0xC0){
+            return;
+        }
+        szChar = K_KS0108_CONSOLE_UNKNOWN_CHAR;
+    }else if((szChar < K_KS0108_CONSOLE_FIRST_CHAR) || (szChar > K_KS0108_CONSOLE_LAST_CHAR)){
+        return;
+    }
+
+    // Wrap long lines
+    if((true == m_isNewLinePending) || (m_szCol >= K_KS0108_CONSOLE_COLS)){
+        drawText();
+        newLine();
+        m_isNewLinePending = false;
+    }
+    if(0 == m_szTextLength){
+        m_szTextCol = m_szCol;
+    }
+    m_szText[m_szTextLength++] = szChar;
+    m_szCol++;
+}
+
+//---------------------------------------------------
+/**
+  * newLine : move the cursor at the beginning of the next row
+  *
+  * @note when the cursor is on the last row, the screen is scrolled up
+  *       and the page entering the screen is cleared
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::newLine(){
+    if(m_szRow < K_KS0108_CONSOLE_ROWS - 1){
+        m_szRow++;
+    }else{
+        // The top page leaves the screen and comes back as the bottom row
+        m_szTopPage = (m_szTopPage + 1) % K_KS0108_PAGES_PER_CTRL;
+    }
+    m_szCol = 0;
+    m_pDisplay->fillPage(getPage(m_szRow), 0x00);
+}
+
+//---------------------------------------------------
+/**
+  * drawText : draw the characters not yet drawn on the current row
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Console::drawText(){
+    if(m_szTextLength > 0){
+        m_szText[m_szTextLength] = 0;
+        m_pDisplay->displayStringAtPosition(m_szText, getPage(m_szRow), m_szTextCol);
+        m_szTextLength = 0;
+    }
+}
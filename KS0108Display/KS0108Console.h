@@ -0,0 +1,141 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Console.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "KS0108Display.h"
+
+// Text grid of the console with the default 5x8 font
+const unsigned char K_KS0108_CONSOLE_COLS           = (K_KS0108_SCREEN_WIDTH / K_KS0108_X_PIXEL_PER_CHAR);
+const unsigned char K_KS0108_CONSOLE_ROWS           = K_KS0108_PAGES_PER_CTRL;
+const unsigned char K_KS0108_CONSOLE_TAB_SIZE       = 4;
+// Printable range of the default font, DEL is a control character
+const unsigned char K_KS0108_CONSOLE_FIRST_CHAR     = 0x20;
+const unsigned char K_KS0108_CONSOLE_LAST_CHAR      = 0x7E;
+// Displayed in place of the characters the font does not have
+const unsigned char K_KS0108_CONSOLE_UNKNOWN_CHAR   = '?';
+
+class KS0108Console{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param display is the initialized display to write to
+          *
+          * The console scrolls with the start line register, each new line
+          * only redraws the page that enters the screen
+          * @note the screen is not cleared, call clear() before the first write
+        */
+        //---------------------------------------------------
+        KS0108Console(KS0108Display& display);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~KS0108Console();
+
+        //---------------------------------------------------
+        /**
+          * clear : clear the screen and move the cursor to the top left corner
+          *
+        */
+        //---------------------------------------------------
+        void clear();
+
+        //---------------------------------------------------
+        /**
+          * write : append a stream of bytes to the console
+          *
+          * @param pData is the pointer at the data to write
+          * @param nLength is the number of bytes to write
+          * @note lines are wrapped at K_KS0108_CONSOLE_COLS, '\n', '\r' and '\t' are handled,
+          *       other control characters are ignored
+          * @note the panel is updated once per call, unless the display is in retained mode
+          *
+        */
+        //---------------------------------------------------
+        void write(const char* pData, unsigned int nLength);
+
+        //---------------------------------------------------
+        /**
+          * print : append a string to the console
+          *
+          * @param pData is the pointer at the string to write
+          *
+        */
+        //---------------------------------------------------
+        void print(const char* pData);
+
+    private:
+        // Display used by the console
+        KS0108Display* m_pDisplay;
+
+        // Page of the display RAM shown on the top row
+        unsigned char m_szTopPage;
+
+        // Cursor position on the screen
+        unsigned char m_szRow;
+        unsigned char m_szCol;
+
+        // A new line was received, it is started by the next character
+        bool m_isNewLinePending;
+
+        // Characters of the current row not yet drawn
+        char m_szText[K_KS0108_CONSOLE_COLS + 1];
+        // Column of the first character not yet drawn
+        unsigned char m_szTextCol;
+        // Number of characters not yet drawn
+        unsigned char m_szTextLength;
+
+        //---------------------------------------------------
+        /**
+          * putChar : append a single byte to the console
+          *
+          * @param szChar is the byte to append
+          *
+        */
+        //---------------------------------------------------
+        void putChar(unsigned char szChar);
+
+        //---------------------------------------------------
+        /**
+          * newLine : move the cursor at the beginning of the next row
+          *
+          * @note when the cursor is on the last row, the screen is scrolled up
+          *       and the page entering the screen is cleared
+          *
+        */
+        //---------------------------------------------------
+        void newLine();
+
+        //---------------------------------------------------
+        /**
+          * drawText : draw the characters not yet drawn on the current row
+          *
+        */
+        //---------------------------------------------------
+        void drawText();
+
+        //---------------------------------------------------
+        /**
+          * getPage : get the page of the display RAM shown on a row
+          *
+          * @param szRow is the row of the screen
+          * @return the page of the display RAM
+          *
+        */
+        //---------------------------------------------------
+        inline unsigned char getPage(unsigned char szRow){ return (m_szTopPage + szRow) % K_KS0108_PAGES_PER_CTRL;}
+};
@@ -12,13 +12,15 @@
  *--------------------------------------------------------
  */
 
-#include <wiringPiI2C.h>
 #include <exception>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
+#include <math.h>
 #include "KS0108Display.h"
+#include "KS0108TransferPlanner.h"
+#include "../I2cBus/I2cProfiler.h"
 #include "font5x8.h"
 #include "corsiva_12.h"
 #include "arial_bold_14.h"
@@ -26,20 +28,41 @@
 //---------------------------------------------------
 /**
   * Constructor
+  * @param bus is the I2C bus the PCF8574 are connected to
   * @param szDataAddres is the I2C addres of the device for Data Port
   * @param szCmdAddres is the I2C addres of the device for Command Port
   *
   * Interface is done with two PCF8574
 */
 //---------------------------------------------------
-KS0108Display::KS0108Display(unsigned char szDataAddres, unsigned char szCmdAddres){
+KS0108Display::KS0108Display(I2cBus& bus, unsigned char szDataAddres, unsigned char szCmdAddres){
+    m_pBus                  = &bus;
     m_szDataAddres          = szDataAddres;
     m_szCmdAddres           = szCmdAddres;
     m_szCmd                 = 0;
     m_szData                = 0;
     m_szPosX                = 0;
     m_szPosY                = 0;
+    m_szCursorX             = 0;
+    m_szCursorPage          = 0;
     m_isDeviceInitialized   = false;
+    m_isRetainedMode        = false;
+    m_isTrustedTiming       = false;
+    m_nDataLatch            = K_KS0108_UNKNOWN_LATCH;
+    m_nCmdLatch             = K_KS0108_UNKNOWN_LATCH;
+    m_szNextStartLine       = 0;
+    memset(m_szFrameBuffer, 0, sizeof(m_szFrameBuffer));
+    memset(m_szPanelBuffer, 0, sizeof(m_szPanelBuffer));
+    memset(m_isPageLoaded, 0, sizeof(m_isPageLoaded));
+    memset(m_isPageSynced, 0, sizeof(m_isPageSynced));
+    memset(m_szPlotMask, 0, sizeof(m_szPlotMask));
+    m_nPlotXMin             = K_KS0108_SCREEN_WIDTH;
+    m_nPlotXMax             = -1;
+    m_nPlotPageMin          = K_KS0108_PAGES_PER_CTRL;
+    m_nPlotPageMax          = -1;
+    m_pPlanner              = new KS0108TransferPlanner();
+    clearDirty();
+    invalidateRegisters();
 }
 
 //---------------------------------------------------
@@ -48,6 +71,7 @@ KS0108Display::KS0108Display(unsigned char szDataAddres, unsigned char szCmdAddr
 */
 //---------------------------------------------------
 KS0108Display::~KS0108Display(){
+    delete(m_pPlanner);
 }
 
 //---------------------------------------------------
@@ -58,27 +82,24 @@ KS0108Display::~KS0108Display(){
 //---------------------------------------------------
 void
 KS0108Display::init(){
+    M_I2C_PROFILE_SCOPE("KS0108Display::init")
     // Setup the device
-    unsigned char szI;
-    m_nDeviceDataFD = wiringPiI2CSetup (m_szDataAddres);
-    m_nDeviceCmdFD = wiringPiI2CSetup (m_szCmdAddres);
-    if(( -1 != m_nDeviceDataFD) && (-1 != m_nDeviceCmdFD)){
+    if(true == m_pBus->isDeviceUp()){
         try{
             m_szCmd = (K_KS0108_RS_MASK | K_KS0108_RW_MASK | K_KS0108_EN_MASK | K_KS0108_CS1_MASK | K_KS0108_CS2_MASK | K_KS0108_RST_MASK);
-            writei2c(m_nDeviceCmdFD,m_szCmd);
-            usleep(10);
+            writei2c(m_szCmdAddres,m_szCmd);
+            m_pBus->delay(10);
             // Remove RST
             m_szCmd &= ~K_KS0108_RST_MASK;
-            writei2c(m_nDeviceCmdFD,m_szCmd);
-            usleep(10);
+            writei2c(m_szCmdAddres,m_szCmd);
+            m_pBus->delay(10);
             m_szCmd |= K_KS0108_RST_MASK;
-            writei2c(m_nDeviceCmdFD,m_szCmd);
+            writei2c(m_szCmdAddres,m_szCmd);
+            invalidateRegisters();
             // Controls the display ON for all controllers
             // D7 D6 D5 D4 D3 D2 D1 D0
             //  0  0  1  1  1  1  1 0/1
-            for(szI = 0; szI < K_KS0108_NB_CTRL; szI++){
-                writeCommand((K_KS0108_DISPLAY_ON_CMD | K_KS0108_ON), szI);
-            }
+            writeCommand((K_KS0108_DISPLAY_ON_CMD | K_KS0108_ON), K_KS0108_ALL_CTRL);
 
             m_isDeviceInitialized = true;
         }catch(std::exception const& e){
@@ -95,24 +116,24 @@ KS0108Display::init(){
 //---------------------------------------------------
 void
 KS0108Display::cls(){
+    M_I2C_PROFILE_SCOPE("KS0108Display::cls")
 
     // Sanity check
     M_KS0108_IS_DEVICE_UP
 
     unsigned char szPages;
-    unsigned char szPixel;
 
     // Clear LCD
     // Browse all pages
     for(szPages = 0; szPages < K_KS0108_PAGES_PER_CTRL; szPages++){
-        // Set page address
-        setAddress(0,szPages);
         // Clear all lines of this page of display memory
-        for(szPixel = 0; szPixel< K_KS0108_SCREEN_WIDTH; szPixel++){
-            writeData(0x00);
-        }
+        memset(m_szFrameBuffer[szPages], 0, K_KS0108_SCREEN_WIDTH);
+        // The page content is now known without reading the panel
+        m_isPageLoaded[szPages] = true;
+        markDirty(0, K_KS0108_SCREEN_WIDTH - 1, szPages);
     }
     setHome();
+    update();
 }
 
 //---------------------------------------------------
@@ -127,12 +148,14 @@ KS0108Display::cls(){
 //---------------------------------------------------
 void
 KS0108Display::displayStringAtPosition(const char* pData, unsigned char szLine, unsigned char szCol){
+    M_I2C_PROFILE_SCOPE("KS0108Display::displayStringAtPosition")
 
     // Sanity check
     M_KS0108_IS_DEVICE_UP
 
     setCursorAtPosition(szLine,szCol);
-    displayString(pData);
+    displayString(pData, NULL, m_szCursorX, m_szCursorPage * K_KS0108_PIXELS_PER_PAGE, true);
+    update();
 }
 
 //---------------------------------------------------
@@ -148,23 +171,61 @@ KS0108Display::displayStringAtPosition(const char* pData, unsigned char szLine,
 //---------------------------------------------------
 void
 KS0108Display::displayStringWithFontAtPosition(const char* pData, unsigned char szFont, unsigned char szLine, unsigned char szCol){
+    M_I2C_PROFILE_SCOPE("KS0108Display::displayStringWithFontAtPosition")
 
     // Sanity check
     M_KS0108_IS_DEVICE_UP
 
     setCursorAtPosition(szLine,szCol);
-    switch(szFont){
-        case 0:
-            displayString(pData,Corsiva_12);
-            break;
+    displayString(pData, getFont(szFont), m_szCursorX, m_szCursorPage * K_KS0108_PIXELS_PER_PAGE, true);
+    update();
+}
 
-        case 1:
-            displayString(pData,Arial_Bold_14);
-            break;
+//---------------------------------------------------
+/**
+  * displayStringAtPixel : display a string at the given pixel position
+  *
+  * @param pData is the pointer the data to write
+  * @param szX is the X coord of the top left corner
+  * @param szY is the Y coord of the top left corner
+  * @note only the pixels of the font height are modified, the text is clipped at the screen edges
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::displayStringAtPixel(const char* pData, unsigned char szX, unsigned char szY){
+    M_I2C_PROFILE_SCOPE("KS0108Display::displayStringAtPixel")
 
-        default:
-            displayString(pData);
-            break;
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    displayStringWithFontAtPixel(pData, K_KS0108_DEFAULT_FONT, szX, szY);
+}
+
+//---------------------------------------------------
+/**
+  * displayStringWithFontAtPixel : display a string at the given pixel position with the given font
+  *
+  * @param pData is the pointer the data to write
+  * @param szFont is the font number (0=Corsiva12, 1=Arial Bold)
+  * @param szX is the X coord of the top left corner
+  * @param szY is the Y coord of the top left corner
+  * @note only the pixels of the font height are modified, the text is clipped at the screen edges
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::displayStringWithFontAtPixel(const char* pData, unsigned char szFont, unsigned char szX, unsigned char szY){
+    M_I2C_PROFILE_SCOPE("KS0108Display::displayStringWithFontAtPixel")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    if((szX < K_KS0108_SCREEN_WIDTH) && (szY < K_KS0108_SCREEN_HEIGHT)){
+        displayString(pData, getFont(szFont), szX, szY, false);
+        update();
+    }else{
+        throw std::invalid_argument("[Error] displayStringWithFontAtPixel arg out of range");
     }
 }
 
@@ -176,27 +237,96 @@ KS0108Display::displayStringWithFontAtPosition(const char* pData, unsigned char
   * @param szY is the Y coord
   * @param szL is the lenght
   * @param szW is the width
+  * @note the rectangle is clipped at the screen edges
   *
 */
 //---------------------------------------------------
 void
 KS0108Display::drawRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawRect")
 
     // Sanity check
     M_KS0108_IS_DEVICE_UP
 
-    unsigned char szIndex;
-
-    // First draw vertical lines of both sides
-    for (szIndex = 0; szIndex < szW; szIndex++) {
-        setPixel(szX, szY + szIndex);
-        setPixel(szX + szL - 1, szY + szIndex);
-    }
-    // First szIndex horizontal lines of both sides
-    for (szIndex = 0; szIndex < szL; szIndex++) {
-        setPixel(szX + szIndex, szY);
-        setPixel(szX + szIndex, szY + szW - 1);
+    if((0 == szL) || (0 == szW)){
+        return;
     }
+    // First draw vertical lines of both sides
+    drawVLine(szX, szY, szY + szW - 1);
+    drawVLine(szX + szL - 1, szY, szY + szW - 1);
+    // Then horizontal lines of both sides
+    drawHLine(szX, szX + szL - 1, szY);
+    drawHLine(szX, szX + szL - 1, szY + szW - 1);
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * fillRect : set all the pixels of a rectangle
+  *
+  * @param szX is the X coord
+  * @param szY is the Y coord
+  * @param szL is the lenght
+  * @param szW is the width
+  * @note the rectangle is clipped at the screen edges
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    M_I2C_PROFILE_SCOPE("KS0108Display::fillRect")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    fillArea(szX, szY, szX + szL - 1, szY + szW - 1, 0xFF, K_KS0108_ROP_COPY);
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * clearRect : clear all the pixels of a rectangle
+  *
+  * @param szX is the X coord
+  * @param szY is the Y coord
+  * @param szL is the lenght
+  * @param szW is the width
+  * @note the rectangle is clipped at the screen edges
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::clearRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    M_I2C_PROFILE_SCOPE("KS0108Display::clearRect")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    fillArea(szX, szY, szX + szL - 1, szY + szW - 1, 0x00, K_KS0108_ROP_COPY);
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * invertRect : invert all the pixels of a rectangle
+  *
+  * @param szX is the X coord
+  * @param szY is the Y coord
+  * @param szL is the lenght
+  * @param szW is the width
+  * @note the rectangle is clipped at the screen edges
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::invertRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    M_I2C_PROFILE_SCOPE("KS0108Display::invertRect")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    fillArea(szX, szY, szX + szL - 1, szY + szW - 1, 0xFF, K_KS0108_ROP_XOR);
+    update();
 }
 
 //---------------------------------------------------
@@ -207,27 +337,762 @@ KS0108Display::drawRect(unsigned char szX, unsigned char szY, unsigned char szL,
   * @param szYo is the Y coord of the origin
   * @param szXd is the X coord of the destination
   * @param szYd is the Y coord of the destination
+  * @note the pixels outside of the screen are dropped
   *
 */
 //---------------------------------------------------
 void
 KS0108Display::drawLine(unsigned char szXo, unsigned char szYo, unsigned char szXd, unsigned char szYd){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawLine")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    // Straight lines are drawn with the span kernels
+    if(szYo == szYd){
+        drawHLine((szXo < szXd) ? szXo : szXd, (szXo < szXd) ? szXd : szXo, szYo);
+        update();
+        return;
+    }
+    if(szXo == szXd){
+        drawVLine(szXo, (szYo < szYd) ? szYo : szYd, (szYo < szYd) ? szYd : szYo);
+        update();
+        return;
+    }
+
+    // Pixels of the same column byte are merged into a single write
+    plotLine(szXo, szYo, szXd, szYd);
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * drawCircle : draw a circle
+  *
+  * @param szXc is the X coord of the center
+  * @param szYc is the Y coord of the center
+  * @param szR is the radius
+  * @note the pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::drawCircle(unsigned char szXc, unsigned char szYc, unsigned char szR){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawCircle")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    // Midpoint algorithm on the first octant, the 7 others are mirrored
+    int nX = szR;
+    int nY = 0;
+    int nError = 1 - nX;
+
+    while(nX >= nY){
+        plotPixel(szXc + nX, szYc + nY);
+        plotPixel(szXc - nX, szYc + nY);
+        plotPixel(szXc + nX, szYc - nY);
+        plotPixel(szXc - nX, szYc - nY);
+        plotPixel(szXc + nY, szYc + nX);
+        plotPixel(szXc - nY, szYc + nX);
+        plotPixel(szXc + nY, szYc - nX);
+        plotPixel(szXc - nY, szYc - nX);
+        nY++;
+        if(nError < 0){
+            nError += 2 * nY + 1;
+        }else{
+            nX--;
+            nError += 2 * (nY - nX) + 1;
+        }
+    }
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * fillCircle : draw a filled circle
+  *
+  * @param szXc is the X coord of the center
+  * @param szYc is the Y coord of the center
+  * @param szR is the radius
+  * @note the pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillCircle(unsigned char szXc, unsigned char szYc, unsigned char szR){
+    M_I2C_PROFILE_SCOPE("KS0108Display::fillCircle")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    // Same walk as drawCircle, each point gives the span of its row
+    int nX = szR;
+    int nY = 0;
+    int nError = 1 - nX;
+
+    while(nX >= nY){
+        plotSpan(szXc - nX, szXc + nX, szYc + nY);
+        plotSpan(szXc - nX, szXc + nX, szYc - nY);
+        plotSpan(szXc - nY, szXc + nY, szYc + nX);
+        plotSpan(szXc - nY, szXc + nY, szYc - nX);
+        nY++;
+        if(nError < 0){
+            nError += 2 * nY + 1;
+        }else{
+            nX--;
+            nError += 2 * (nY - nX) + 1;
+        }
+    }
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * drawEllipse : draw an ellipse
+  *
+  * @param szXc is the X coord of the center
+  * @param szYc is the Y coord of the center
+  * @param szRx is the horizontal radius
+  * @param szRy is the vertical radius
+  * @note the pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::drawEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawEllipse")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    plotEllipse(szXc, szYc, szRx, szRy, false);
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * fillEllipse : draw a filled ellipse
+  *
+  * @param szXc is the X coord of the center
+  * @param szYc is the Y coord of the center
+  * @param szRx is the horizontal radius
+  * @param szRy is the vertical radius
+  * @note the pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy){
+    M_I2C_PROFILE_SCOPE("KS0108Display::fillEllipse")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    plotEllipse(szXc, szYc, szRx, szRy, true);
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * drawArc : draw an arc of circle
+  *
+  * @param szXc is the X coord of the center
+  * @param szYc is the Y coord of the center
+  * @param szR is the radius
+  * @param nStart is the angle of the first end in degrees, 0 is 3 o'clock, 90 is 12 o'clock
+  * @param nEnd is the angle of the last end, the arc goes counterclockwise from nStart to nEnd
+  * @note a sweep of 360 degrees or more draws the whole circle
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::drawArc(unsigned char szXc, unsigned char szYc, unsigned char szR, int nStart, int nEnd){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawArc")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    int nOctant, nPx, nPy;
+    int nX = szR;
+    int nY = 0;
+    int nError = 1 - nX;
+    int nSweep = nEnd - nStart;
+    bool isFull = (nSweep >= 360) || (nSweep <= -360);
+    bool isInside;
+
+    if(true == isFull){
+        drawCircle(szXc, szYc, szR);
+        return;
+    }
+    nSweep = ((nSweep % 360) + 360) % 360;
+
+    // Unit vectors of both ends, scaled by 1024, Y axis going up
+    int nStartX = (int)lround(cos(nStart * M_PI / 180.0) * 1024);
+    int nStartY = (int)lround(sin(nStart * M_PI / 180.0) * 1024);
+    int nEndX   = (int)lround(cos(nEnd * M_PI / 180.0) * 1024);
+    int nEndY   = (int)lround(sin(nEnd * M_PI / 180.0) * 1024);
+
+    while(nX >= nY){
+        for(nOctant = 0; nOctant < 8; nOctant++){
+            // Mirror the point of the first octant
+            nPx = (nOctant & 1) ? nY : nX;
+            nPy = (nOctant & 1) ? nX : nY;
+            nPx = (nOctant & 2) ? -nPx : nPx;
+            nPy = (nOctant & 4) ? -nPy : nPy;
+
+            // Position of the point relatively to both ends, nPy goes down on the screen
+            if(nSweep <= 180){
+                isInside = ((nStartX * -nPy - nStartY * nPx) >= 0) && ((nPx * nEndY - -nPy * nEndX) >= 0);
+            }else{
+                isInside = !(((nEndX * -nPy - nEndY * nPx) > 0) && ((nPx * nStartY - -nPy * nStartX) > 0));
+            }
+            if(true == isInside){
+                plotPixel(szXc + nPx, szYc + nPy);
+            }
+        }
+        nY++;
+        if(nError < 0){
+            nError += 2 * nY + 1;
+        }else{
+            nX--;
+            nError += 2 * (nY - nX) + 1;
+        }
+    }
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * fillPolygon : draw a filled polygon
+  *
+  * @param pPoints is the X and Y coords of each vertex, one after the other
+  * @param szNbPoints is the number of vertices, up to K_KS0108_MAX_POLYGON_POINTS
+  * @note the edges are part of the polygon, the pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillPolygon(const unsigned char* pPoints, unsigned char szNbPoints){
+    M_I2C_PROFILE_SCOPE("KS0108Display::fillPolygon")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    int nNodes[K_KS0108_MAX_POLYGON_POINTS];
+    int nNbNodes, nNode, nSorted, nTmp;
+    int nY, nYMin, nYMax;
+    int nXo, nYo, nXd, nYd;
+    unsigned char szI, szJ;
+
+    if((NULL == pPoints) || (szNbPoints > K_KS0108_MAX_POLYGON_POINTS)){
+        throw std::invalid_argument("[Error] fillPolygon arg out of range");
+    }
+    if(0 == szNbPoints){
+        return;
+    }
+
+    nYMin = nYMax = pPoints[1];
+    for(szI = 0; szI < szNbPoints; szI++){
+        nYMin = (pPoints[2 * szI + 1] < nYMin) ? pPoints[2 * szI + 1] : nYMin;
+        nYMax = (pPoints[2 * szI + 1] > nYMax) ? pPoints[2 * szI + 1] : nYMax;
+    }
+    nYMax = (nYMax >= K_KS0108_SCREEN_HEIGHT) ? K_KS0108_SCREEN_HEIGHT - 1 : nYMax;
+
+    // Scanline : the crossings of the row with the edges delimit the inner spans
+    for(nY = nYMin; nY <= nYMax; nY++){
+        nNbNodes = 0;
+        for(szI = 0, szJ = szNbPoints - 1; szI < szNbPoints; szJ = szI++){
+            nXo = pPoints[2 * szI];
+            nYo = pPoints[2 * szI + 1];
+            nXd = pPoints[2 * szJ];
+            nYd = pPoints[2 * szJ + 1];
+            // The lower end of an edge is excluded so that a vertex is not counted twice
+            if(((nYo <= nY) && (nYd > nY)) || ((nYd <= nY) && (nYo > nY))){
+                nNodes[nNbNodes++] = nXo + (nY - nYo) * (nXd - nXo) / (nYd - nYo);
+            }
+        }
+        // Few nodes, insertion sort
+        for(nNode = 1; nNode < nNbNodes; nNode++){
+            nTmp = nNodes[nNode];
+            for(nSorted = nNode; (nSorted > 0) && (nNodes[nSorted - 1] > nTmp); nSorted--){
+                nNodes[nSorted] = nNodes[nSorted - 1];
+            }
+            nNodes[nSorted] = nTmp;
+        }
+        for(nNode = 0; nNode + 1 < nNbNodes; nNode += 2){
+            plotSpan(nNodes[nNode], nNodes[nNode + 1], nY);
+        }
+    }
+    // The edges complete the spans on the rows the scanline skips
+    for(szI = 0, szJ = szNbPoints - 1; szI < szNbPoints; szJ = szI++){
+        plotLine(pPoints[2 * szJ], pPoints[2 * szJ + 1], pPoints[2 * szI], pPoints[2 * szI + 1]);
+    }
+    commitPlot();
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * drawBitmap : draw a bitmap
+  *
+  * @param pData is the bitmap, one byte per column and per page of 8 rows
+  * @param szX is the X coord of the origin
+  * @param szY is the page of the origin
+  * @param szDx is the width
+  * @param szDy is the height
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::drawBitmap(const unsigned char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy){
+    M_I2C_PROFILE_SCOPE("KS0108Display::drawBitmap")
+    blit(pData, szDx, szX, szY * K_KS0108_PIXELS_PER_PAGE, szDx, szDy, K_KS0108_ROP_COPY);
+}
+
+//---------------------------------------------------
+/**
+  * blit : draw a bitmap at any pixel position
+  *
+  * @param pData is the bitmap, one byte per column and per page of 8 rows, bit 0 is the top row
+  * @param nStride is the number of bytes between two pages of the bitmap
+  * @param nX is the X coord of the top left corner, may be outside of the screen
+  * @param nY is the Y coord of the top left corner, may be outside of the screen
+  * @param szDx is the width
+  * @param szDy is the height, the rows after it in the last page are ignored
+  * @param szRop is the raster operation (K_KS0108_ROP_COPY, OR, AND or XOR)
+  * @note the bitmap is clipped, each byte of the screen is computed once
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::blit(const unsigned char *pData, unsigned int nStride, int nX, int nY, unsigned char szDx, unsigned char szDy, unsigned char szRop){
+    M_I2C_PROFILE_SCOPE("KS0108Display::blit")
+    int nXFrom, nXTo, nPageFrom, nPageTo;
+    int nCol, nPage, nRow;
 
     // Sanity check
     M_KS0108_IS_DEVICE_UP
 
-    int nTwoDxAccumulatedError, nTwoDyAccumulatedError;
+    if(NULL == pData){
+        throw std::invalid_argument("[Error] blit NULL data");
+    }
+    if(szRop > K_KS0108_ROP_XOR){
+        throw std::invalid_argument("[Error] blit unknown raster operation");
+    }
+    if((0 == szDx) || (0 == szDy) || (nStride < szDx)){
+        return;
+    }
+
+    // Clip the bitmap against the screen
+    nXFrom      = (nX < 0) ? 0 : nX;
+    nXTo        = (nX + szDx > K_KS0108_SCREEN_WIDTH) ? K_KS0108_SCREEN_WIDTH - 1 : nX + szDx - 1;
+    nPageFrom   = (nY < 0) ? 0 : nY / K_KS0108_PIXELS_PER_PAGE;
+    nPageTo     = (nY + szDy > K_KS0108_SCREEN_HEIGHT) ? K_KS0108_PAGES_PER_CTRL - 1 : (nY + szDy - 1) / K_KS0108_PIXELS_PER_PAGE;
+
+    // Build each byte of the screen from the rows of the bitmap it covers
+    for(nPage = nPageFrom; nPage <= nPageTo; nPage++){
+        nRow = nPage * K_KS0108_PIXELS_PER_PAGE - nY;
+        for(nCol = nXFrom; nCol <= nXTo; nCol++){
+            mergeData(nCol, nPage,
+                      getBitmapRows(pData, nStride, nCol - nX, nRow, szDy),
+                      getBitmapRows(NULL, nStride, nCol - nX, nRow, szDy),
+                      szRop);
+        }
+    }
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * fillPage : fill a whole page with a pattern
+  *
+  * @param szPage is the page from 0 to 7
+  * @param szPattern is the byte written in every column of the page
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillPage(unsigned char szPage, unsigned char szPattern){
+    M_I2C_PROFILE_SCOPE("KS0108Display::fillPage")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    if(szPage < K_KS0108_PAGES_PER_CTRL){
+        memset(m_szFrameBuffer[szPage], szPattern, K_KS0108_SCREEN_WIDTH);
+        // The page content is now known without reading the panel
+        m_isPageLoaded[szPage] = true;
+        markDirty(0, K_KS0108_SCREEN_WIDTH - 1, szPage);
+        update();
+    }else{
+        throw std::invalid_argument("[Error] fillPage page out of range [0-7]");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * setStartLine : Indicate the display data RAM displayed at the top of the screen
+  *
+  * @param szStart is the position in the line from 0 to 63
+  * @note All controllers are affected by this operation,
+  *       in retained mode the scroll is sent by flush() after the drawings
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setStartLine(unsigned char szStart){
+    M_I2C_PROFILE_SCOPE("KS0108Display::setStartLine")
+    if(szStart < K_KS0108_X_PIXELS_PER_CTRL){
+        // The scroll must not reach the panel before the drawings still in the frame buffer
+        m_szNextStartLine = szStart;
+        update();
+    }else{
+        throw std::invalid_argument("[Error] setStartLine start out of range [0-63]");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * setRetainedMode : select when drawings are sent to the panel
+  *
+  * @param isRetained if true, drawings are kept in the frame buffer until flush() is called
+  *                   if false, each drawing is sent to the panel at once
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setRetainedMode(bool isRetained){
+    m_isRetainedMode = isRetained;
+    if(false == m_isRetainedMode){
+        update();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * flush : send the modified bytes of the frame buffer to the panel
+  *
+  * @note the bytes that differ from the panel content are written in the order
+  *       chosen by the transfer planner
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::flush(){
+    M_I2C_PROFILE_SCOPE("KS0108Display::flush")
+
+    // Sanity check
+    M_KS0108_IS_DEVICE_UP
+
+    unsigned char szPage;
+    unsigned char szPages = 0;
+    unsigned int nRun, nX, nI;
+    bool isBroadcast;
+    I2cTransaction transaction(m_pBus);
+
+    for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+        if(m_szDirtyMin[szPage] <= m_szDirtyMax[szPage]){
+            szPages |= (1 << szPage);
+        }
+    }
+
+    // The planner chooses when to write through unchanged bytes instead of
+    // jumping, and which columns can be written to all controllers at once
+    m_pPlanner->plan(m_szPanelBuffer, m_szFrameBuffer, m_isPageSynced, szPages);
+    try{
+        for(nRun = 0; nRun < m_pPlanner->getNbRuns(); nRun++){
+            const KS0108TransferRun& run = m_pPlanner->getRun(nRun);
+            isBroadcast = (K_KS0108_ALL_CTRL == run.szCtrl);
+            nX = run.szY + (isBroadcast ? 0 : run.szCtrl * K_KS0108_X_PIXELS_PER_CTRL);
+            setAddress(nX, run.szPage);
+            for(nI = 0; nI < run.szLength; nI++){
+                writeData(m_szFrameBuffer[run.szPage][nX + nI], isBroadcast);
+            }
+        }
+        syncStartLine();
+    }catch(std::exception const&){
+        // Some runs may have reached the panel, the queued ones are dropped
+        invalidatePanel(szPages);
+        throw;
+    }
+
+    // A page that was not synced is always fully planned
+    for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+        if(0 != (szPages & (1 << szPage))){
+            m_isPageSynced[szPage] = true;
+        }
+    }
+    transaction.commit();
+    clearDirty();
+}
+
+//---------------------------------------------------
+/**
+  * setTrustedTiming : select how the end of an operation is detected
+  *
+  * @param isTrusted if true, rely on the I2C bus latency instead of polling the busy flag
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setTrustedTiming(bool isTrusted){
+    m_isTrustedTiming = isTrusted;
+}
+
+//---------------------------------------------------
+/**
+  * calibrateTiming : check that the I2C bus latency covers the busy time of the controllers
+  *
+  * @return true if trusted timing can be used, false otherwise
+  * @note trusted timing is selected according to the result
+  *
+*/
+//---------------------------------------------------
+bool
+KS0108Display::calibrateTiming(){
+    M_I2C_PROFILE_SCOPE("KS0108Display::calibrateTiming")
+    unsigned char szCtrl;
+    unsigned char szI;
+    bool isTrusted = true;
+
+    // Sanity check
+    if(false == m_isDeviceInitialized){
+        return false;
+    }
+
+    m_isTrustedTiming = true;
+    // Send commands without waiting and check the controller is ready just after
+    for(szI = 0; (szI < K_KS0108_CALIBRATION_LOOPS) && (true == isTrusted); szI++){
+        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+            writeCommand((K_KS0108_DISPLAY_ON_CMD | K_KS0108_ON), szCtrl);
+            if(readStatus(szCtrl) & K_KS0108_DISPLAY_STATUS_BUSY){
+                isTrusted = false;
+            }
+        }
+    }
+    m_isTrustedTiming = isTrusted;
+    return isTrusted;
+}
+
+//---------------------------------------------------
+/**
+  * getTransferStats :
+  *
+  * @return the statistics of the transfers chosen by the last flush
+*/
+//---------------------------------------------------
+const KS0108TransferStats&
+KS0108Display::getTransferStats(){
+    return m_pPlanner->getStats();
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * drawChar : draw a char with the given font
+  *
+  * @param szC is the char to display
+  * @param font is the font to use
+  * @param nX is the X coord of the top left corner
+  * @param nY is the Y coord of the top left corner
+  * @param szHeight is the number of rows modified below nY
+  * @return the width of the char including the space after it
+  *
+*/
+//---------------------------------------------------
+unsigned char
+KS0108Display::drawChar(unsigned char szC, const KS0108Font& font, unsigned int nX, unsigned int nY, unsigned char szHeight){
+
+    unsigned char szI,szJ,szData,szMask;
+    unsigned char szWidth;
+    unsigned int nRows;
+    const unsigned char* pGlyph;
+
+    if ((szC < font.szFirstChar) || (szC >= font.szFirstChar + font.szCharCount)){
+         return 0;
+    }
+
+    szC -= font.szFirstChar;
+
+    // Offsets are computed at compile time, see KS0108Font.h
+    pGlyph  = font.pData + font.pOffsets[szC];
+    szWidth = font.pWidths[szC];
+
+    // Glyphs are stored 8 rows at a time
+    for(szI = 0; (szI < font.szBytes) && (szI * K_KS0108_PIXELS_PER_PAGE < szHeight); szI++){
+        nRows   = szHeight - szI * K_KS0108_PIXELS_PER_PAGE;
+        szMask  = (nRows >= K_KS0108_PIXELS_PER_PAGE) ? 0xFF : ((1 << nRows) - 1);
+        // The extra column is the space after the char
+        for(szJ = 0; szJ <= szWidth; szJ++){
+            szData = 0x00;
+            if(szJ < szWidth){
+                szData = pGlyph[szI * szWidth + szJ];
+                // The rows of the last partial byte are aligned on the MSB
+                if(font.szHeight < (szI + 1) * K_KS0108_PIXELS_PER_PAGE){
+                    szData >>= (szI + 1) * K_KS0108_PIXELS_PER_PAGE - font.szHeight;
+                }
+            }
+            blitByte(nX + szJ, nY + szI * K_KS0108_PIXELS_PER_PAGE, szData, szMask);
+        }
+    }
+    return szWidth + 1;
+}
+
+//---------------------------------------------------
+/**
+  * setCursorAtPosition : set TEXT pointer to the given coordonate
+  *
+  * @param szLine is line number
+  * @param szCol is col number
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setCursorAtPosition(unsigned char szLine, unsigned char szCol){
+
+    if((szLine < K_KS0108_PAGES_PER_CTRL) && (szCol < K_KS0108_MAX_TXT_COL)){
+        setCursor(szCol * K_KS0108_X_PIXEL_PER_CHAR, szLine);
+    }else{
+        throw std::invalid_argument("[Error] setCursorAtPosition arg out of range");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * fillArea : apply a data to all the pixels of an area
+  *
+  * @param nX0 is the X coord of the first column
+  * @param nY0 is the Y coord of the first row
+  * @param nX1 is the X coord of the last column
+  * @param nY1 is the Y coord of the last row
+  * @param szData is the data applied to each byte
+  * @param szRop is the raster operation
+  * @note the area is clipped, each byte of a page is modified once with the mask of the rows it holds
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::fillArea(int nX0, int nY0, int nX1, int nY1, unsigned char szData, unsigned char szRop){
+    int nX, nPage, nPageFrom, nPageTo;
+    unsigned char szMask;
+
+    // Clip the area against the screen
+    nX0 = (nX0 < 0) ? 0 : nX0;
+    nY0 = (nY0 < 0) ? 0 : nY0;
+    nX1 = (nX1 >= K_KS0108_SCREEN_WIDTH) ? K_KS0108_SCREEN_WIDTH - 1 : nX1;
+    nY1 = (nY1 >= K_KS0108_SCREEN_HEIGHT) ? K_KS0108_SCREEN_HEIGHT - 1 : nY1;
+    if((nX0 > nX1) || (nY0 > nY1)){
+        return;
+    }
+
+    nPageFrom   = nY0 / K_KS0108_PIXELS_PER_PAGE;
+    nPageTo     = nY1 / K_KS0108_PIXELS_PER_PAGE;
+    for(nPage = nPageFrom; nPage <= nPageTo; nPage++){
+        // Rows of the area held by this page, only the first and the last pages are partial
+        szMask = 0xFF;
+        if(nPage == nPageFrom){
+            szMask &= (0xFF << (nY0 % K_KS0108_PIXELS_PER_PAGE));
+        }
+        if(nPage == nPageTo){
+            szMask &= (0xFF >> (K_KS0108_PIXELS_PER_PAGE - 1 - (nY1 % K_KS0108_PIXELS_PER_PAGE)));
+        }
+        for(nX = nX0; nX <= nX1; nX++){
+            mergeData(nX, nPage, szData, szMask, szRop);
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * plotPixel : add a pixel to the primitive being drawn
+  *
+  * @param nX is the X coord
+  * @param nY is the Y coord
+  * @note pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::plotPixel(int nX, int nY){
+    int nPage;
+
+    if((nX < 0) || (nX >= K_KS0108_SCREEN_WIDTH) || (nY < 0) || (nY >= K_KS0108_SCREEN_HEIGHT)){
+        return;
+    }
+    nPage = nY / K_KS0108_PIXELS_PER_PAGE;
+    m_szPlotMask[nPage][nX] |= (1 << (nY % K_KS0108_PIXELS_PER_PAGE));
+    m_nPlotXMin     = (nX < m_nPlotXMin) ? nX : m_nPlotXMin;
+    m_nPlotXMax     = (nX > m_nPlotXMax) ? nX : m_nPlotXMax;
+    m_nPlotPageMin  = (nPage < m_nPlotPageMin) ? nPage : m_nPlotPageMin;
+    m_nPlotPageMax  = (nPage > m_nPlotPageMax) ? nPage : m_nPlotPageMax;
+}
+
+//---------------------------------------------------
+/**
+  * plotSpan : add a horizontal run of pixels to the primitive being drawn
+  *
+  * @param nX0 is the X coord of the first column
+  * @param nX1 is the X coord of the last column
+  * @param nY is the Y coord
+  * @note pixels outside of the screen are dropped
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::plotSpan(int nX0, int nX1, int nY){
+    int nX, nPage;
+    unsigned char szBit;
+
+    nX0 = (nX0 < 0) ? 0 : nX0;
+    nX1 = (nX1 >= K_KS0108_SCREEN_WIDTH) ? K_KS0108_SCREEN_WIDTH - 1 : nX1;
+    if((nX0 > nX1) || (nY < 0) || (nY >= K_KS0108_SCREEN_HEIGHT)){
+        return;
+    }
+    nPage = nY / K_KS0108_PIXELS_PER_PAGE;
+    szBit = 1 << (nY % K_KS0108_PIXELS_PER_PAGE);
+    for(nX = nX0; nX <= nX1; nX++){
+        m_szPlotMask[nPage][nX] |= szBit;
+    }
+    m_nPlotXMin     = (nX0 < m_nPlotXMin) ? nX0 : m_nPlotXMin;
+    m_nPlotXMax     = (nX1 > m_nPlotXMax) ? nX1 : m_nPlotXMax;
+    m_nPlotPageMin  = (nPage < m_nPlotPageMin) ? nPage : m_nPlotPageMin;
+    m_nPlotPageMax  = (nPage > m_nPlotPageMax) ? nPage : m_nPlotPageMax;
+}
+
+//---------------------------------------------------
+/**
+  * plotLine : add the pixels of a line to the primitive being drawn
+  *
+  * @param nXo is the X coord of the origin
+  * @param nYo is the Y coord of the origin
+  * @param nXd is the X coord of the destination
+  * @param nYd is the Y coord of the destination
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::plotLine(int nXo, int nYo, int nXd, int nYd){
+    int nAccumulatedError;
+    int nStep, nSteps;
 
     // Horizontal position
-    int nDx = szXd-szXo;
+    int nDx = nXd-nXo;
     // Vertical position
-    int nDy = szYd-szYo;
+    int nDy = nYd-nYo;
 
     int nTwoDx = nDx * 2;
     int nTwoDy = nDy * 2;
 
-    int nCurrentX = szXo;
-    int nCurrentY = szYo;
+    int nCurrentX = nXo;
+    int nCurrentY = nYo;
 
     // Assume forward drawing
     int nXinc = 1;
@@ -242,253 +1107,462 @@ KS0108Display::drawLine(unsigned char szXo, unsigned char szYo, unsigned char sz
         nTwoDx = -nTwoDx;
     }
 
-    // Vertical delta is negative
-    if (nDy < 0) {
-        nYinc = -1;
-        nDy = -nDy;
-        nTwoDy = -nTwoDy;
+    // Vertical delta is negative
+    if (nDy < 0) {
+        nYinc = -1;
+        nDy = -nDy;
+        nTwoDy = -nTwoDy;
+    }
+
+    nAccumulatedError = 0;
+    nSteps = (nDy <= nDx) ? nDx : nDy;
+    for(nStep = 0; ; nStep++){
+        plotPixel(nCurrentX, nCurrentY);
+
+        if(nStep == nSteps){
+            break;
+        }
+        // Vertical delta is less than horizontal delta
+        if (nDy <= nDx){
+            // Current position is changed
+            nCurrentX += nXinc;
+            nAccumulatedError += nTwoDy;
+            // Time to change Y position
+            if(nAccumulatedError > nDx){
+                nCurrentY += nYinc;
+                nAccumulatedError -= nTwoDx;
+            }
+        }else{
+            nCurrentY += nYinc;
+            nAccumulatedError += nTwoDx;
+            if(nAccumulatedError > nDy){
+                nCurrentX += nXinc;
+                nAccumulatedError -= nTwoDy;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * plotEllipse : add the pixels of an ellipse to the primitive being drawn
+  *
+  * @param nXc is the X coord of the center
+  * @param nYc is the Y coord of the center
+  * @param nRx is the horizontal radius
+  * @param nRy is the vertical radius
+  * @param isFilled if true, the rows are filled between both sides
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::plotEllipse(int nXc, int nYc, int nRx, int nRy, bool isFilled){
+    // Midpoint algorithm, decision variables are scaled by 4 to stay integer
+    long long nRx2 = (long long)nRx * nRx;
+    long long nRy2 = (long long)nRy * nRy;
+    long long nPx = 0;
+    long long nPy = 2 * nRx2 * nRy;
+    long long nDecision;
+    int nX = 0;
+    int nY = nRy;
+
+    // Flat ellipses are a single span
+    if((0 == nRx) || (0 == nRy)){
+        for(nY = -nRy; nY <= nRy; nY++){
+            plotSpan(nXc - nRx, nXc + nRx, nYc + nY);
+        }
+        return;
+    }
+
+    // First region : slope is less than 1, X moves at each step
+    nDecision = 4 * nRy2 - 4 * nRx2 * nRy + nRx2;
+    while(nPx < nPy){
+        plotQuadrants(nXc, nYc, nX, nY, isFilled);
+        nX++;
+        nPx += 2 * nRy2;
+        if(nDecision < 0){
+            nDecision += 4 * (nRy2 + nPx);
+        }else{
+            nY--;
+            nPy -= 2 * nRx2;
+            nDecision += 4 * (nRy2 + nPx - nPy);
+        }
     }
 
-    // Set first pixel of the line
-    setPixel(szXo,szYo);
-
-    // Sanity check. Is the line not a pixel
-    if ((nDx != 0) || (nDy != 0)){
-        // Vertical delta is less than horizontal delta
-        if (nDy <= nDx){
-            nTwoDxAccumulatedError = 0;
-            do {
-                // Current position is changed
-                nCurrentX += nXinc;
-                nTwoDxAccumulatedError += nTwoDy;
-                // Time to change Y position
-                if(nTwoDxAccumulatedError > nDx){
-                    nCurrentY += nYinc;
-                    nTwoDxAccumulatedError -= nTwoDx;
-                }
-                setPixel(nCurrentX,nCurrentY);
-            }while (nCurrentX != szXd);
+    // Second region : Y moves at each step
+    nDecision = nRy2 * (2 * nX + 1) * (2 * nX + 1) + 4 * nRx2 * (nY - 1) * (nY - 1) - 4 * nRx2 * nRy2;
+    while(nY >= 0){
+        plotQuadrants(nXc, nYc, nX, nY, isFilled);
+        nY--;
+        nPy -= 2 * nRx2;
+        if(nDecision > 0){
+            nDecision += 4 * (nRx2 - nPy);
         }else{
-            nTwoDyAccumulatedError = 0;
-            do{
-                nCurrentY += nYinc;
-                nTwoDyAccumulatedError += nTwoDx;
-                if(nTwoDyAccumulatedError > nDy){
-                    nCurrentX += nXinc;
-                    nTwoDyAccumulatedError -= nTwoDy;
-                }
-                setPixel(nCurrentX,nCurrentY);
-            }while (nCurrentY != szYd);
+            nX++;
+            nPx += 2 * nRy2;
+            nDecision += 4 * (nRx2 - nPy + nPx);
         }
     }
 }
 
 //---------------------------------------------------
 /**
-  * drawBitmap : draw a bitmap
+  * plotQuadrants : add a point mirrored in the 4 quadrants of an ellipse
   *
-  * @param szX is the X coord of the origin
-  * @param szY is the Y coord of the origin
-  * @param szDx is the width
-  * @param szDy is the height
+  * @param nXc is the X coord of the center
+  * @param nYc is the Y coord of the center
+  * @param nX is the X offset of the point
+  * @param nY is the Y offset of the point
+  * @param isFilled if true, the spans between the mirrored points are added
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::drawBitmap(char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy){
-    unsigned char szI, szJ;
-    unsigned int nIndex;
-
-    // Sanity check
-    M_KS0108_IS_DEVICE_UP
+KS0108Display::plotQuadrants(int nXc, int nYc, int nX, int nY, bool isFilled){
+    if(true == isFilled){
+        plotSpan(nXc - nX, nXc + nX, nYc + nY);
+        plotSpan(nXc - nX, nXc + nX, nYc - nY);
+    }else{
+        plotPixel(nXc + nX, nYc + nY);
+        plotPixel(nXc - nX, nYc + nY);
+        plotPixel(nXc + nX, nYc - nY);
+        plotPixel(nXc - nX, nYc - nY);
+    }
+}
 
-    nIndex = 0;
-    for(szJ = 0; szJ < szDy / K_KS0108_PAGES_PER_CTRL; szJ++){
-        setAddress(szX,szY + szJ);
-        for(szI = 0; szI < szDx; szI++){
-            writeData(pData[nIndex++]);
+//---------------------------------------------------
+/**
+  * commitPlot : set the plotted pixels in the frame buffer
+  *
+  * @note each byte holding plotted pixels is merged once, then the plot is emptied
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::commitPlot(){
+    int nX, nPage;
+
+    for(nPage = m_nPlotPageMin; nPage <= m_nPlotPageMax; nPage++){
+        for(nX = m_nPlotXMin; nX <= m_nPlotXMax; nX++){
+            if(0 != m_szPlotMask[nPage][nX]){
+                mergeData(nX, nPage, 0xFF, m_szPlotMask[nPage][nX], K_KS0108_ROP_OR);
+                m_szPlotMask[nPage][nX] = 0;
+            }
         }
     }
+    m_nPlotXMin     = K_KS0108_SCREEN_WIDTH;
+    m_nPlotXMax     = -1;
+    m_nPlotPageMin  = K_KS0108_PAGES_PER_CTRL;
+    m_nPlotPageMax  = -1;
 }
 
 //---------------------------------------------------
 /**
-  * setStartLine : Indicate the display data RAM displayed at the top of the screen
+  * loadPage : fill a page of the frame buffer with the display RAM content
   *
-  * @param szStart is the position in the line from 0 to 63
-  * @note All controllers are affected by this operation
+  * @param szPage is the page from 0 to 7
+  * @note the panel is only read once per page, the first time the page is needed
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::setStartLine(unsigned char szStart){
+KS0108Display::loadPage(unsigned char szPage){
     unsigned char szCtrl;
+    unsigned char szPixel;
+    unsigned char szX;
+    I2cTransaction transaction(m_pBus);
 
-    if(szStart < K_KS0108_X_PIXELS_PER_CTRL){
+    try{
         // Browse all controllers
         for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
-            // Indicate the display data RAM displayed at the top of the screen
-            // D7 D6 D5 D4 D3 D2 D1 D0
-            //  1  1  Y  Y  Y  Y  Y  Y
-            writeCommand(K_KS0108_DISPLAY_START_LINE | szStart , szCtrl);
+            szX = szCtrl * K_KS0108_X_PIXELS_PER_CTRL;
+            setAddress(szX, szPage);
+            syncAddress(szCtrl);
+            // After setting the address, the first read returns the previous output register
+            readData(szCtrl);
+            // The Y address counter is incremented after each read
+            for(szPixel = 0; szPixel < K_KS0108_X_PIXELS_PER_CTRL; szPixel++){
+                m_szFrameBuffer[szPage][szX + szPixel] = readData(szCtrl);
+            }
         }
-    }else{
-        throw std::invalid_argument("[Error] setStartLine start out of range [0-63]");
+        transaction.commit();
+    }catch(std::exception const&){
+        invalidatePanel(1 << szPage);
+        throw;
     }
+    memcpy(m_szPanelBuffer[szPage], m_szFrameBuffer[szPage], K_KS0108_SCREEN_WIDTH);
+    m_isPageLoaded[szPage] = true;
+    m_isPageSynced[szPage] = true;
 }
 
-//************* PRIVATE SECTION *************************
+//---------------------------------------------------
+/**
+  * setCursor : set the drawing position inside the frame buffer
+  *
+  * @param szX is the position in the line from 0 to 127
+  * @param szPage is page from 0 to 7
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setCursor(unsigned char szX, unsigned char szPage){
+    if((szX < K_KS0108_SCREEN_WIDTH) && (szPage < K_KS0108_PAGES_PER_CTRL)){
+        m_szCursorX     = szX;
+        m_szCursorPage  = szPage;
+    }else{
+        throw std::invalid_argument("[Error] setCursor arg out of range");
+    }
+}
 
 //---------------------------------------------------
 /**
-  * drawChar : draw a char with the given font
+  * mergeData : merge a data into a byte of the frame buffer
   *
-  * @param szC is the char to display
-  * @param pFont is the font to use
+  * @param szX is the position in the line from 0 to 127
+  * @param szPage is page from 0 to 7
+  * @param szData is the data to write
+  * @param szMask selects the bits of the byte to modify
+  * @param szRop is the raster operation applied to the selected bits
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::drawChar(unsigned char szC, const unsigned char* pFont){
+KS0108Display::mergeData(unsigned char szX, unsigned char szPage, unsigned char szData, unsigned char szMask, unsigned char szRop){
+    unsigned char szNewData;
+    // Nothing to modify, the page does not need to be loaded
+    if(0 == szMask){
+        return;
+    }
+    if(false == m_isPageLoaded[szPage]){
+        loadPage(szPage);
+    }
+    szData &= szMask;
+    switch(szRop){
+        case K_KS0108_ROP_OR:
+            szNewData = m_szFrameBuffer[szPage][szX] | szData;
+            break;
 
-    unsigned char szI,szJ,szPage,szData;
-    unsigned char szX0      = m_szPosX;
-    unsigned char szY0      = m_szPosY;
-    unsigned char szWidth   = 0;
-    unsigned int nIndex     = 0;
+        case K_KS0108_ROP_AND:
+            szNewData = m_szFrameBuffer[szPage][szX] & (szData | ~szMask);
+            break;
 
-    // See font definition .h file for data struct
-    unsigned char szHeight      = pFont[3];
-    unsigned char szBytes       = (szHeight+7)/8;
-    unsigned char szFirstChar   = pFont[4];
-    unsigned char szCharCount   = pFont[5];
+        case K_KS0108_ROP_XOR:
+            szNewData = m_szFrameBuffer[szPage][szX] ^ szData;
+            break;
 
-    if ((szC < szFirstChar) || (szC > szFirstChar + szCharCount)){
-         return;
+        default:
+            szNewData = (m_szFrameBuffer[szPage][szX] & ~szMask) | szData;
+            break;
     }
-
-    szC -= szFirstChar;
-
-    for(szI = 0; szI < szC; szI++){
-        nIndex += pFont[6+szI]; // index 6 is the start of font width table
+    if(m_szFrameBuffer[szPage][szX] != szNewData){
+        m_szFrameBuffer[szPage][szX] = szNewData;
+        markDirty(szX, szX, szPage);
     }
+}
 
-    nIndex = nIndex * szBytes + szCharCount + 6;
-    szWidth = pFont[6 + szC];
-
-    for(szI = 0;szI < szBytes; szI++){
-        szPage = szI * szWidth;
-        for(szJ = 0; szJ < szWidth; szJ++){
-            szData = pFont[nIndex + szPage + szJ];
-            if(szHeight < (szI + 1) * 8){
-                szData >>= (szI+1) *8 - szHeight;
+//---------------------------------------------------
+/**
+  * getBitmapRows : get 8 rows of a bitmap starting at any row
+  *
+  * @param pData is the bitmap, NULL to get the mask of the existing rows
+  * @param nStride is the number of bytes between two pages of the bitmap
+  * @param nCol is the column in the bitmap
+  * @param nRow is the first row, may be negative or after the bitmap
+  * @param szDy is the height of the bitmap
+  * @return the 8 rows, rows outside of the bitmap are 0
+  *
+*/
+//---------------------------------------------------
+unsigned char
+KS0108Display::getBitmapRows(const unsigned char* pData, unsigned int nStride, unsigned int nCol, int nRow, unsigned char szDy){
+    int nPage, nShift, nI;
+    unsigned int nRows  = 0;
+    int nLastPage       = (szDy - 1) / K_KS0108_PIXELS_PER_PAGE;
+    unsigned char szLastMask = ((szDy % K_KS0108_PIXELS_PER_PAGE) == 0) ? 0xFF : ((1 << (szDy % K_KS0108_PIXELS_PER_PAGE)) - 1);
+
+    // Floor division, nRow may be negative
+    nPage   = (nRow >= 0) ? nRow / K_KS0108_PIXELS_PER_PAGE : -((K_KS0108_PIXELS_PER_PAGE - 1 - nRow) / K_KS0108_PIXELS_PER_PAGE);
+    nShift  = nRow - nPage * K_KS0108_PIXELS_PER_PAGE;
+
+    // The 8 rows span two pages of the bitmap
+    for(nI = 0; nI < 2; nI++, nPage++){
+        if((nPage >= 0) && (nPage <= nLastPage)){
+            unsigned char szData = (NULL == pData) ? 0xFF : pData[nPage * nStride + nCol];
+            if(nPage == nLastPage){
+                szData &= szLastMask;
             }
-            writeData(szData);
+            nRows |= (unsigned int)szData << (nI * K_KS0108_PIXELS_PER_PAGE);
         }
-        writeData(0x00);
-        // If the font is higher that 8 pixels
-        setAddress(m_szPosX-szWidth-1,m_szPosY+1);
     }
-    // Next position for next char
-    setAddress(szX0 + szWidth + 1,szY0);
+    return (unsigned char)(nRows >> nShift);
 }
 
 //---------------------------------------------------
 /**
-  * setCursorAtPosition : set TEXT pointer to the given coordonate
+  * blitByte : merge 8 vertical pixels at any pixel position
   *
-  * @param szLine is line number
-  * @param szCol is col number
+  * @param nX is the X coord
+  * @param nY is the Y coord of the first pixel (bit 0)
+  * @param szData is the pixels to draw
+  * @param szMask selects the pixels to replace
+  * @note the byte is split across two pages when nY is not a multiple of 8,
+  *       pixels outside of the screen are dropped
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::setCursorAtPosition(unsigned char szLine, unsigned char szCol){
+KS0108Display::blitByte(unsigned int nX, unsigned int nY, unsigned char szData, unsigned char szMask){
+    unsigned int nPage      = nY / K_KS0108_PIXELS_PER_PAGE;
+    unsigned char szShift   = nY % K_KS0108_PIXELS_PER_PAGE;
 
-    if((szLine < K_KS0108_PAGES_PER_CTRL) && (szCol < K_KS0108_MAX_TXT_COL)){
-        setAddress(szCol * K_KS0108_X_PIXEL_PER_CHAR, szLine);
-    }else{
-        throw std::invalid_argument("[Error] setCursorAtPosition arg out of range");
+    if(nX >= K_KS0108_SCREEN_WIDTH){
+        return;
+    }
+    // Upper part goes to the page of the first pixel
+    if(nPage < K_KS0108_PAGES_PER_CTRL){
+        mergeData(nX, nPage, szData << szShift, szMask << szShift);
+    }
+    // Lower part goes to the next page
+    if((0 != szShift) && (nPage + 1 < K_KS0108_PAGES_PER_CTRL)){
+        mergeData(nX, nPage + 1, szData >> (K_KS0108_PIXELS_PER_PAGE - szShift), szMask >> (K_KS0108_PIXELS_PER_PAGE - szShift));
     }
 }
 
 //---------------------------------------------------
 /**
-  * setPixel : set /unset pixel on screen
+  * markDirty : remember a span of a page that must be sent to the panel
   *
-  * @param szX is the X coord
-  * @param szY is the Y coord
-  * @param isVisible if true, set the pixel, if false clear it
+  * @param szXFrom is the first column
+  * @param szXTo is the last column
+  * @param szPage is page from 0 to 7
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::setPixel(unsigned char szX, unsigned char szY, bool isVisible){
-    unsigned char szTmp;
-    setAddress(szX, (szY / K_KS0108_PAGES_PER_CTRL));
-    // Read actual data
-    szTmp = readData();
-    setAddress(szX, (szY / K_KS0108_PAGES_PER_CTRL));
-    szTmp = readData();
-    setAddress(szX, (szY / K_KS0108_PAGES_PER_CTRL));
-    if(true == isVisible){
-		szTmp |= (1 << (szY % K_KS0108_PAGES_PER_CTRL));
-	}else{
-		szTmp &= ~(1 << (szY % K_KS0108_PAGES_PER_CTRL));
-	}
-    writeData(szTmp);
+KS0108Display::markDirty(unsigned char szXFrom, unsigned char szXTo, unsigned char szPage){
+    if(szXFrom < m_szDirtyMin[szPage]){
+        m_szDirtyMin[szPage] = szXFrom;
+    }
+    if(szXTo > m_szDirtyMax[szPage]){
+        m_szDirtyMax[szPage] = szXTo;
+    }
 }
 
 //---------------------------------------------------
 /**
-  * writeChar : display a single char by building a font
+  * clearDirty : forget all dirty spans
   *
-  * @param szChar is the char to display
+*/
+//---------------------------------------------------
+void
+KS0108Display::clearDirty(){
+    unsigned char szPage;
+    for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+        m_szDirtyMin[szPage] = K_KS0108_SCREEN_WIDTH;
+        m_szDirtyMax[szPage] = 0;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * update : send the drawings to the panel if not in retained mode
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::writeChar(unsigned char szChar){
+KS0108Display::update(){
+    if(false == m_isRetainedMode){
+        flush();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writeChar : display a single char with the default font
+  *
+  * @param szChar is the char to display
+  * @param nX is the X coord of the top left corner
+  * @param nY is the Y coord of the top left corner
+  * @return the width of the char including the space after it
+  *
+*/
+//---------------------------------------------------
+unsigned char
+KS0108Display::writeChar(unsigned char szChar, unsigned int nX, unsigned int nY){
     unsigned char szIndex;
-    szChar -= 0x20;
+    if((szChar < K_KS0108_SCREEN_FIRST_CHAR) || (szChar >= K_KS0108_SCREEN_FIRST_CHAR + sizeof(font5x8) / K_KS0108_SCREEN_FONT_WIDTH)){
+        return 0;
+    }
+    szChar -= K_KS0108_SCREEN_FIRST_CHAR;
     for(szIndex = 0; szIndex < K_KS0108_SCREEN_FONT_WIDTH; szIndex++){
-        writeData(font5x8[(K_KS0108_SCREEN_FONT_WIDTH * szChar) + szIndex]);
+        blitByte(nX + szIndex, nY, font5x8[(K_KS0108_SCREEN_FONT_WIDTH * szChar) + szIndex], 0xFF);
     }
-    writeData(0x00);
+    blitByte(nX + K_KS0108_SCREEN_FONT_WIDTH, nY, 0x00, 0xFF);
+    return K_KS0108_X_PIXEL_PER_CHAR;
 }
+
 //---------------------------------------------------
 /**
-  * displayString : display a string at the current cursor position
+  * displayString : display a string at the given pixel position
   *
   * @param pData is the pointer at the data to write
   * @param pFont is the pointer at the font to use
+  * @param nX is the X coord of the top left corner
+  * @param nY is the Y coord of the top left corner
+  * @param isPageAligned if true, the whole pages covered by the font are modified,
+  *                      otherwise only the rows of the font height
   * @note if the font pointer is NULL, display is done with the default font
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::displayString(const char* pData, const unsigned char *pFont){
+KS0108Display::displayString(const char* pData, const KS0108Font* pFont, unsigned int nX, unsigned int nY, bool isPageAligned){
+    unsigned int nIndex     = 0;
+    unsigned char szHeight  = 0;
     if(NULL != pData){
-        unsigned char szIndex = 0;
-        //while((0 != pData[szIndex]) && (szIndex < K_KS0108_MAX_TXT_COL)){
-        while(0 != pData[szIndex]){
+        if(NULL != pFont){
+            szHeight = isPageAligned ? pFont->szBytes * K_KS0108_PIXELS_PER_PAGE : pFont->szHeight;
+        }
+        // Chars after the right edge are clipped
+        while((0 != pData[nIndex]) && (nX < K_KS0108_SCREEN_WIDTH)){
             if(NULL == pFont){
-                writeChar(pData[szIndex]);
+                nX += writeChar(pData[nIndex], nX, nY);
             }else{
-                drawChar(pData[szIndex],pFont);
+                nX += drawChar(pData[nIndex], *pFont, nX, nY, szHeight);
             }
-            szIndex++;
+            nIndex++;
         };
     }else{
         throw std::invalid_argument("[Error] displayString NULL data");
     }
 }
 
+//---------------------------------------------------
+/**
+  * getFont : get a font from its number
+  *
+  * @param szFont is the font number (0=Corsiva12, 1=Arial Bold)
+  * @return the font, NULL for the default font
+  *
+*/
+//---------------------------------------------------
+const KS0108Font*
+KS0108Display::getFont(unsigned char szFont){
+    switch(szFont){
+        case 0:
+            return &Corsiva_12_Font;
+
+        case 1:
+            return &Arial_Bold_14_Font;
+    }
+    return NULL;
+}
+
 //---------------------------------------------------
 /**
   * enableController :
   *
-  * @param szCtrl is the controller to select
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
   *
 */
 //---------------------------------------------------
@@ -496,6 +1570,11 @@ void
 KS0108Display::enableController(unsigned char szCtrl){
 
     switch(szCtrl){
+        case K_KS0108_ALL_CTRL:
+            // Only writes can be broadcast, reads would collide on the data bus
+            m_szCmd |= (K_KS0108_CS1_MASK | K_KS0108_CS2_MASK);
+            break;
+
         case 1:
             m_szCmd &= ~K_KS0108_CS1_MASK;
             m_szCmd |= K_KS0108_CS2_MASK;
@@ -506,7 +1585,7 @@ KS0108Display::enableController(unsigned char szCtrl){
             m_szCmd |= K_KS0108_CS1_MASK;
             break;
     }
-    writei2c(m_nDeviceCmdFD,m_szCmd);
+    writei2c(m_szCmdAddres,m_szCmd);
 }
 
 //---------------------------------------------------
@@ -519,62 +1598,93 @@ void
 KS0108Display::setHome(){
     // Initialize addresses/positions
     setStartLine(0);
-    setAddress(0,0);
-    m_szPosX = 0;
-    m_szPosY = 0;
+    m_szCursorX     = 0;
+    m_szCursorPage  = 0;
 }
 
 //---------------------------------------------------
 /**
-  * setYAddress : Set the Y address in the Y address counter
+  * setYAddress : Set the Y address in the Y address counter of a controller
   *
-  * @param szX is the position in the line from 0 to 127
-  * @note automatically select the correct controller
+  * @param szY is the position in the controller from 0 to 63
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+  * @note nothing is sent if the counter already holds this value
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::setYAddress(unsigned char szX){
-    unsigned char szCtrl;
-    if(szX < K_KS0108_SCREEN_WIDTH){
-        m_szPosX = szX;
-        // Browse all controllers
-        // Clear all Y addresses for all controllers
-        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
-            // Set the Y address in the Y address counter
-            // D7 D6 D5 D4 D3 D2 D1 D0
-            //  0  1  Y  Y  Y  Y  Y  Y
-            writeCommand(K_KS0108_DISPLAY_SET_Y | 0, szCtrl);
-        }
-        // Finally set the Y address for the selected controller
-        writeCommand(K_KS0108_DISPLAY_SET_Y | (szX % K_KS0108_X_PIXELS_PER_CTRL), (szX / K_KS0108_X_PIXELS_PER_CTRL));
-    }else{
-        throw std::invalid_argument("[Error] setYAddress counter out of range [0-127]");
+KS0108Display::setYAddress(unsigned char szY, unsigned char szCtrl){
+    if(false == isRegisterCached(m_szCtrlY, szY, szCtrl)){
+        // Set the Y address in the Y address counter
+        // D7 D6 D5 D4 D3 D2 D1 D0
+        //  0  1  Y  Y  Y  Y  Y  Y
+        writeCommand(K_KS0108_DISPLAY_SET_Y | szY, szCtrl);
+        setRegisterCache(m_szCtrlY, szY, szCtrl);
     }
 }
 
 //---------------------------------------------------
 /**
-  * setPageRegister : Set the page in the X address counter
+  * setPageRegister : Set the page in the X address counter of a controller
   *
-  * @param szY is the page from 0 to 7
+  * @param szPage is the page from 0 to 7
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+  * @note nothing is sent if the register already holds this value
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::setPageRegister(unsigned char szY){
-    unsigned char szCtrl;
-    if(szY < K_KS0108_PAGES_PER_CTRL){
-        m_szPosY = szY;
-        // Browse all controllers
-        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
-            // Set page address for all controllers
-            // D7 D6 D5 D4 D3 D2 D1 D0
-            //  1  0  1  1  1  X  X  X
-            writeCommand(K_KS0108_DISPLAY_SET_X | szY, szCtrl);
+KS0108Display::setPageRegister(unsigned char szPage, unsigned char szCtrl){
+    if(false == isRegisterCached(m_szCtrlPage, szPage, szCtrl)){
+        // Set page address
+        // D7 D6 D5 D4 D3 D2 D1 D0
+        //  1  0  1  1  1  X  X  X
+        writeCommand(K_KS0108_DISPLAY_SET_X | szPage, szCtrl);
+        setRegisterCache(m_szCtrlPage, szPage, szCtrl);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * isRegisterCached : check if the cache of a register already holds a value
+  *
+  * @param pRegisters is the cache of the register, one entry per controller
+  * @param szValue is the value to check
+  * @param szCtrl is the controller, K_KS0108_ALL_CTRL checks all of them
+  * @return true if all the given controllers hold the value
+  *
+*/
+//---------------------------------------------------
+bool
+KS0108Display::isRegisterCached(const unsigned char* pRegisters, unsigned char szValue, unsigned char szCtrl){
+    unsigned char szI;
+    if(K_KS0108_ALL_CTRL == szCtrl){
+        for(szI = 0; szI < K_KS0108_NB_CTRL; szI++){
+            if(pRegisters[szI] != szValue){
+                return false;
+            }
         }
+        return true;
+    }
+    return (pRegisters[szCtrl] == szValue);
+}
+
+//---------------------------------------------------
+/**
+  * setRegisterCache : remember the value of a register
+  *
+  * @param pRegisters is the cache of the register, one entry per controller
+  * @param szValue is the value of the register
+  * @param szCtrl is the controller, K_KS0108_ALL_CTRL updates all of them
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::setRegisterCache(unsigned char* pRegisters, unsigned char szValue, unsigned char szCtrl){
+    if(K_KS0108_ALL_CTRL == szCtrl){
+        memset(pRegisters, szValue, K_KS0108_NB_CTRL);
     }else{
-        throw std::invalid_argument("[Error] setPageRegister page out of range [0-7]");
+        pRegisters[szCtrl] = szValue;
     }
 }
 
@@ -584,27 +1694,133 @@ KS0108Display::setPageRegister(unsigned char szY){
   *
   * @param szX is the position in the line from 0 to 127
   * @param szY is page from 0 to 7
+  * @note registers of the controllers are only updated by the next access
   *
 */
 //---------------------------------------------------
 void
 KS0108Display::setAddress(unsigned char szX, unsigned char szY){
-    // Set addresses
-    setPageRegister(szY);
-    setYAddress(szX);
+    if((szX < K_KS0108_SCREEN_WIDTH) && (szY < K_KS0108_PAGES_PER_CTRL)){
+        m_szPosX = szX;
+        m_szPosY = szY;
+    }else{
+        throw std::invalid_argument("[Error] setAddress arg out of range");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * syncAddress : Load the current address in the registers of a controller
+  *
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::syncAddress(unsigned char szCtrl){
+    setPageRegister(m_szPosY, szCtrl);
+    setYAddress(m_szPosX % K_KS0108_X_PIXELS_PER_CTRL, szCtrl);
+}
+
+//---------------------------------------------------
+/**
+  * invalidateRegisters : Forget the content of the registers of the controllers
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::invalidateRegisters(){
+    memset(m_szCtrlPage, K_KS0108_UNKNOWN_REGISTER, sizeof(m_szCtrlPage));
+    memset(m_szCtrlY, K_KS0108_UNKNOWN_REGISTER, sizeof(m_szCtrlY));
+    m_szStartLine = K_KS0108_UNKNOWN_REGISTER;
+}
+
+//---------------------------------------------------
+/**
+  * syncStartLine : send the start line asked by setStartLine()
+  *
+  * @note nothing is sent if the register already holds this value
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::syncStartLine(){
+    if(m_szStartLine != m_szNextStartLine){
+        // Indicate the display data RAM displayed at the top of the screen
+        // to all controllers at once
+        // D7 D6 D5 D4 D3 D2 D1 D0
+        //  1  1  Y  Y  Y  Y  Y  Y
+        writeCommand(K_KS0108_DISPLAY_START_LINE | m_szNextStartLine, K_KS0108_ALL_CTRL);
+        m_szStartLine = m_szNextStartLine;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * invalidatePanel : Forget the caches of the panel after a failed transfer
+  *
+  * @param szPages is the bit mask of the pages of the failed transfer
+  * @note an aborted transaction may have sent a part of its writes, the panel content is unknown
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Display::invalidatePanel(unsigned char szPages){
+    unsigned char szPage;
+
+    invalidateRegisters();
+    m_nDataLatch    = K_KS0108_UNKNOWN_LATCH;
+    m_nCmdLatch     = K_KS0108_UNKNOWN_LATCH;
+    // The next flush sends these pages again
+    for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+        if(0 != (szPages & (1 << szPage))){
+            m_isPageSynced[szPage] = false;
+        }
+    }
 }
 
 //---------------------------------------------------
 /**
   * waitBusyFlag : read the busy flag of the LCD
   *
-  * @param szCtrl is the controller to select
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL waits for all of them
+  * @note in trusted timing mode, the controller is only selected
   *
 */
 //---------------------------------------------------
 void
 KS0108Display::waitBusyFlag(unsigned char szCtrl){
+    unsigned char szI;
+    if(true == m_isTrustedTiming){
+        // The time spent on the I2C bus since the last operation
+        // is far longer than the busy time of the controller
+        enableController(szCtrl);
+    }else if(K_KS0108_ALL_CTRL == szCtrl){
+        // Status can only be read from one controller at a time
+        for(szI = 0; szI < K_KS0108_NB_CTRL; szI++){
+            while(readStatus(szI) & K_KS0108_DISPLAY_STATUS_BUSY){
+            }
+        }
+        enableController(szCtrl);
+    }else{
+        while(readStatus(szCtrl) & K_KS0108_DISPLAY_STATUS_BUSY){
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readStatus : read the status register of a controller
+  *
+  * @param szCtrl is the controller to select
+  * @return the status
+  *
+*/
+//---------------------------------------------------
+unsigned char
+KS0108Display::readStatus(unsigned char szCtrl){
     unsigned char szStatus;
+    I2cTransaction transaction(m_pBus);
     // Select the controller by setting CSx to L
     enableController(szCtrl);
     // Select the status register read operation
@@ -612,56 +1828,58 @@ KS0108Display::waitBusyFlag(unsigned char szCtrl){
     //  L H
     m_szCmd &= ~K_KS0108_RS_MASK;
     m_szCmd |= (K_KS0108_RW_MASK | K_KS0108_EN_MASK);
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-    usleep(1);
-    do{
-        // Ready the status register
-        // D7    D6 D5      D4   D3 D2 D1 D0
-        // BUSY  0  ON/OFF  RST   0  0  0  0
-        szStatus = readi2c(m_nDeviceDataFD);
-        m_szCmd &= ~K_KS0108_EN_MASK;
-        writei2c(m_nDeviceCmdFD,m_szCmd);
-        //printf("%d\n",szStatus);
-    }while (szStatus &  K_KS0108_DISPLAY_STATUS_BUSY);
+    writei2c(m_szCmdAddres,m_szCmd);
+    // Ready the status register
+    // D7    D6 D5      D4   D3 D2 D1 D0
+    // BUSY  0  ON/OFF  RST   0  0  0  0
+    szStatus = readi2c(m_szDataAddres);
+    m_szCmd &= ~K_KS0108_EN_MASK;
+    writei2c(m_szCmdAddres,m_szCmd);
     // RS R/W
     //  L   L
     m_szCmd &= ~K_KS0108_RW_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
+    writei2c(m_szCmdAddres,m_szCmd);
+    transaction.commit();
+    return szStatus;
 }
 
 //---------------------------------------------------
 /**
-  * readData : read a data from lcd at current position
+  * readData : read a data from lcd at the current address of a controller
   *
+  * @param szCtrl is the controller to select
   * @return the data
+  * @note the Y address counter of the controller is incremented,
+  *       address must be set again before any write
   *
 */
 //---------------------------------------------------
 unsigned char
-KS0108Display::readData(void){
+KS0108Display::readData(unsigned char szCtrl){
     unsigned char szData;
-    // Each controller can handle 64 dots, so we have to know the one to talk to
-    unsigned char szCurrentCtrl = m_szPosX / K_KS0108_X_PIXELS_PER_CTRL;
+    I2cTransaction transaction(m_pBus);
 
     // Wait for busy bit to be reset
-    waitBusyFlag(szCurrentCtrl);
+    waitBusyFlag(szCtrl);
 
     // Select read data operation
     // RS R/W
     //  H H
     m_szCmd |= (K_KS0108_RW_MASK | K_KS0108_RS_MASK);
-    writei2c(m_nDeviceCmdFD,m_szCmd);
+    writei2c(m_szCmdAddres,m_szCmd);
 
     // EN
     // H
     //    ____
     //___|
     m_szCmd |= K_KS0108_EN_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-    usleep(K_KS0108_STROBE_DELAY);
+    writei2c(m_szCmdAddres,m_szCmd);
+    m_pBus->delay(K_KS0108_STROBE_DELAY);
 
     // Read the data
-    szData = readi2c(m_nDeviceDataFD);
+    szData = readi2c(m_szDataAddres);
+    // The Y address counter was moved by the read
+    m_szCtrlY[szCtrl] = K_KS0108_UNKNOWN_REGISTER;
 
     // Finally latch data on the falling edge of EN
     // EN
@@ -669,18 +1887,8 @@ KS0108Display::readData(void){
     //    ____
     //        |____
     m_szCmd &= ~K_KS0108_EN_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-
-    // Increment the pointer
-    m_szPosX++;
-    if(m_szPosX >= K_KS0108_SCREEN_WIDTH){
-        m_szPosY++;
-        if(m_szPosY >= K_KS0108_PAGES_PER_CTRL){
-            m_szPosY = 0;
-        }
-        setPageRegister(m_szPosY);
-        setYAddress(0);
-    }
+    writei2c(m_szCmdAddres,m_szCmd);
+    transaction.commit();
     return szData;
 }
 
@@ -689,12 +1897,14 @@ KS0108Display::readData(void){
   * writeCommand : write a 8 bits command to lcd
   *
   * @param nData is the 8 bit data to write
-  * @param szCtrl is the controller to select
+  * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL sends it to all of them
   *
 */
 //---------------------------------------------------
 void
 KS0108Display::writeCommand(unsigned char szData, unsigned char szCtrl){
+    I2cTransaction transaction(m_pBus);
+
     // Wait for busy bit to be reset
     waitBusyFlag(szCtrl);
 
@@ -702,13 +1912,14 @@ KS0108Display::writeCommand(unsigned char szData, unsigned char szCtrl){
     // RS R/W
     //  L   L
     m_szCmd &= ~(K_KS0108_RW_MASK | K_KS0108_RS_MASK);
-    writei2c(m_nDeviceCmdFD,m_szCmd);
+    writei2c(m_szCmdAddres,m_szCmd);
 
     // Write the command on the bus
-    writei2c(m_nDeviceDataFD,szData);
+    writei2c(m_szDataAddres,szData);
     //    ____
     //___|    |____
     strobe();
+    transaction.commit();
 }
 
 //---------------------------------------------------
@@ -716,42 +1927,57 @@ KS0108Display::writeCommand(unsigned char szData, unsigned char szCtrl){
   * writeData : write a data to lcd
   *
   * @param szData is the data to write
+  * @param isBroadcast if true, the data is written at the same column of all controllers,
+  *                    the current x position must be in the first controller
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::writeData(unsigned char szData){
+KS0108Display::writeData(unsigned char szData, bool isBroadcast){
     // Each controller can handle 64 dots, so we have to know the one to talk to
-    unsigned char szCurrentCtrl = m_szPosX / K_KS0108_X_PIXELS_PER_CTRL;
-
-    // Wait for busy bit to be reset
-    waitBusyFlag(szCurrentCtrl);
-
-    // Select write data operation
-    // RS R/W
-    //  H   L
-    m_szCmd |= K_KS0108_RS_MASK;
-    //writei2c(m_nDeviceCmdFD,m_szCmd);
-    m_szCmd &= ~K_KS0108_RW_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-
-    // Write the display data on the bus
-    writei2c(m_nDeviceDataFD,szData);
-    //    ____
-    //___|    |____
-    strobe();
-    // After writing operation address is increased by 1 automatically
-    // Increment the pointer
-    m_szPosX++;
-    if(m_szPosX >= K_KS0108_SCREEN_WIDTH){
-        m_szPosY++;
-        if(m_szPosY >= K_KS0108_PAGES_PER_CTRL){
-            m_szPosY = 0;
+    unsigned char szCurrentCtrl = isBroadcast ? K_KS0108_ALL_CTRL : (m_szPosX / K_KS0108_X_PIXELS_PER_CTRL);
+    unsigned char szI;
+    I2cTransaction transaction(m_pBus);
+
+    try{
+        // Load the address in the controller if its counters are not already on it
+        syncAddress(szCurrentCtrl);
+
+        // Wait for busy bit to be reset
+        waitBusyFlag(szCurrentCtrl);
+
+        // Select write data operation
+        // RS R/W
+        //  H   L
+        m_szCmd |= K_KS0108_RS_MASK;
+        //writei2c(m_szCmdAddres,m_szCmd);
+        m_szCmd &= ~K_KS0108_RW_MASK;
+        writei2c(m_szCmdAddres,m_szCmd);
+
+        // Write the display data on the bus
+        writei2c(m_szDataAddres,szData);
+        // Remember what is on the panel
+        if(true == isBroadcast){
+            for(szI = 0; szI < K_KS0108_NB_CTRL; szI++){
+                m_szPanelBuffer[m_szPosY][m_szPosX + szI * K_KS0108_X_PIXELS_PER_CTRL] = szData;
+            }
+        }else{
+            m_szPanelBuffer[m_szPosY][m_szPosX] = szData;
         }
-        setPageRegister(m_szPosY);
-        // Reset colum position to 0
-        setYAddress(0);
+        //    ____
+        //___|    |____
+        strobe();
+        transaction.commit();
+    }catch(std::exception const&){
+        invalidatePanel(1 << m_szPosY);
+        throw;
     }
+    // After writing operation address is increased by 1 automatically
+    // Increment the pointer, runs never go past the end of a page
+    // since flush() sets the address of each run
+    m_szPosX++;
+    // The Y address counter of the controller wraps inside its 64 columns
+    setRegisterCache(m_szCtrlY, m_szPosX % K_KS0108_X_PIXELS_PER_CTRL, szCurrentCtrl);
 }
 
 //---------------------------------------------------
@@ -766,31 +1992,37 @@ KS0108Display::strobe(){
     // EN
     // H
     m_szCmd |= K_KS0108_EN_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-    usleep(K_KS0108_STROBE_DELAY);
+    writei2c(m_szCmdAddres,m_szCmd);
+    if(false == m_isTrustedTiming){
+        m_pBus->delay(K_KS0108_STROBE_DELAY);
+    }
     // Finally latch data on the falling edge of EN
     // EN
     // L
     m_szCmd &= ~K_KS0108_EN_MASK;
-    writei2c(m_nDeviceCmdFD,m_szCmd);
-    usleep(K_KS0108_STROBE_DELAY);
+    writei2c(m_szCmdAddres,m_szCmd);
+    if(false == m_isTrustedTiming){
+        m_pBus->delay(K_KS0108_STROBE_DELAY);
+    }
 }
 
 //---------------------------------------------------
 /**
   * writei2c : write at low level
   *
-  * @param nDeviceID is the deviceIdentifier
+  * @param szAddres is the I2C addres of the device
   * @param szData is the data to write
   *
 */
 //---------------------------------------------------
 void
-KS0108Display::writei2c(int nDeviceFD, unsigned char szData){
-    int nRes;
-    nRes = wiringPiI2CWrite(nDeviceFD,szData);
-    if(0 != nRes){
-        throw std::runtime_error("[Error] i2c write error");
+KS0108Display::writei2c(unsigned char szAddres, unsigned char szData){
+    // The PCF8574 keeps its output until the next write, no need to send the same value twice
+    int* pLatch = (szAddres == m_szCmdAddres) ? &m_nCmdLatch : &m_nDataLatch;
+    if(*pLatch != szData){
+        *pLatch = K_KS0108_UNKNOWN_LATCH;
+        m_pBus->write(szAddres,szData);
+        *pLatch = szData;
     }
 }
 
@@ -798,20 +2030,14 @@ KS0108Display::writei2c(int nDeviceFD, unsigned char szData){
 /**
   * readi2c : read at low level
   *
-  * @param nDeviceID is the deviceIdentifier
+  * @param szAddres is the I2C addres of the device
   * @return the read data
   *
 */
 //---------------------------------------------------
 unsigned char
-KS0108Display::readi2c(int nDeviceFD){
-    int nRes;
+KS0108Display::readi2c(unsigned char szAddres){
     // The master needs to write 1 to the register to set the port as an input mode
-    writei2c(nDeviceFD,0xFF);
-    nRes = wiringPiI2CRead(nDeviceFD);
-    if(nRes < 0){
-        throw std::runtime_error("[Error] i2c read error");
-    }
-    return (unsigned char)nRes;
+    writei2c(szAddres,0xFF);
+    return m_pBus->read(szAddres);
 }
-
@@ -14,6 +14,13 @@
 
 #pragma once
 
+#include <stddef.h>
+#include "../I2cBus/I2cBus.h"
+
+struct KS0108Font;
+struct KS0108TransferStats;
+class KS0108TransferPlanner;
+
 // First PCF8574 is the DATA Port
 // P7 P6 P5 P4 P3 P2 P1 P0
 // D7 D6 D5 D4 D3 D2 D1 D0
@@ -34,11 +41,17 @@ const unsigned char K_KS0108_SCREEN_WIDTH           = 128;
 const unsigned char K_KS0108_SCREEN_HEIGHT          = 64;
 const unsigned char K_KS0108_SCREEN_FONT_WIDTH      = 5;
 const unsigned char K_KS0108_X_PIXEL_PER_CHAR       = 6;
+const unsigned char K_KS0108_SCREEN_FIRST_CHAR      = 0x20;
+// Any font number that is not a proportional font selects the default font
+const unsigned char K_KS0108_DEFAULT_FONT           = 0xFF;
 
 const unsigned char K_KS0108_X_PIXELS_PER_CTRL      = 64;
 const unsigned char K_KS0108_PAGES_PER_CTRL         = 8;
+const unsigned char K_KS0108_PIXELS_PER_PAGE        = 8;
 const unsigned char K_KS0108_NB_CTRL                = (K_KS0108_SCREEN_WIDTH / K_KS0108_X_PIXELS_PER_CTRL);
 const unsigned char K_KS0108_MAX_TXT_COL            = (K_KS0108_SCREEN_WIDTH / K_KS0108_SCREEN_FONT_WIDTH);
+// Pseudo controller selecting all controllers at once (CS1 and CS2 active)
+const unsigned char K_KS0108_ALL_CTRL               = K_KS0108_NB_CTRL;
 
 
 const unsigned char K_KS0108_DISPLAY_SET_Y          = 0x40;
@@ -51,6 +64,25 @@ const unsigned char K_KS0108_DISPLAY_STATUS_BUSY    = 0x80;
 
 const unsigned char K_KS0108_STROBE_DELAY           = 0x01;
 
+// Value of a cached controller register that is not known
+const unsigned char K_KS0108_UNKNOWN_REGISTER       = 0xFF;
+// Value of a PCF8574 output latch that is not known
+const int           K_KS0108_UNKNOWN_LATCH          = -1;
+// Number of command/status sequences checked by calibrateTiming
+const unsigned char K_KS0108_CALIBRATION_LOOPS      = 16;
+
+// Raster operations of blit()
+const unsigned char K_KS0108_ROP_COPY               = 0;
+const unsigned char K_KS0108_ROP_OR                 = 1;
+const unsigned char K_KS0108_ROP_AND                = 2;
+const unsigned char K_KS0108_ROP_XOR                = 3;
+
+// Maximum number of vertices of fillPolygon()
+const unsigned char K_KS0108_MAX_POLYGON_POINTS     = 16;
+
+// Host side copy of the display RAM : 8 pages of 128 columns
+const unsigned int  K_KS0108_FRAMEBUFFER_SIZE       = (K_KS0108_PAGES_PER_CTRL * K_KS0108_SCREEN_WIDTH);
+
 #define M_KS0108_IS_DEVICE_UP                       if(false == m_isDeviceInitialized) return;
 
 class KS0108Display{
@@ -58,13 +90,14 @@ class KS0108Display{
         //---------------------------------------------------
         /**
           * Constructor
+          * @param bus is the I2C bus the PCF8574 are connected to
           * @param szDataAddres is the I2C addres of the device for Data Port
           * @param szCmdAddres is the I2C addres of the device for Command Port
           *
           * Interface is done with two PCF8574
         */
         //---------------------------------------------------
-        KS0108Display(unsigned char szDataAddres, unsigned char szCmdAddres);
+        KS0108Display(I2cBus& bus, unsigned char szDataAddres, unsigned char szCmdAddres);
 
         //---------------------------------------------------
         /**
@@ -123,6 +156,33 @@ class KS0108Display{
         //---------------------------------------------------
         void displayStringWithFontAtPosition(const char* pData, unsigned char szFont, unsigned char szLine, unsigned char szCol);
 
+        //---------------------------------------------------
+        /**
+          * displayStringAtPixel : display a string at the given pixel position
+          *
+          * @param pData is the pointer the data to write
+          * @param szX is the X coord of the top left corner
+          * @param szY is the Y coord of the top left corner
+          * @note only the pixels of the font height are modified, the text is clipped at the screen edges
+          *
+        */
+        //---------------------------------------------------
+        void displayStringAtPixel(const char* pData, unsigned char szX, unsigned char szY);
+
+        //---------------------------------------------------
+        /**
+          * displayStringWithFontAtPixel : display a string at the given pixel position with the given font
+          *
+          * @param pData is the pointer the data to write
+          * @param szFont is the font number (0=Corsiva12, 1=Arial Bold)
+          * @param szX is the X coord of the top left corner
+          * @param szY is the Y coord of the top left corner
+          * @note only the pixels of the font height are modified, the text is clipped at the screen edges
+          *
+        */
+        //---------------------------------------------------
+        void displayStringWithFontAtPixel(const char* pData, unsigned char szFont, unsigned char szX, unsigned char szY);
+
         //---------------------------------------------------
         /**
           * drawRect : draw a rectangle
@@ -131,11 +191,54 @@ class KS0108Display{
           * @param szY is the Y coord
           * @param szL is the lenght
           * @param szW is the width
+          * @note the rectangle is clipped at the screen edges
           *
         */
         //---------------------------------------------------
         void drawRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
 
+        //---------------------------------------------------
+        /**
+          * fillRect : set all the pixels of a rectangle
+          *
+          * @param szX is the X coord
+          * @param szY is the Y coord
+          * @param szL is the lenght
+          * @param szW is the width
+          * @note the rectangle is clipped at the screen edges
+          *
+        */
+        //---------------------------------------------------
+        void fillRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * clearRect : clear all the pixels of a rectangle
+          *
+          * @param szX is the X coord
+          * @param szY is the Y coord
+          * @param szL is the lenght
+          * @param szW is the width
+          * @note the rectangle is clipped at the screen edges
+          *
+        */
+        //---------------------------------------------------
+        void clearRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * invertRect : invert all the pixels of a rectangle
+          *
+          * @param szX is the X coord
+          * @param szY is the Y coord
+          * @param szL is the lenght
+          * @param szW is the width
+          * @note the rectangle is clipped at the screen edges
+          *
+        */
+        //---------------------------------------------------
+        void invertRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
         //---------------------------------------------------
         /**
           * drawLine : draw a line
@@ -144,35 +247,217 @@ class KS0108Display{
           * @param szYo is the Y coord of the origin
           * @param szXd is the X coord of the destination
           * @param szYd is the Y coord of the destination
+          * @note the pixels outside of the screen are dropped
           *
         */
         //---------------------------------------------------
         void drawLine(unsigned char szXo, unsigned char szYo, unsigned char szXd, unsigned char szYd);
 
+        //---------------------------------------------------
+        /**
+          * drawCircle : draw a circle
+          *
+          * @param szXc is the X coord of the center
+          * @param szYc is the Y coord of the center
+          * @param szR is the radius
+          * @note the pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void drawCircle(unsigned char szXc, unsigned char szYc, unsigned char szR);
+
+        //---------------------------------------------------
+        /**
+          * fillCircle : draw a filled circle
+          *
+          * @param szXc is the X coord of the center
+          * @param szYc is the Y coord of the center
+          * @param szR is the radius
+          * @note the pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void fillCircle(unsigned char szXc, unsigned char szYc, unsigned char szR);
+
+        //---------------------------------------------------
+        /**
+          * drawEllipse : draw an ellipse
+          *
+          * @param szXc is the X coord of the center
+          * @param szYc is the Y coord of the center
+          * @param szRx is the horizontal radius
+          * @param szRy is the vertical radius
+          * @note the pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void drawEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy);
+
+        //---------------------------------------------------
+        /**
+          * fillEllipse : draw a filled ellipse
+          *
+          * @param szXc is the X coord of the center
+          * @param szYc is the Y coord of the center
+          * @param szRx is the horizontal radius
+          * @param szRy is the vertical radius
+          * @note the pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void fillEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy);
+
+        //---------------------------------------------------
+        /**
+          * drawArc : draw an arc of circle
+          *
+          * @param szXc is the X coord of the center
+          * @param szYc is the Y coord of the center
+          * @param szR is the radius
+          * @param nStart is the angle of the first end in degrees, 0 is 3 o'clock, 90 is 12 o'clock
+          * @param nEnd is the angle of the last end, the arc goes counterclockwise from nStart to nEnd
+          * @note a sweep of 360 degrees or more draws the whole circle
+          *
+        */
+        //---------------------------------------------------
+        void drawArc(unsigned char szXc, unsigned char szYc, unsigned char szR, int nStart, int nEnd);
+
+        //---------------------------------------------------
+        /**
+          * fillPolygon : draw a filled polygon
+          *
+          * @param pPoints is the X and Y coords of each vertex, one after the other
+          * @param szNbPoints is the number of vertices, up to K_KS0108_MAX_POLYGON_POINTS
+          * @note the edges are part of the polygon, the pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void fillPolygon(const unsigned char* pPoints, unsigned char szNbPoints);
+
         //---------------------------------------------------
         /**
           * drawBitmap : draw a bitmap
           *
+          * @param pData is the bitmap, one byte per column and per page of 8 rows
           * @param szX is the X coord of the origin
-          * @param szY is the Y coord of the origin
+          * @param szY is the page of the origin
           * @param szDx is the width
           * @param szDy is the height
           *
         */
         //---------------------------------------------------
-        void drawBitmap(char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy);
+        void drawBitmap(const unsigned char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy);
+
+        //---------------------------------------------------
+        /**
+          * blit : draw a bitmap at any pixel position
+          *
+          * @param pData is the bitmap, one byte per column and per page of 8 rows, bit 0 is the top row
+          * @param nStride is the number of bytes between two pages of the bitmap
+          * @param nX is the X coord of the top left corner, may be outside of the screen
+          * @param nY is the Y coord of the top left corner, may be outside of the screen
+          * @param szDx is the width
+          * @param szDy is the height, the rows after it in the last page are ignored
+          * @param szRop is the raster operation (K_KS0108_ROP_COPY, OR, AND or XOR)
+          * @note the bitmap is clipped, each byte of the screen is computed once
+          *
+        */
+        //---------------------------------------------------
+        void blit(const unsigned char *pData, unsigned int nStride, int nX, int nY, unsigned char szDx, unsigned char szDy, unsigned char szRop = K_KS0108_ROP_COPY);
+
+        //---------------------------------------------------
+        /**
+          * fillPage : fill a whole page with a pattern
+          *
+          * @param szPage is the page from 0 to 7
+          * @param szPattern is the byte written in every column of the page
+          *
+        */
+        //---------------------------------------------------
+        void fillPage(unsigned char szPage, unsigned char szPattern);
 
         //---------------------------------------------------
         /**
           * setStartLine : Indicate the display data RAM displayed at the top of the screen
           *
           * @param szStart is the position in the line from 0 to 63
-          * @note All controllers are affected by this operation
+          * @note All controllers are affected by this operation,
+          *       in retained mode the scroll is sent by flush() after the drawings
           *
         */
         //---------------------------------------------------
         void setStartLine(unsigned char szStart);
 
+        //---------------------------------------------------
+        /**
+          * setRetainedMode : select when drawings are sent to the panel
+          *
+          * @param isRetained if true, drawings are kept in the frame buffer until flush() is called
+          *                   if false, each drawing is sent to the panel at once
+          *
+        */
+        //---------------------------------------------------
+        void setRetainedMode(bool isRetained);
+
+        //---------------------------------------------------
+        /**
+          * isRetainedMode :
+          *
+          * @return true if drawings are kept until flush() is called
+        */
+        //---------------------------------------------------
+        inline bool isRetainedMode(){ return m_isRetainedMode;}
+
+        //---------------------------------------------------
+        /**
+          * flush : send the modified bytes of the frame buffer to the panel
+          *
+          * @note the bytes that differ from the panel content are written in the order
+          *       chosen by the transfer planner
+          *
+        */
+        //---------------------------------------------------
+        void flush();
+
+        //---------------------------------------------------
+        /**
+          * setTrustedTiming : select how the end of an operation is detected
+          *
+          * @param isTrusted if true, rely on the I2C bus latency instead of polling the busy flag
+          *
+        */
+        //---------------------------------------------------
+        void setTrustedTiming(bool isTrusted);
+
+        //---------------------------------------------------
+        /**
+          * isTrustedTiming :
+          *
+          * @return true if the busy flag is not polled
+        */
+        //---------------------------------------------------
+        inline bool isTrustedTiming(){ return m_isTrustedTiming;}
+
+        //---------------------------------------------------
+        /**
+          * calibrateTiming : check that the I2C bus latency covers the busy time of the controllers
+          *
+          * @return true if trusted timing can be used, false otherwise
+          * @note trusted timing is selected according to the result
+          *
+        */
+        //---------------------------------------------------
+        bool calibrateTiming();
+
+        //---------------------------------------------------
+        /**
+          * getTransferStats :
+          *
+          * @return the statistics of the transfers chosen by the last flush
+        */
+        //---------------------------------------------------
+        const KS0108TransferStats& getTransferStats();
+
     private:
         // Flag to know if operations are valid or not
         bool m_isDeviceInitialized;
@@ -183,30 +468,78 @@ class KS0108Display{
         // I2C Addres of the device for Command Port
         unsigned char m_szCmdAddres;
 
-        // File descriptor of the PCF8574 devices
-        int m_nDeviceDataFD;
-        int m_nDeviceCmdFD;
+        // I2C bus of the PCF8574 devices
+        I2cBus* m_pBus;
 
         // Current data
         unsigned char m_szData;
         // Current command
         unsigned char m_szCmd;
 
-        // Current x position
+        // Current x position of the display RAM address
         unsigned char m_szPosX;
-        // Current y position
+        // Current y position of the display RAM address
         unsigned char m_szPosY;
 
+        // Cache of the page, Y address and start line registers of the controllers
+        unsigned char m_szCtrlPage[K_KS0108_NB_CTRL];
+        unsigned char m_szCtrlY[K_KS0108_NB_CTRL];
+        unsigned char m_szStartLine;
+        // Start line asked by setStartLine(), sent by flush()
+        unsigned char m_szNextStartLine;
+
+        // Current drawing position inside the frame buffer
+        unsigned char m_szCursorX;
+        unsigned char m_szCursorPage;
+
+        // If true, drawings are only sent by flush()
+        bool m_isRetainedMode;
+
+        // If true, the busy flag is not polled before each operation
+        bool m_isTrustedTiming;
+
+        // Last values written to the PCF8574 ports
+        int m_nDataLatch;
+        int m_nCmdLatch;
+
+        // Host copy of the display RAM, one byte per column and per page
+        unsigned char m_szFrameBuffer[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH];
+        // What was last written to or read from the panel
+        unsigned char m_szPanelBuffer[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH];
+        // true when the page of the frame buffer is known (read from the panel or fully drawn)
+        bool m_isPageLoaded[K_KS0108_PAGES_PER_CTRL];
+        // true when the page of the panel buffer reflects the display RAM
+        bool m_isPageSynced[K_KS0108_PAGES_PER_CTRL];
+
+        // Modified columns of each page, empty when min > max
+        unsigned char m_szDirtyMin[K_KS0108_PAGES_PER_CTRL];
+        unsigned char m_szDirtyMax[K_KS0108_PAGES_PER_CTRL];
+
+        // Chooses the runs sent by flush()
+        KS0108TransferPlanner* m_pPlanner;
+
+        // Pixels of the primitive being drawn, merged into the frame buffer by commitPlot()
+        unsigned char m_szPlotMask[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH];
+        // Bounding box of the plotted pixels, empty when min > max
+        int m_nPlotXMin;
+        int m_nPlotXMax;
+        int m_nPlotPageMin;
+        int m_nPlotPageMax;
+
         //---------------------------------------------------
         /**
           * drawchar : draw a char with the given font
           *
           * @param szC is the char to display
-          * @param pFont is the font to use
+          * @param font is the font to use
+          * @param nX is the X coord of the top left corner
+          * @param nY is the Y coord of the top left corner
+          * @param szHeight is the number of rows modified below nY
+          * @return the width of the char including the space after it
           *
         */
         //---------------------------------------------------
-        void drawChar(unsigned char szC, const unsigned char* pFont);
+        unsigned char drawChar(unsigned char szC, const KS0108Font& font, unsigned int nX, unsigned int nY, unsigned char szHeight);
 
 
         //---------------------------------------------------
@@ -222,43 +555,259 @@ class KS0108Display{
 
         //---------------------------------------------------
         /**
-          * setPixel : set /unset pixel on screen
+          * fillArea : apply a data to all the pixels of an area
           *
-          * @param szX is the X coord
-          * @param szY is the Y coord
-          * @param isVisible if true, set the pixel, if false clear it
+          * @param nX0 is the X coord of the first column
+          * @param nY0 is the Y coord of the first row
+          * @param nX1 is the X coord of the last column
+          * @param nY1 is the Y coord of the last row
+          * @param szData is the data applied to each byte
+          * @param szRop is the raster operation
+          * @note the area is clipped, each byte of a page is modified once with the mask of the rows it holds
           *
         */
         //---------------------------------------------------
-        void setPixel(unsigned char szX, unsigned char szY, bool isVisible = true);
+        void fillArea(int nX0, int nY0, int nX1, int nY1, unsigned char szData, unsigned char szRop);
 
         //---------------------------------------------------
         /**
-          * writeChar : display a single char by building a font
+          * drawHLine : draw a horizontal line, one masked byte per column
+          *
+          * @param nX0 is the X coord of the first column
+          * @param nX1 is the X coord of the last column
+          * @param nY is the Y coord
+          *
+        */
+        //---------------------------------------------------
+        inline void drawHLine(int nX0, int nX1, int nY){ fillArea(nX0, nY, nX1, nY, 0xFF, K_KS0108_ROP_OR);}
+
+        //---------------------------------------------------
+        /**
+          * drawVLine : draw a vertical line, full bytes and two masked end bytes
+          *
+          * @param nX is the X coord
+          * @param nY0 is the Y coord of the first row
+          * @param nY1 is the Y coord of the last row
+          *
+        */
+        //---------------------------------------------------
+        inline void drawVLine(int nX, int nY0, int nY1){ fillArea(nX, nY0, nX, nY1, 0xFF, K_KS0108_ROP_OR);}
+
+        //---------------------------------------------------
+        /**
+          * plotPixel : add a pixel to the primitive being drawn
+          *
+          * @param nX is the X coord
+          * @param nY is the Y coord
+          * @note pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void plotPixel(int nX, int nY);
+
+        //---------------------------------------------------
+        /**
+          * plotSpan : add a horizontal run of pixels to the primitive being drawn
+          *
+          * @param nX0 is the X coord of the first column
+          * @param nX1 is the X coord of the last column
+          * @param nY is the Y coord
+          * @note pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void plotSpan(int nX0, int nX1, int nY);
+
+        //---------------------------------------------------
+        /**
+          * plotLine : add the pixels of a line to the primitive being drawn
+          *
+          * @param nXo is the X coord of the origin
+          * @param nYo is the Y coord of the origin
+          * @param nXd is the X coord of the destination
+          * @param nYd is the Y coord of the destination
+          *
+        */
+        //---------------------------------------------------
+        void plotLine(int nXo, int nYo, int nXd, int nYd);
+
+        //---------------------------------------------------
+        /**
+          * plotEllipse : add the pixels of an ellipse to the primitive being drawn
+          *
+          * @param nXc is the X coord of the center
+          * @param nYc is the Y coord of the center
+          * @param nRx is the horizontal radius
+          * @param nRy is the vertical radius
+          * @param isFilled if true, the rows are filled between both sides
+          *
+        */
+        //---------------------------------------------------
+        void plotEllipse(int nXc, int nYc, int nRx, int nRy, bool isFilled);
+
+        //---------------------------------------------------
+        /**
+          * plotQuadrants : add a point mirrored in the 4 quadrants of an ellipse
+          *
+          * @param nXc is the X coord of the center
+          * @param nYc is the Y coord of the center
+          * @param nX is the X offset of the point
+          * @param nY is the Y offset of the point
+          * @param isFilled if true, the spans between the mirrored points are added
+          *
+        */
+        //---------------------------------------------------
+        void plotQuadrants(int nXc, int nYc, int nX, int nY, bool isFilled);
+
+        //---------------------------------------------------
+        /**
+          * commitPlot : set the plotted pixels in the frame buffer
+          *
+          * @note each byte holding plotted pixels is merged once, then the plot is emptied
+          *
+        */
+        //---------------------------------------------------
+        void commitPlot();
+
+        //---------------------------------------------------
+        /**
+          * loadPage : fill a page of the frame buffer with the display RAM content
+          *
+          * @param szPage is the page from 0 to 7
+          * @note the panel is only read once per page, the first time the page is needed
+          *
+        */
+        //---------------------------------------------------
+        void loadPage(unsigned char szPage);
+
+        //---------------------------------------------------
+        /**
+          * setCursor : set the drawing position inside the frame buffer
+          *
+          * @param szX is the position in the line from 0 to 127
+          * @param szPage is page from 0 to 7
+          *
+        */
+        //---------------------------------------------------
+        void setCursor(unsigned char szX, unsigned char szPage);
+
+        //---------------------------------------------------
+        /**
+          * mergeData : merge a data into a byte of the frame buffer
+          *
+          * @param szX is the position in the line from 0 to 127
+          * @param szPage is page from 0 to 7
+          * @param szData is the data to write
+          * @param szMask selects the bits of the byte to modify
+          * @param szRop is the raster operation applied to the selected bits
+          *
+        */
+        //---------------------------------------------------
+        void mergeData(unsigned char szX, unsigned char szPage, unsigned char szData, unsigned char szMask, unsigned char szRop = K_KS0108_ROP_COPY);
+
+        //---------------------------------------------------
+        /**
+          * getBitmapRows : get 8 rows of a bitmap starting at any row
+          *
+          * @param pData is the bitmap, NULL to get the mask of the existing rows
+          * @param nStride is the number of bytes between two pages of the bitmap
+          * @param nCol is the column in the bitmap
+          * @param nRow is the first row, may be negative or after the bitmap
+          * @param szDy is the height of the bitmap
+          * @return the 8 rows, rows outside of the bitmap are 0
+          *
+        */
+        //---------------------------------------------------
+        unsigned char getBitmapRows(const unsigned char* pData, unsigned int nStride, unsigned int nCol, int nRow, unsigned char szDy);
+
+        //---------------------------------------------------
+        /**
+          * blitByte : merge 8 vertical pixels at any pixel position
+          *
+          * @param nX is the X coord
+          * @param nY is the Y coord of the first pixel (bit 0)
+          * @param szData is the pixels to draw
+          * @param szMask selects the pixels to replace
+          * @note the byte is split across two pages when nY is not a multiple of 8,
+          *       pixels outside of the screen are dropped
+          *
+        */
+        //---------------------------------------------------
+        void blitByte(unsigned int nX, unsigned int nY, unsigned char szData, unsigned char szMask);
+
+        //---------------------------------------------------
+        /**
+          * markDirty : remember a span of a page that must be sent to the panel
+          *
+          * @param szXFrom is the first column
+          * @param szXTo is the last column
+          * @param szPage is page from 0 to 7
+          *
+        */
+        //---------------------------------------------------
+        void markDirty(unsigned char szXFrom, unsigned char szXTo, unsigned char szPage);
+
+        //---------------------------------------------------
+        /**
+          * clearDirty : forget all dirty spans
+          *
+        */
+        //---------------------------------------------------
+        void clearDirty();
+
+        //---------------------------------------------------
+        /**
+          * update : send the drawings to the panel if not in retained mode
+          *
+        */
+        //---------------------------------------------------
+        void update();
+
+        //---------------------------------------------------
+        /**
+          * writeChar : display a single char with the default font
           *
           * @param szChar is the char to display
+          * @param nX is the X coord of the top left corner
+          * @param nY is the Y coord of the top left corner
+          * @return the width of the char including the space after it
           *
         */
         //---------------------------------------------------
-        void writeChar(unsigned char szChar);
+        unsigned char writeChar(unsigned char szChar, unsigned int nX, unsigned int nY);
 
         //---------------------------------------------------
         /**
-          * displayString : display a string at the current cursor position
+          * displayString : display a string at the given pixel position
           *
           * @param pData is the pointer the data to write
           * @param pFont is the pointer at the font to use
+          * @param nX is the X coord of the top left corner
+          * @param nY is the Y coord of the top left corner
+          * @param isPageAligned if true, the whole pages covered by the font are modified,
+          *                      otherwise only the rows of the font height
           * @note if the font pointer is NULL, display is done with the default font
           *
          */
         //---------------------------------------------------
-        void displayString(const char* pData, const unsigned char* pFont=NULL);
+        void displayString(const char* pData, const KS0108Font* pFont, unsigned int nX, unsigned int nY, bool isPageAligned);
+
+        //---------------------------------------------------
+        /**
+          * getFont : get a font from its number
+          *
+          * @param szFont is the font number (0=Corsiva12, 1=Arial Bold)
+          * @return the font, NULL for the default font
+          *
+         */
+        //---------------------------------------------------
+        const KS0108Font* getFont(unsigned char szFont);
 
         //---------------------------------------------------
         /**
           * enableController :
           *
-          * @param szCtrl is the controller to select
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
           *
         */
         //---------------------------------------------------
@@ -274,24 +823,52 @@ class KS0108Display{
 
         //---------------------------------------------------
         /**
-          * setYAddress : Set the Y address in the Y address counter
+          * setYAddress : Set the Y address in the Y address counter of a controller
           *
-          * @param szX is the position in the line from 0 to 127
-          * @note automatically select the correct controller
+          * @param szY is the position in the controller from 0 to 63
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+          * @note nothing is sent if the counter already holds this value
+          *
+        */
+        //---------------------------------------------------
+        void setYAddress(unsigned char szY, unsigned char szCtrl);
+
+        //---------------------------------------------------
+        /**
+          * setPageRegister : Set the page in the X address counter of a controller
+          *
+          * @param szPage is the page from 0 to 7
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+          * @note nothing is sent if the register already holds this value
+          *
+        */
+        //---------------------------------------------------
+        void setPageRegister(unsigned char szPage, unsigned char szCtrl);
+
+        //---------------------------------------------------
+        /**
+          * isRegisterCached : check if the cache of a register already holds a value
+          *
+          * @param pRegisters is the cache of the register, one entry per controller
+          * @param szValue is the value to check
+          * @param szCtrl is the controller, K_KS0108_ALL_CTRL checks all of them
+          * @return true if all the given controllers hold the value
           *
         */
         //---------------------------------------------------
-        void setYAddress(unsigned char szX);
+        bool isRegisterCached(const unsigned char* pRegisters, unsigned char szValue, unsigned char szCtrl);
 
         //---------------------------------------------------
         /**
-          * setPageRegister : Set the page in the X address counter
+          * setRegisterCache : remember the value of a register
           *
-          * @param szY is the page from 0 to 7
+          * @param pRegisters is the cache of the register, one entry per controller
+          * @param szValue is the value of the register
+          * @param szCtrl is the controller, K_KS0108_ALL_CTRL updates all of them
           *
         */
         //---------------------------------------------------
-        void setPageRegister(unsigned char szY);
+        void setRegisterCache(unsigned char* pRegisters, unsigned char szValue, unsigned char szCtrl);
 
         //---------------------------------------------------
         /**
@@ -299,16 +876,57 @@ class KS0108Display{
           *
           * @param szX is the position in the line from 0 to 127
           * @param szY is page from 0 to 7
+          * @note registers of the controllers are only updated by the next access
           *
         */
         //---------------------------------------------------
         void setAddress(unsigned char szX, unsigned char szY);
 
+        //---------------------------------------------------
+        /**
+          * syncAddress : Load the current address in the registers of a controller
+          *
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL selects all of them
+          *
+        */
+        //---------------------------------------------------
+        void syncAddress(unsigned char szCtrl);
+
+        //---------------------------------------------------
+        /**
+          * invalidateRegisters : Forget the content of the registers of the controllers
+          *
+        */
+        //---------------------------------------------------
+        void invalidateRegisters();
+
+        //---------------------------------------------------
+        /**
+          * syncStartLine : send the start line asked by setStartLine()
+          *
+          * @note nothing is sent if the register already holds this value
+          *
+        */
+        //---------------------------------------------------
+        void syncStartLine();
+
+        //---------------------------------------------------
+        /**
+          * invalidatePanel : Forget the caches of the panel after a failed transfer
+          *
+          * @param szPages is the bit mask of the pages of the failed transfer
+          * @note an aborted transaction may have sent a part of its writes, the panel content is unknown
+          *
+        */
+        //---------------------------------------------------
+        void invalidatePanel(unsigned char szPages);
+
         //---------------------------------------------------
         /**
           * waitBusyFlag : read the busy flag of the LCD
           *
-          * @param szCtrl is the controller to select
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL waits for all of them
+          * @note in trusted timing mode, the controller is only selected
           *
         */
         //---------------------------------------------------
@@ -316,20 +934,34 @@ class KS0108Display{
 
         //---------------------------------------------------
         /**
-          * readData : read a data from lcd at current position
+          * readStatus : read the status register of a controller
           *
+          * @param szCtrl is the controller to select
+          * @return the status
+          *
+        */
+        //---------------------------------------------------
+        unsigned char readStatus(unsigned char szCtrl);
+
+        //---------------------------------------------------
+        /**
+          * readData : read a data from lcd at the current address of a controller
+          *
+          * @param szCtrl is the controller to select
           * @return the data
+          * @note the Y address counter of the controller is incremented,
+          *       address must be set again before any write
           *
         */
         //---------------------------------------------------
-        unsigned char readData(void);
+        unsigned char readData(unsigned char szCtrl);
 
         //---------------------------------------------------
         /**
           * writeCommand : write a 8 bits command to lcd
           *
           * @param szData is the 8 bit data to write
-          * @param szCtrl is the controller to select
+          * @param szCtrl is the controller to select, K_KS0108_ALL_CTRL sends it to all of them
           *
         */
         //---------------------------------------------------
@@ -340,10 +972,12 @@ class KS0108Display{
           * writeData : write a data to lcd
           *
           * @param szData is the data to write
+          * @param isBroadcast if true, the data is written at the same column of all controllers,
+          *                    the current x position must be in the first controller
           *
         */
         //---------------------------------------------------
-        void writeData(unsigned char szData);
+        void writeData(unsigned char szData, bool isBroadcast = false);
 
         //---------------------------------------------------
         /**
@@ -358,23 +992,23 @@ class KS0108Display{
         /**
           * writei2c : write at low level
           *
-          * @param nDeviceID is the deviceIdentifier
+          * @param szAddres is the I2C addres of the device
           * @param szData is the data to write
           *
         */
         //---------------------------------------------------
-        void writei2c(int nDeviceID, unsigned char szData);
+        void writei2c(unsigned char szAddres, unsigned char szData);
 
         //---------------------------------------------------
         /**
           * readi2c : read at low level
           *
-          * @param nDeviceID is the deviceIdentifier
+          * @param szAddres is the I2C addres of the device
           * @return the read data
           *
         */
         //---------------------------------------------------
-        unsigned char readi2c(int nDeviceFD);
+        unsigned char readi2c(unsigned char szAddres);
 
 
 };
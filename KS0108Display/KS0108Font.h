@@ -0,0 +1,140 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Font.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+// Header of a FontCreator font
+// size (2 bytes), fixed width, height, first char, char count, char widths[char count], data
+const unsigned char K_KS0108_FONT_WIDTH             = 2;
+const unsigned char K_KS0108_FONT_HEIGHT            = 3;
+const unsigned char K_KS0108_FONT_FIRST_CHAR        = 4;
+const unsigned char K_KS0108_FONT_CHAR_COUNT        = 5;
+const unsigned char K_KS0108_FONT_CHAR_WIDTHS       = 6;
+
+// Descriptor of a proportional font
+struct KS0108Font{
+    // Width for fixed drawing and height in pixels
+    unsigned char szWidth;
+    unsigned char szHeight;
+    // Range of the characters of the font
+    unsigned char szFirstChar;
+    unsigned char szCharCount;
+    // Number of pages a glyph spans
+    unsigned char szBytes;
+    // Width in pixels of each glyph
+    const unsigned char* pWidths;
+    // Offset of each glyph inside pData
+    const unsigned int* pOffsets;
+    // Bit field of all glyphs, each glyph is stored page by page
+    const unsigned char* pData;
+};
+
+//---------------------------------------------------
+/**
+  * KS0108IndexSequence : compile time list of indexes
+  *
+*/
+//---------------------------------------------------
+template<unsigned int... N>
+struct KS0108IndexSequence{
+};
+
+//---------------------------------------------------
+/**
+  * KS0108MakeIndexSequence : build the list of indexes from 0 to C-1
+  *
+*/
+//---------------------------------------------------
+template<unsigned int C, unsigned int... N>
+struct KS0108MakeIndexSequence : KS0108MakeIndexSequence<C - 1, C - 1, N...>{
+};
+
+template<unsigned int... N>
+struct KS0108MakeIndexSequence<0, N...>{
+    typedef KS0108IndexSequence<N...> type;
+};
+
+//---------------------------------------------------
+/**
+  * KS0108FontTable : descriptor and glyph offsets of a FontCreator font
+  *
+  * @param pFont is the font, it must be a constexpr array
+  * @note everything is computed at compile time, glyph lookup is O(1)
+  *
+*/
+//---------------------------------------------------
+template<const unsigned char* pFont>
+struct KS0108FontTable{
+    //---------------------------------------------------
+    /**
+      * getBytes :
+      *
+      * @return the number of pages a glyph spans
+    */
+    //---------------------------------------------------
+    static constexpr unsigned char getBytes(){
+        return (pFont[K_KS0108_FONT_HEIGHT] + 7) / 8;
+    }
+
+    //---------------------------------------------------
+    /**
+      * getOffset : sum the sizes of the glyphs before a char
+      *
+      * @param nChar is the index of the char in the font
+      * @return the offset of the glyph inside the font data
+    */
+    //---------------------------------------------------
+    static constexpr unsigned int getOffset(unsigned int nChar){
+        return (0 == nChar) ? 0 : getOffset(nChar - 1) + pFont[K_KS0108_FONT_CHAR_WIDTHS + nChar - 1] * getBytes();
+    }
+
+    //---------------------------------------------------
+    /**
+      * getSize :
+      *
+      * @return the size of the font array described by the header and the widths
+    */
+    //---------------------------------------------------
+    static constexpr unsigned int getSize(){
+        return K_KS0108_FONT_CHAR_WIDTHS + pFont[K_KS0108_FONT_CHAR_COUNT] + getOffset(pFont[K_KS0108_FONT_CHAR_COUNT]);
+    }
+
+    // One offset per char of the font
+    template<typename T>
+    struct Offsets;
+
+    template<unsigned int... N>
+    struct Offsets<KS0108IndexSequence<N...> >{
+        static constexpr unsigned int nTable[sizeof...(N)] = { getOffset(N)... };
+    };
+
+    typedef Offsets<typename KS0108MakeIndexSequence<pFont[K_KS0108_FONT_CHAR_COUNT]>::type> Table;
+
+    static constexpr KS0108Font font = {
+        pFont[K_KS0108_FONT_WIDTH],
+        pFont[K_KS0108_FONT_HEIGHT],
+        pFont[K_KS0108_FONT_FIRST_CHAR],
+        pFont[K_KS0108_FONT_CHAR_COUNT],
+        getBytes(),
+        pFont + K_KS0108_FONT_CHAR_WIDTHS,
+        Table::nTable,
+        pFont + K_KS0108_FONT_CHAR_WIDTHS + pFont[K_KS0108_FONT_CHAR_COUNT]
+    };
+};
+
+template<const unsigned char* pFont>
+template<unsigned int... N>
+constexpr unsigned int KS0108FontTable<pFont>::Offsets<KS0108IndexSequence<N...> >::nTable[sizeof...(N)];
+
+template<const unsigned char* pFont>
+constexpr KS0108Font KS0108FontTable<pFont>::font;
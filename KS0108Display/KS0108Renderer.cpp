@@ -0,0 +1,656 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Renderer.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "KS0108Renderer.h"
+
+// Commands of the queue
+const unsigned char K_KS0108_RENDER_CLS             = 0;
+const unsigned char K_KS0108_RENDER_TEXT_AT_POS     = 1;
+const unsigned char K_KS0108_RENDER_TEXT_AT_PIXEL   = 2;
+const unsigned char K_KS0108_RENDER_DRAW_RECT       = 3;
+const unsigned char K_KS0108_RENDER_FILL_RECT       = 4;
+const unsigned char K_KS0108_RENDER_CLEAR_RECT      = 5;
+const unsigned char K_KS0108_RENDER_INVERT_RECT     = 6;
+const unsigned char K_KS0108_RENDER_DRAW_LINE       = 7;
+const unsigned char K_KS0108_RENDER_DRAW_CIRCLE     = 8;
+const unsigned char K_KS0108_RENDER_FILL_CIRCLE     = 9;
+const unsigned char K_KS0108_RENDER_DRAW_ELLIPSE    = 10;
+const unsigned char K_KS0108_RENDER_FILL_ELLIPSE    = 11;
+const unsigned char K_KS0108_RENDER_DRAW_ARC        = 12;
+const unsigned char K_KS0108_RENDER_FILL_POLYGON    = 13;
+const unsigned char K_KS0108_RENDER_BLIT            = 14;
+const unsigned char K_KS0108_RENDER_FILL_PAGE       = 15;
+const unsigned char K_KS0108_RENDER_START_LINE      = 16;
+const unsigned char K_KS0108_RENDER_FENCE           = 17;
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param display is the initialized display to draw on
+  *
+  * The drawing calls are queued and a worker thread sends them to the panel.
+  * The display is put in retained mode and flushed each time the queue is empty,
+  * so drawings queued while the bus is busy are sent together.
+  * @note the calls must all be done by the same thread, and the display must not
+  *       be used directly while the renderer exists
+*/
+//---------------------------------------------------
+KS0108Renderer::KS0108Renderer(KS0108Display& display) :
+    m_nHead(0),
+    m_nTail(0),
+    m_nFenceReached(0),
+    m_isWorkerWaiting(false){
+    m_pDisplay          = &display;
+    m_wasRetainedMode   = display.isRetainedMode();
+    m_nStalls           = 0;
+    m_nFenceQueued      = 0;
+    m_isStopping        = false;
+    memset(m_commands, 0, sizeof(m_commands));
+
+    m_pDisplay->setRetainedMode(true);
+    m_worker = std::thread(&KS0108Renderer::run, this);
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+  *
+  * The queued drawings are sent before the worker thread is stopped
+*/
+//---------------------------------------------------
+KS0108Renderer::~KS0108Renderer(){
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_isStopping = true;
+    }
+    m_wakeCond.notify_one();
+    m_worker.join();
+    // Leaving the retained mode flushes, a destructor must not throw
+    // and no waitFence can report the error anymore
+    try{
+        m_pDisplay->setRetainedMode(m_wasRetainedMode);
+    }catch(std::exception const& e){
+        printf("[KS0108Renderer] %s\n",e.what());
+    }
+}
+
+//---------------------------------------------------
+/**
+  * cls : queue KS0108Display::cls
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::cls(){
+    reserve(K_KS0108_RENDER_CLS);
+    commit();
+}
+
+//---------------------------------------------------
+/**
+  * displayStringAtPosition : queue KS0108Display::displayStringAtPosition
+  *
+  * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::displayStringAtPosition(const char* pData, unsigned char szLine, unsigned char szCol){
+    queueText(K_KS0108_RENDER_TEXT_AT_POS, pData, K_KS0108_DEFAULT_FONT, szLine, szCol);
+}
+
+//---------------------------------------------------
+/**
+  * displayStringWithFontAtPosition : queue KS0108Display::displayStringWithFontAtPosition
+  *
+  * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::displayStringWithFontAtPosition(const char* pData, unsigned char szFont, unsigned char szLine, unsigned char szCol){
+    queueText(K_KS0108_RENDER_TEXT_AT_POS, pData, szFont, szLine, szCol);
+}
+
+//---------------------------------------------------
+/**
+  * displayStringAtPixel : queue KS0108Display::displayStringAtPixel
+  *
+  * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::displayStringAtPixel(const char* pData, unsigned char szX, unsigned char szY){
+    queueText(K_KS0108_RENDER_TEXT_AT_PIXEL, pData, K_KS0108_DEFAULT_FONT, szX, szY);
+}
+
+//---------------------------------------------------
+/**
+  * displayStringWithFontAtPixel : queue KS0108Display::displayStringWithFontAtPixel
+  *
+  * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::displayStringWithFontAtPixel(const char* pData, unsigned char szFont, unsigned char szX, unsigned char szY){
+    queueText(K_KS0108_RENDER_TEXT_AT_PIXEL, pData, szFont, szX, szY);
+}
+
+//---------------------------------------------------
+/**
+  * drawRect : queue KS0108Display::drawRect
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    queueShape(K_KS0108_RENDER_DRAW_RECT, szX, szY, szL, szW);
+}
+
+//---------------------------------------------------
+/**
+  * fillRect : queue KS0108Display::fillRect
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::fillRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    queueShape(K_KS0108_RENDER_FILL_RECT, szX, szY, szL, szW);
+}
+
+//---------------------------------------------------
+/**
+  * clearRect : queue KS0108Display::clearRect
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::clearRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    queueShape(K_KS0108_RENDER_CLEAR_RECT, szX, szY, szL, szW);
+}
+
+//---------------------------------------------------
+/**
+  * invertRect : queue KS0108Display::invertRect
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::invertRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW){
+    queueShape(K_KS0108_RENDER_INVERT_RECT, szX, szY, szL, szW);
+}
+
+//---------------------------------------------------
+/**
+  * drawLine : queue KS0108Display::drawLine
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawLine(unsigned char szXo, unsigned char szYo, unsigned char szXd, unsigned char szYd){
+    queueShape(K_KS0108_RENDER_DRAW_LINE, szXo, szYo, szXd, szYd);
+}
+
+//---------------------------------------------------
+/**
+  * drawCircle : queue KS0108Display::drawCircle
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawCircle(unsigned char szXc, unsigned char szYc, unsigned char szR){
+    queueShape(K_KS0108_RENDER_DRAW_CIRCLE, szXc, szYc, szR);
+}
+
+//---------------------------------------------------
+/**
+  * fillCircle : queue KS0108Display::fillCircle
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::fillCircle(unsigned char szXc, unsigned char szYc, unsigned char szR){
+    queueShape(K_KS0108_RENDER_FILL_CIRCLE, szXc, szYc, szR);
+}
+
+//---------------------------------------------------
+/**
+  * drawEllipse : queue KS0108Display::drawEllipse
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy){
+    queueShape(K_KS0108_RENDER_DRAW_ELLIPSE, szXc, szYc, szRx, szRy);
+}
+
+//---------------------------------------------------
+/**
+  * fillEllipse : queue KS0108Display::fillEllipse
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::fillEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy){
+    queueShape(K_KS0108_RENDER_FILL_ELLIPSE, szXc, szYc, szRx, szRy);
+}
+
+//---------------------------------------------------
+/**
+  * drawArc : queue KS0108Display::drawArc
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawArc(unsigned char szXc, unsigned char szYc, unsigned char szR, int nStart, int nEnd){
+    queueShape(K_KS0108_RENDER_DRAW_ARC, szXc, szYc, szR, nStart, nEnd);
+}
+
+//---------------------------------------------------
+/**
+  * fillPolygon : queue KS0108Display::fillPolygon
+  *
+  * @note the vertices are not copied, they must not change until a fence placed after this call is reached
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::fillPolygon(const unsigned char* pPoints, unsigned char szNbPoints){
+    KS0108RenderCommand* pCommand = reserve(K_KS0108_RENDER_FILL_POLYGON);
+
+    pCommand->pData     = pPoints;
+    pCommand->nArgs[0]  = szNbPoints;
+    commit();
+}
+
+//---------------------------------------------------
+/**
+  * drawBitmap : queue KS0108Display::drawBitmap
+  *
+  * @note the bitmap is not copied, it must not change until a fence placed after this call is reached
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::drawBitmap(const unsigned char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy){
+    // Same conversion as KS0108Display::drawBitmap
+    blit(pData, szDx, szX, szY * K_KS0108_PIXELS_PER_PAGE, szDx, szDy, K_KS0108_ROP_COPY);
+}
+
+//---------------------------------------------------
+/**
+  * blit : queue KS0108Display::blit
+  *
+  * @note the bitmap is not copied, it must not change until a fence placed after this call is reached
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::blit(const unsigned char *pData, unsigned int nStride, int nX, int nY, unsigned char szDx, unsigned char szDy, unsigned char szRop){
+    KS0108RenderCommand* pCommand = reserve(K_KS0108_RENDER_BLIT);
+
+    pCommand->pData     = pData;
+    pCommand->nArgs[0]  = nStride;
+    pCommand->nArgs[1]  = nX;
+    pCommand->nArgs[2]  = nY;
+    pCommand->nArgs[3]  = szDx;
+    pCommand->nArgs[4]  = szDy;
+    pCommand->nArgs[5]  = szRop;
+    commit();
+}
+
+//---------------------------------------------------
+/**
+  * fillPage : queue KS0108Display::fillPage
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::fillPage(unsigned char szPage, unsigned char szPattern){
+    queueShape(K_KS0108_RENDER_FILL_PAGE, szPage, szPattern);
+}
+
+//---------------------------------------------------
+/**
+  * setStartLine : queue KS0108Display::setStartLine
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::setStartLine(unsigned char szStart){
+    queueShape(K_KS0108_RENDER_START_LINE, szStart, 0);
+}
+
+//---------------------------------------------------
+/**
+  * fence : mark the current end of the queue
+  *
+  * @return the number of the fence, reached when all the calls queued before it are on the panel
+  *
+*/
+//---------------------------------------------------
+unsigned int
+KS0108Renderer::fence(){
+    KS0108RenderCommand* pCommand = reserve(K_KS0108_RENDER_FENCE);
+
+    pCommand->nArgs[0] = ++m_nFenceQueued;
+    commit();
+    return m_nFenceQueued;
+}
+
+//---------------------------------------------------
+/**
+  * isFenceReached : check without blocking if a fence is reached
+  *
+  * @param nFence is the number returned by fence()
+  * @return true if all the calls queued before the fence are on the panel
+  *
+*/
+//---------------------------------------------------
+bool
+KS0108Renderer::isFenceReached(unsigned int nFence){
+    // Difference of free running counters, valid across the wrap around
+    return (int)(m_nFenceReached.load(std::memory_order_acquire) - nFence) >= 0;
+}
+
+//---------------------------------------------------
+/**
+  * waitFence : block until a fence is reached
+  *
+  * @param nFence is the number returned by fence()
+  * @note an exception thrown by a queued call is thrown again here
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::waitFence(unsigned int nFence){
+    std::exception_ptr pError;
+    std::unique_lock<std::mutex> lock(m_doneMutex);
+
+    m_doneCond.wait(lock, [this, nFence]{ return isFenceReached(nFence) || (m_pError != nullptr);});
+    if(m_pError != nullptr){
+        pError = m_pError;
+        m_pError = nullptr;
+        std::rethrow_exception(pError);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * reserve : get the next free slot of the queue
+  *
+  * @param szOp is the command stored in the slot
+  * @return the slot to fill before calling commit()
+  * @note the caller only waits when the queue is full
+  *
+*/
+//---------------------------------------------------
+KS0108RenderCommand*
+KS0108Renderer::reserve(unsigned char szOp){
+    KS0108RenderCommand* pCommand;
+    // Only the caller moves the head
+    unsigned int nHead = m_nHead.load(std::memory_order_relaxed);
+
+    if((nHead - m_nTail.load(std::memory_order_acquire)) >= K_KS0108_RENDER_QUEUE_SIZE){
+        m_nStalls++;
+        while((nHead - m_nTail.load(std::memory_order_acquire)) >= K_KS0108_RENDER_QUEUE_SIZE){
+            std::this_thread::yield();
+        }
+    }
+    pCommand = &m_commands[nHead % K_KS0108_RENDER_QUEUE_SIZE];
+    pCommand->szOp = szOp;
+    return pCommand;
+}
+
+//---------------------------------------------------
+/**
+  * commit : hand the slot filled after reserve() to the worker
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::commit(){
+    m_nHead.store(m_nHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    // Pairs with the fence of run() : either the worker sees the new head, or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(true == m_isWorkerWaiting.load(std::memory_order_relaxed)){
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeCond.notify_one();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * queueText : queue a command with a string
+  *
+  * @param szOp is the command
+  * @param pData is the string to copy
+  * @param nArg0 is the first argument
+  * @param nArg1 is the second argument
+  * @param nArg2 is the third argument
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::queueText(unsigned char szOp, const char* pData, int nArg0, int nArg1, int nArg2){
+    KS0108RenderCommand* pCommand;
+
+    if(NULL == pData){
+        throw std::invalid_argument("[Error] KS0108Renderer null string");
+    }
+    pCommand = reserve(szOp);
+    strncpy(pCommand->szText, pData, K_KS0108_RENDER_MAX_TEXT - 1);
+    pCommand->szText[K_KS0108_RENDER_MAX_TEXT - 1] = 0;
+    pCommand->nArgs[0]  = nArg0;
+    pCommand->nArgs[1]  = nArg1;
+    pCommand->nArgs[2]  = nArg2;
+    commit();
+}
+
+//---------------------------------------------------
+/**
+  * queueShape : queue a command with up to 5 arguments
+  *
+  * @param szOp is the command
+  * @param nArg0 to nArg4 are the arguments
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::queueShape(unsigned char szOp, int nArg0, int nArg1, int nArg2, int nArg3, int nArg4){
+    KS0108RenderCommand* pCommand = reserve(szOp);
+
+    pCommand->nArgs[0]  = nArg0;
+    pCommand->nArgs[1]  = nArg1;
+    pCommand->nArgs[2]  = nArg2;
+    pCommand->nArgs[3]  = nArg3;
+    pCommand->nArgs[4]  = nArg4;
+    commit();
+}
+
+//---------------------------------------------------
+/**
+  * run : body of the worker thread
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::run(){
+    unsigned int nTail;
+    bool isPending = false;
+
+    while(true){
+        // Only the worker moves the tail
+        nTail = m_nTail.load(std::memory_order_relaxed);
+        if(nTail == m_nHead.load(std::memory_order_acquire)){
+            // The queue is empty, the drawings queued meanwhile are sent together
+            if(true == isPending){
+                try{
+                    m_pDisplay->flush();
+                }catch(...){
+                    setError();
+                }
+                isPending = false;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_isWorkerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_wakeCond.wait(lock, [this, nTail]{ return (nTail != m_nHead.load(std::memory_order_acquire)) || m_isStopping;});
+            m_isWorkerWaiting.store(false, std::memory_order_relaxed);
+            if(nTail == m_nHead.load(std::memory_order_acquire)){
+                // Stopping and nothing left to draw
+                break;
+            }
+            continue;
+        }
+
+        const KS0108RenderCommand& command = m_commands[nTail % K_KS0108_RENDER_QUEUE_SIZE];
+        try{
+            if(K_KS0108_RENDER_FENCE == command.szOp){
+                m_pDisplay->flush();
+            }else{
+                execute(command);
+            }
+        }catch(...){
+            setError();
+        }
+
+        if(K_KS0108_RENDER_FENCE == command.szOp){
+            {
+                std::lock_guard<std::mutex> lock(m_doneMutex);
+                m_nFenceReached.store(command.nArgs[0], std::memory_order_release);
+            }
+            m_doneCond.notify_all();
+            isPending = false;
+        }else{
+            isPending = true;
+        }
+        // The slot is given back once the command no more uses it
+        m_nTail.store(nTail + 1, std::memory_order_release);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * setError : keep the exception being handled for waitFence
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::setError(){
+    {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        m_pError = std::current_exception();
+    }
+    m_doneCond.notify_all();
+}
+
+//---------------------------------------------------
+/**
+  * execute : call the display for a command
+  *
+  * @param command is the command taken from the queue
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Renderer::execute(const KS0108RenderCommand& command){
+    const int* pArgs = command.nArgs;
+
+    switch(command.szOp){
+        case K_KS0108_RENDER_CLS:
+            m_pDisplay->cls();
+            break;
+
+        case K_KS0108_RENDER_TEXT_AT_POS:
+            m_pDisplay->displayStringWithFontAtPosition(command.szText, pArgs[0], pArgs[1], pArgs[2]);
+            break;
+
+        case K_KS0108_RENDER_TEXT_AT_PIXEL:
+            m_pDisplay->displayStringWithFontAtPixel(command.szText, pArgs[0], pArgs[1], pArgs[2]);
+            break;
+
+        case K_KS0108_RENDER_DRAW_RECT:
+            m_pDisplay->drawRect(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_FILL_RECT:
+            m_pDisplay->fillRect(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_CLEAR_RECT:
+            m_pDisplay->clearRect(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_INVERT_RECT:
+            m_pDisplay->invertRect(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_DRAW_LINE:
+            m_pDisplay->drawLine(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_DRAW_CIRCLE:
+            m_pDisplay->drawCircle(pArgs[0], pArgs[1], pArgs[2]);
+            break;
+
+        case K_KS0108_RENDER_FILL_CIRCLE:
+            m_pDisplay->fillCircle(pArgs[0], pArgs[1], pArgs[2]);
+            break;
+
+        case K_KS0108_RENDER_DRAW_ELLIPSE:
+            m_pDisplay->drawEllipse(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_FILL_ELLIPSE:
+            m_pDisplay->fillEllipse(pArgs[0], pArgs[1], pArgs[2], pArgs[3]);
+            break;
+
+        case K_KS0108_RENDER_DRAW_ARC:
+            m_pDisplay->drawArc(pArgs[0], pArgs[1], pArgs[2], pArgs[3], pArgs[4]);
+            break;
+
+        case K_KS0108_RENDER_FILL_POLYGON:
+            m_pDisplay->fillPolygon(command.pData, pArgs[0]);
+            break;
+
+        case K_KS0108_RENDER_BLIT:
+            m_pDisplay->blit(command.pData, pArgs[0], pArgs[1], pArgs[2], pArgs[3], pArgs[4], pArgs[5]);
+            break;
+
+        case K_KS0108_RENDER_FILL_PAGE:
+            m_pDisplay->fillPage(pArgs[0], pArgs[1]);
+            break;
+
+        case K_KS0108_RENDER_START_LINE:
+            // The drawings queued before the scroll reach the panel first,
+            // the ones queued after it wait for the next flush
+            m_pDisplay->flush();
+            m_pDisplay->setStartLine(pArgs[0]);
+            m_pDisplay->flush();
+            break;
+
+        default:
+            throw std::invalid_argument("[Error] KS0108Renderer unknown command");
+    }
+}
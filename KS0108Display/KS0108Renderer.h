@@ -0,0 +1,394 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Renderer.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "KS0108Display.h"
+
+// Number of commands the queue holds, must be a power of 2
+const unsigned int  K_KS0108_RENDER_QUEUE_SIZE      = 64;
+// Longest string of a text command including the final 0, longer strings are truncated
+const unsigned int  K_KS0108_RENDER_MAX_TEXT        = 32;
+// Number of integer arguments of a command
+const unsigned int  K_KS0108_RENDER_MAX_ARGS        = 6;
+
+// A drawing call waiting in the queue
+struct KS0108RenderCommand{
+    unsigned char           szOp;
+    int                     nArgs[K_KS0108_RENDER_MAX_ARGS];
+    const unsigned char*    pData;
+    char                    szText[K_KS0108_RENDER_MAX_TEXT];
+};
+
+class KS0108Renderer{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param display is the initialized display to draw on
+          *
+          * The drawing calls are queued and a worker thread sends them to the panel.
+          * The display is put in retained mode and flushed each time the queue is empty,
+          * so drawings queued while the bus is busy are sent together.
+          * @note the calls must all be done by the same thread, and the display must not
+          *       be used directly while the renderer exists
+        */
+        //---------------------------------------------------
+        KS0108Renderer(KS0108Display& display);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+          *
+          * The queued drawings are sent before the worker thread is stopped
+        */
+        //---------------------------------------------------
+        virtual ~KS0108Renderer();
+
+        //---------------------------------------------------
+        /**
+          * cls : queue KS0108Display::cls
+          *
+        */
+        //---------------------------------------------------
+        void cls();
+
+        //---------------------------------------------------
+        /**
+          * displayStringAtPosition : queue KS0108Display::displayStringAtPosition
+          *
+          * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+          *
+        */
+        //---------------------------------------------------
+        void displayStringAtPosition(const char* pData, unsigned char szLine, unsigned char szCol = 0);
+
+        //---------------------------------------------------
+        /**
+          * displayStringWithFontAtPosition : queue KS0108Display::displayStringWithFontAtPosition
+          *
+          * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+          *
+        */
+        //---------------------------------------------------
+        void displayStringWithFontAtPosition(const char* pData, unsigned char szFont, unsigned char szLine, unsigned char szCol);
+
+        //---------------------------------------------------
+        /**
+          * displayStringAtPixel : queue KS0108Display::displayStringAtPixel
+          *
+          * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+          *
+        */
+        //---------------------------------------------------
+        void displayStringAtPixel(const char* pData, unsigned char szX, unsigned char szY);
+
+        //---------------------------------------------------
+        /**
+          * displayStringWithFontAtPixel : queue KS0108Display::displayStringWithFontAtPixel
+          *
+          * @note the string is copied, up to K_KS0108_RENDER_MAX_TEXT - 1 characters
+          *
+        */
+        //---------------------------------------------------
+        void displayStringWithFontAtPixel(const char* pData, unsigned char szFont, unsigned char szX, unsigned char szY);
+
+        //---------------------------------------------------
+        /**
+          * drawRect : queue KS0108Display::drawRect
+          *
+        */
+        //---------------------------------------------------
+        void drawRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * fillRect : queue KS0108Display::fillRect
+          *
+        */
+        //---------------------------------------------------
+        void fillRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * clearRect : queue KS0108Display::clearRect
+          *
+        */
+        //---------------------------------------------------
+        void clearRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * invertRect : queue KS0108Display::invertRect
+          *
+        */
+        //---------------------------------------------------
+        void invertRect(unsigned char szX, unsigned char szY, unsigned char szL, unsigned char szW);
+
+        //---------------------------------------------------
+        /**
+          * drawLine : queue KS0108Display::drawLine
+          *
+        */
+        //---------------------------------------------------
+        void drawLine(unsigned char szXo, unsigned char szYo, unsigned char szXd, unsigned char szYd);
+
+        //---------------------------------------------------
+        /**
+          * drawCircle : queue KS0108Display::drawCircle
+          *
+        */
+        //---------------------------------------------------
+        void drawCircle(unsigned char szXc, unsigned char szYc, unsigned char szR);
+
+        //---------------------------------------------------
+        /**
+          * fillCircle : queue KS0108Display::fillCircle
+          *
+        */
+        //---------------------------------------------------
+        void fillCircle(unsigned char szXc, unsigned char szYc, unsigned char szR);
+
+        //---------------------------------------------------
+        /**
+          * drawEllipse : queue KS0108Display::drawEllipse
+          *
+        */
+        //---------------------------------------------------
+        void drawEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy);
+
+        //---------------------------------------------------
+        /**
+          * fillEllipse : queue KS0108Display::fillEllipse
+          *
+        */
+        //---------------------------------------------------
+        void fillEllipse(unsigned char szXc, unsigned char szYc, unsigned char szRx, unsigned char szRy);
+
+        //---------------------------------------------------
+        /**
+          * drawArc : queue KS0108Display::drawArc
+          *
+        */
+        //---------------------------------------------------
+        void drawArc(unsigned char szXc, unsigned char szYc, unsigned char szR, int nStart, int nEnd);
+
+        //---------------------------------------------------
+        /**
+          * fillPolygon : queue KS0108Display::fillPolygon
+          *
+          * @note the vertices are not copied, they must not change until a fence placed after this call is reached
+          *
+        */
+        //---------------------------------------------------
+        void fillPolygon(const unsigned char* pPoints, unsigned char szNbPoints);
+
+        //---------------------------------------------------
+        /**
+          * drawBitmap : queue KS0108Display::drawBitmap
+          *
+          * @note the bitmap is not copied, it must not change until a fence placed after this call is reached
+          *
+        */
+        //---------------------------------------------------
+        void drawBitmap(const unsigned char *pData, unsigned char szX, unsigned char szY, unsigned char szDx, unsigned char szDy);
+
+        //---------------------------------------------------
+        /**
+          * blit : queue KS0108Display::blit
+          *
+          * @note the bitmap is not copied, it must not change until a fence placed after this call is reached
+          *
+        */
+        //---------------------------------------------------
+        void blit(const unsigned char *pData, unsigned int nStride, int nX, int nY, unsigned char szDx, unsigned char szDy, unsigned char szRop = K_KS0108_ROP_COPY);
+
+        //---------------------------------------------------
+        /**
+          * fillPage : queue KS0108Display::fillPage
+          *
+        */
+        //---------------------------------------------------
+        void fillPage(unsigned char szPage, unsigned char szPattern);
+
+        //---------------------------------------------------
+        /**
+          * setStartLine : queue KS0108Display::setStartLine
+          *
+        */
+        //---------------------------------------------------
+        void setStartLine(unsigned char szStart);
+
+        //---------------------------------------------------
+        /**
+          * fence : mark the current end of the queue
+          *
+          * @return the number of the fence, reached when all the calls queued before it are on the panel
+          *
+        */
+        //---------------------------------------------------
+        unsigned int fence();
+
+        //---------------------------------------------------
+        /**
+          * isFenceReached : check without blocking if a fence is reached
+          *
+          * @param nFence is the number returned by fence()
+          * @return true if all the calls queued before the fence are on the panel
+          *
+        */
+        //---------------------------------------------------
+        bool isFenceReached(unsigned int nFence);
+
+        //---------------------------------------------------
+        /**
+          * waitFence : block until a fence is reached
+          *
+          * @param nFence is the number returned by fence()
+          * @note an exception thrown by a queued call is thrown again here
+          *
+        */
+        //---------------------------------------------------
+        void waitFence(unsigned int nFence);
+
+        //---------------------------------------------------
+        /**
+          * waitIdle : block until all the queued calls are on the panel
+          *
+          * @note an exception thrown by a queued call is thrown again here
+          *
+        */
+        //---------------------------------------------------
+        inline void waitIdle(){ waitFence(fence());}
+
+        //---------------------------------------------------
+        /**
+          * getStallCount :
+          *
+          * @return the number of times a call found the queue full and waited for the worker
+          *
+        */
+        //---------------------------------------------------
+        inline unsigned int getStallCount(){ return m_nStalls;}
+
+    private:
+        // Display drawn by the worker thread
+        KS0108Display* m_pDisplay;
+
+        // Retained mode of the display before the renderer was created
+        bool m_wasRetainedMode;
+
+        // Ring of commands, written by the caller and read by the worker
+        KS0108RenderCommand m_commands[K_KS0108_RENDER_QUEUE_SIZE];
+        // Free running counters, the slot is the counter modulo the queue size
+        std::atomic<unsigned int> m_nHead;
+        std::atomic<unsigned int> m_nTail;
+
+        // Number of times the queue was full, only used by the caller
+        unsigned int m_nStalls;
+
+        // Last fence queued by the caller and last fence reached by the worker
+        unsigned int m_nFenceQueued;
+        std::atomic<unsigned int> m_nFenceReached;
+
+        // Error thrown by a queued call, given back by waitFence
+        std::exception_ptr m_pError;
+
+        // Wake up of the worker when the queue is no more empty
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wakeCond;
+        std::atomic<bool> m_isWorkerWaiting;
+        bool m_isStopping;
+
+        // Wake up of the callers of waitFence
+        std::mutex m_doneMutex;
+        std::condition_variable m_doneCond;
+
+        std::thread m_worker;
+
+        //---------------------------------------------------
+        /**
+          * reserve : get the next free slot of the queue
+          *
+          * @param szOp is the command stored in the slot
+          * @return the slot to fill before calling commit()
+          * @note the caller only waits when the queue is full
+          *
+        */
+        //---------------------------------------------------
+        KS0108RenderCommand* reserve(unsigned char szOp);
+
+        //---------------------------------------------------
+        /**
+          * commit : hand the slot filled after reserve() to the worker
+          *
+        */
+        //---------------------------------------------------
+        void commit();
+
+        //---------------------------------------------------
+        /**
+          * queueText : queue a command with a string
+          *
+          * @param szOp is the command
+          * @param pData is the string to copy
+          * @param nArg0 is the first argument
+          * @param nArg1 is the second argument
+          * @param nArg2 is the third argument
+          *
+        */
+        //---------------------------------------------------
+        void queueText(unsigned char szOp, const char* pData, int nArg0, int nArg1, int nArg2);
+
+        //---------------------------------------------------
+        /**
+          * queueShape : queue a command with up to 5 arguments
+          *
+          * @param szOp is the command
+          * @param nArg0 to nArg4 are the arguments
+          *
+        */
+        //---------------------------------------------------
+        void queueShape(unsigned char szOp, int nArg0, int nArg1, int nArg2 = 0, int nArg3 = 0, int nArg4 = 0);
+
+        //---------------------------------------------------
+        /**
+          * run : body of the worker thread
+          *
+        */
+        //---------------------------------------------------
+        void run();
+
+        //---------------------------------------------------
+        /**
+          * setError : keep the exception being handled for waitFence
+          *
+        */
+        //---------------------------------------------------
+        void setError();
+
+        //---------------------------------------------------
+        /**
+          * execute : call the display for a command
+          *
+          * @param command is the command taken from the queue
+          *
+        */
+        //---------------------------------------------------
+        void execute(const KS0108RenderCommand& command);
+};
@@ -0,0 +1,453 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Simulator.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "KS0108Simulator.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  *
+  * Two PCF8574 drive the panel: the data port is wired to D0-D7,
+  * the command port to RS, R/W, EN, CS1, CS2 and RST
+*/
+//---------------------------------------------------
+KS0108Simulator::KS0108Simulator(){
+    unsigned char szCtrl;
+
+    m_dataPort.connect(this, K_KS0108_SIM_DATA_PORT);
+    m_cmdPort.connect(this, K_KS0108_SIM_CMD_PORT);
+    // A real panel powers on with random display RAM, the model clears it
+    for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+        memset(&m_ctrl[szCtrl], 0, sizeof(KS0108SimController));
+    }
+    m_szCmd         = m_cmdPort.getLatch();
+    m_isReset       = false;
+    m_nEnRise       = 0;
+    m_nBusyTime     = K_KS0108_SIM_BUSY_TIME;
+    reset();
+    resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+KS0108Simulator::~KS0108Simulator(){
+}
+
+//---------------------------------------------------
+/**
+  * attach : connect the expanders of the panel to a bus
+  *
+  * @param bus is the simulated bus
+  * @param szDataAddres is the I2C addres of the data expander
+  * @param szCmdAddres is the I2C addres of the command expander
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::attach(SimulatedBus& bus, unsigned char szDataAddres, unsigned char szCmdAddres){
+    bus.attach(szDataAddres, &m_dataPort);
+    bus.attach(szCmdAddres, &m_cmdPort);
+}
+
+//---------------------------------------------------
+/**
+  * setBusyTime : change the execution time of the controllers
+  *
+  * @param nBusyTime is the time in ns
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::setBusyTime(unsigned int nBusyTime){
+    m_nBusyTime = nBusyTime;
+}
+
+//---------------------------------------------------
+/**
+  * isPixelOn :
+  *
+  * @param szX is the column from 0 to 127
+  * @param szY is the line from 0 to 63
+  * @return true if the pixel is displayed
+*/
+//---------------------------------------------------
+bool
+KS0108Simulator::isPixelOn(unsigned char szX, unsigned char szY){
+    KS0108SimController* pCtrl;
+    unsigned char szLine;
+
+    if((szX >= K_KS0108_SCREEN_WIDTH) || (szY >= K_KS0108_SCREEN_HEIGHT)){
+        throw std::invalid_argument("[Error] isPixelOn arg out of range");
+    }
+    pCtrl = &m_ctrl[szX / K_KS0108_X_PIXELS_PER_CTRL];
+    if(false == pCtrl->isOn){
+        return false;
+    }
+    // The start line is the RAM line shown at the top of the screen
+    szLine = (szY + pCtrl->szStartLine) % K_KS0108_SCREEN_HEIGHT;
+    return (0 != (pCtrl->szRam[szLine / K_KS0108_PIXELS_PER_PAGE][szX % K_KS0108_X_PIXELS_PER_CTRL] & (1 << (szLine % K_KS0108_PIXELS_PER_PAGE))));
+}
+
+//---------------------------------------------------
+/**
+  * getImage : get the displayed image
+  *
+  * @param pImage receives the image with the layout of the display RAM,
+  *               start line and display off are applied
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::getImage(unsigned char pImage[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH]){
+    unsigned char szX, szY;
+
+    memset(pImage, 0, K_KS0108_PAGES_PER_CTRL * K_KS0108_SCREEN_WIDTH);
+    for(szY = 0; szY < K_KS0108_SCREEN_HEIGHT; szY++){
+        for(szX = 0; szX < K_KS0108_SCREEN_WIDTH; szX++){
+            if(true == isPixelOn(szX, szY)){
+                pImage[szY / K_KS0108_PIXELS_PER_PAGE][szX] |= (1 << (szY % K_KS0108_PIXELS_PER_PAGE));
+            }
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writePbm : save the displayed image
+  *
+  * @param pFileName is the name of the binary PBM file
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::writePbm(const char* pFileName){
+    unsigned char szRow[K_KS0108_SCREEN_WIDTH / 8];
+    unsigned char szY;
+    bool isWritten = true;
+    FILE* pFile = fopen(pFileName, "wb");
+
+    if(NULL == pFile){
+        throw std::runtime_error("[Error] cannot create the image file");
+    }
+    fprintf(pFile, "P4\n%u %u\n", K_KS0108_SCREEN_WIDTH, K_KS0108_SCREEN_HEIGHT);
+    for(szY = 0; szY < K_KS0108_SCREEN_HEIGHT; szY++){
+        getPbmRow(szY, szRow);
+        if(sizeof(szRow) != fwrite(szRow, 1, sizeof(szRow), pFile)){
+            isWritten = false;
+        }
+    }
+    if((0 != fclose(pFile)) || (false == isWritten)){
+        throw std::runtime_error("[Error] cannot write the image file");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * isMatchingPbm : compare the displayed image with a golden image
+  *
+  * @param pFileName is the name of a binary PBM file written by writePbm()
+  * @return true if every pixel is the same
+  *
+*/
+//---------------------------------------------------
+bool
+KS0108Simulator::isMatchingPbm(const char* pFileName){
+    unsigned char szRow[K_KS0108_SCREEN_WIDTH / 8];
+    unsigned char szGolden[K_KS0108_SCREEN_WIDTH / 8];
+    unsigned int nWidth = 0, nHeight = 0;
+    unsigned char szY;
+    bool isMatching;
+    FILE* pFile = fopen(pFileName, "rb");
+
+    if(NULL == pFile){
+        throw std::runtime_error("[Error] cannot open the image file");
+    }
+    // Only the header written by writePbm() is understood
+    isMatching = (2 == fscanf(pFile, "P4 %u %u", &nWidth, &nHeight)) && ('\n' == fgetc(pFile))
+                 && (K_KS0108_SCREEN_WIDTH == nWidth) && (K_KS0108_SCREEN_HEIGHT == nHeight);
+    for(szY = 0; (szY < K_KS0108_SCREEN_HEIGHT) && (true == isMatching); szY++){
+        getPbmRow(szY, szRow);
+        isMatching = (sizeof(szGolden) == fread(szGolden, 1, sizeof(szGolden), pFile))
+                     && (0 == memcmp(szRow, szGolden, sizeof(szRow)));
+    }
+    fclose(pFile);
+    return isMatching;
+}
+
+//---------------------------------------------------
+/**
+  * resetStats : set the counters to 0
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::resetStats(){
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_dataPort.resetStats();
+    m_cmdPort.resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * portChanged : an expander was written
+  *
+  * @param nPort is K_KS0108_SIM_DATA_PORT or K_KS0108_SIM_CMD_PORT
+  * @param szLatch is the new latch of the expander
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::portChanged(unsigned int nPort, unsigned char szLatch, unsigned long long nTime){
+    unsigned char szOld = m_szCmd;
+    unsigned char szCtrl;
+
+    // The data lines are only sampled on the falling edge of EN
+    if(K_KS0108_SIM_CMD_PORT != nPort){
+        return;
+    }
+    m_szCmd = szLatch;
+
+    // RST is active low
+    if(0 == (m_szCmd & K_KS0108_RST_MASK)){
+        if(false == m_isReset){
+            m_isReset = true;
+            m_stats.nResets++;
+        }
+        reset();
+        return;
+    }
+    m_isReset = false;
+
+    // Rising edge of EN
+    if((0 == (szOld & K_KS0108_EN_MASK)) && (0 != (m_szCmd & K_KS0108_EN_MASK))){
+        if((0 != m_nEnRise) && (nTime - m_nEnRise < K_KS0108_SIM_MIN_EN_CYCLE)){
+            m_stats.nPulseViolations++;
+        }
+        // RS and R/W must be stable before EN goes up
+        if(0 != ((szOld ^ m_szCmd) & (K_KS0108_RS_MASK | K_KS0108_RW_MASK))){
+            m_stats.nSetupViolations++;
+        }
+        m_nEnRise = nTime;
+    }
+
+    // Falling edge of EN
+    if((0 != (szOld & K_KS0108_EN_MASK)) && (0 == (m_szCmd & K_KS0108_EN_MASK))){
+        m_stats.nEnPulses++;
+        if(nTime - m_nEnRise < K_KS0108_SIM_MIN_EN_PULSE){
+            m_stats.nPulseViolations++;
+        }
+        // RS and R/W are the ones of the pulse, the driver never changes them with EN
+        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+            if(true == isSelected(szCtrl)){
+                strobe(szCtrl, nTime);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * drivePort : levels put on the data bus by the controllers
+  *
+  * @param nPort is K_KS0108_SIM_DATA_PORT or K_KS0108_SIM_CMD_PORT
+  * @param szDriven receives the driven pins
+  * @param nTime is the virtual time in ns
+  * @return the levels of the driven pins
+  *
+*/
+//---------------------------------------------------
+unsigned char
+KS0108Simulator::drivePort(unsigned int nPort, unsigned char& szDriven, unsigned long long nTime){
+    unsigned char szCtrl;
+    unsigned char szLevels = 0xFF;
+    unsigned char szStatus;
+    unsigned int nNbDrivers = 0;
+
+    szDriven = 0;
+    // The controllers only drive D0-D7 during a read pulse
+    if((K_KS0108_SIM_DATA_PORT != nPort) || (true == m_isReset)
+       || (0 == (m_szCmd & K_KS0108_EN_MASK)) || (0 == (m_szCmd & K_KS0108_RW_MASK))){
+        return szLevels;
+    }
+    for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+        if(false == isSelected(szCtrl)){
+            continue;
+        }
+        nNbDrivers++;
+        if(0 != (m_szCmd & K_KS0108_RS_MASK)){
+            szLevels &= m_ctrl[szCtrl].szOutput;
+        }else{
+            // BUSY 0 ON/OFF RESET 0 0 0 0
+            szStatus = (false == m_ctrl[szCtrl].isOn) ? K_KS0108_SIM_STATUS_OFF : 0;
+            if(nTime < m_ctrl[szCtrl].nBusyUntil){
+                szStatus |= K_KS0108_DISPLAY_STATUS_BUSY;
+                m_stats.nBusyStatus++;
+            }
+            szLevels &= szStatus;
+        }
+    }
+    if(nNbDrivers > 1){
+        m_stats.nReadContentions++;
+    }
+    if(0 != nNbDrivers){
+        szDriven = 0xFF;
+    }
+    return szLevels;
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * getPbmRow : encode a line of the displayed image
+  *
+  * @param szY is the line from 0 to 63
+  * @param pRow receives the pixels, most significant bit first, 1 is black
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::getPbmRow(unsigned char szY, unsigned char pRow[K_KS0108_SCREEN_WIDTH / 8]){
+    unsigned char szX;
+
+    memset(pRow, 0, K_KS0108_SCREEN_WIDTH / 8);
+    for(szX = 0; szX < K_KS0108_SCREEN_WIDTH; szX++){
+        if(true == isPixelOn(szX, szY)){
+            pRow[szX / 8] |= (0x80 >> (szX % 8));
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * isSelected :
+  *
+  * @param szCtrl is the controller
+  * @return true if the chip select of the controller is active
+*/
+//---------------------------------------------------
+bool
+KS0108Simulator::isSelected(unsigned char szCtrl){
+    // The panel selects its halves with active high chip selects
+    return (0 != (m_szCmd & ((0 == szCtrl) ? K_KS0108_CS1_MASK : K_KS0108_CS2_MASK)));
+}
+
+//---------------------------------------------------
+/**
+  * reset : put the controllers in their reset state
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::reset(){
+    unsigned char szCtrl;
+
+    // Display off and start line 0, the display RAM is kept
+    for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+        m_ctrl[szCtrl].isOn         = false;
+        m_ctrl[szCtrl].szStartLine  = 0;
+        m_ctrl[szCtrl].szY          = 0;
+        m_ctrl[szCtrl].nBusyUntil   = 0;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * strobe : falling edge of EN, the controller does the operation
+  *
+  * @param szCtrl is the controller
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::strobe(unsigned char szCtrl, unsigned long long nTime){
+    KS0108SimController* pCtrl = &m_ctrl[szCtrl];
+    bool isData = (0 != (m_szCmd & K_KS0108_RS_MASK));
+
+    if(0 != (m_szCmd & K_KS0108_RW_MASK)){
+        if(false == isData){
+            m_stats.nStatusReads++;
+            return;
+        }
+        // The output register is loaded at the end of the read,
+        // the next read returns it: a dummy read follows each address change
+        if(nTime < pCtrl->nBusyUntil){
+            m_stats.nBusyViolations++;
+            return;
+        }
+        m_stats.nDataReads++;
+        pCtrl->szOutput = pCtrl->szRam[pCtrl->szPage][pCtrl->szY];
+        pCtrl->szY = (pCtrl->szY + 1) % K_KS0108_X_PIXELS_PER_CTRL;
+        pCtrl->nBusyUntil = nTime + m_nBusyTime;
+        return;
+    }
+
+    // The controller ignores the writes while it is busy
+    if(nTime < pCtrl->nBusyUntil){
+        m_stats.nBusyViolations++;
+        return;
+    }
+    if(true == isData){
+        m_stats.nDataWrites++;
+        pCtrl->szRam[pCtrl->szPage][pCtrl->szY] = m_dataPort.getLatch();
+        pCtrl->szY = (pCtrl->szY + 1) % K_KS0108_X_PIXELS_PER_CTRL;
+    }else{
+        execute(szCtrl, m_dataPort.getLatch());
+    }
+    pCtrl->nBusyUntil = nTime + m_nBusyTime;
+}
+
+//---------------------------------------------------
+/**
+  * execute : run an instruction
+  *
+  * @param szCtrl is the controller
+  * @param szData is the instruction
+  *
+*/
+//---------------------------------------------------
+void
+KS0108Simulator::execute(unsigned char szCtrl, unsigned char szData){
+    KS0108SimController* pCtrl = &m_ctrl[szCtrl];
+
+    m_stats.nCommands++;
+    if((szData & 0xFE) == K_KS0108_DISPLAY_ON_CMD){
+        // 0 0 1 1 1 1 1 D
+        pCtrl->isOn = (0 != (szData & K_KS0108_ON));
+        m_stats.nDisplayOnOff++;
+    }else if((szData & 0xC0) == K_KS0108_DISPLAY_SET_Y){
+        // 0 1 Y Y Y Y Y Y
+        pCtrl->szY = szData & 0x3F;
+        m_stats.nYSets++;
+    }else if((szData & 0xF8) == K_KS0108_DISPLAY_SET_X){
+        // 1 0 1 1 1 X X X
+        pCtrl->szPage = szData & 0x07;
+        m_stats.nPageSets++;
+    }else if((szData & 0xC0) == K_KS0108_DISPLAY_START_LINE){
+        // 1 1 L L L L L L
+        pCtrl->szStartLine = szData & 0x3F;
+        m_stats.nStartLines++;
+    }else{
+        m_stats.nUnknownCommands++;
+    }
+}
@@ -0,0 +1,269 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108Simulator.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "../I2cBus/SimulatedBus.h"
+#include "../I2cBus/Pcf8574Simulator.h"
+#include "KS0108Display.h"
+
+// Time a controller stays busy after an operation, in ns
+const unsigned int  K_KS0108_SIM_BUSY_TIME          = 10000;
+// Minimum width of the EN pulse and of the EN cycle, in ns
+const unsigned int  K_KS0108_SIM_MIN_EN_PULSE       = 450;
+const unsigned int  K_KS0108_SIM_MIN_EN_CYCLE       = 1000;
+
+// ON/OFF bit of the status register, set when the display is off
+const unsigned char K_KS0108_SIM_STATUS_OFF         = 0x20;
+
+// Port numbers given to the expanders
+const unsigned int  K_KS0108_SIM_DATA_PORT          = 0;
+const unsigned int  K_KS0108_SIM_CMD_PORT           = 1;
+
+// Protocol events seen by the panel
+struct KS0108SimStats{
+    // Falling edges of EN, whatever the selected controllers
+    unsigned long long nEnPulses;
+    // Operations done by a controller, a broadcast counts once per controller
+    unsigned long long nCommands;
+    unsigned long long nDisplayOnOff;
+    unsigned long long nStartLines;
+    unsigned long long nPageSets;
+    unsigned long long nYSets;
+    unsigned long long nUnknownCommands;
+    unsigned long long nDataWrites;
+    unsigned long long nDataReads;
+    unsigned long long nStatusReads;
+    // Status reads answering busy
+    unsigned long long nBusyStatus;
+    // Operations lost because the controller was busy
+    unsigned long long nBusyViolations;
+    // EN pulses or cycles shorter than the minimum
+    unsigned long long nPulseViolations;
+    // EN raised in the same expander write as RS or R/W
+    unsigned long long nSetupViolations;
+    // Reads with both controllers driving the data bus
+    unsigned long long nReadContentions;
+    unsigned long long nResets;
+};
+
+// Registers and display RAM of a controller
+struct KS0108SimController{
+    unsigned char szRam[K_KS0108_PAGES_PER_CTRL][K_KS0108_X_PIXELS_PER_CTRL];
+    unsigned char szPage;
+    unsigned char szY;
+    unsigned char szStartLine;
+    bool isOn;
+    // Output register, loaded by the data reads
+    unsigned char szOutput;
+    // Virtual time in ns when the current operation ends
+    unsigned long long nBusyUntil;
+};
+
+class KS0108Simulator : public Pcf8574Peripheral{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          *
+          * Two PCF8574 drive the panel: the data port is wired to D0-D7,
+          * the command port to RS, R/W, EN, CS1, CS2 and RST
+        */
+        //---------------------------------------------------
+        KS0108Simulator();
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~KS0108Simulator();
+
+        //---------------------------------------------------
+        /**
+          * attach : connect the expanders of the panel to a bus
+          *
+          * @param bus is the simulated bus
+          * @param szDataAddres is the I2C addres of the data expander
+          * @param szCmdAddres is the I2C addres of the command expander
+          *
+        */
+        //---------------------------------------------------
+        void attach(SimulatedBus& bus, unsigned char szDataAddres, unsigned char szCmdAddres);
+
+        //---------------------------------------------------
+        /**
+          * setBusyTime : change the execution time of the controllers
+          *
+          * @param nBusyTime is the time in ns
+          *
+        */
+        //---------------------------------------------------
+        void setBusyTime(unsigned int nBusyTime);
+
+        //---------------------------------------------------
+        /**
+          * isPixelOn :
+          *
+          * @param szX is the column from 0 to 127
+          * @param szY is the line from 0 to 63
+          * @return true if the pixel is displayed
+        */
+        //---------------------------------------------------
+        bool isPixelOn(unsigned char szX, unsigned char szY);
+
+        //---------------------------------------------------
+        /**
+          * getImage : get the displayed image
+          *
+          * @param pImage receives the image with the layout of the display RAM,
+          *               start line and display off are applied
+          *
+        */
+        //---------------------------------------------------
+        void getImage(unsigned char pImage[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH]);
+
+        //---------------------------------------------------
+        /**
+          * writePbm : save the displayed image
+          *
+          * @param pFileName is the name of the binary PBM file
+          *
+        */
+        //---------------------------------------------------
+        void writePbm(const char* pFileName);
+
+        //---------------------------------------------------
+        /**
+          * isMatchingPbm : compare the displayed image with a golden image
+          *
+          * @param pFileName is the name of a binary PBM file written by writePbm()
+          * @return true if every pixel is the same
+          *
+        */
+        //---------------------------------------------------
+        bool isMatchingPbm(const char* pFileName);
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the protocol events seen by the panel
+        */
+        //---------------------------------------------------
+        inline const KS0108SimStats& getStats(){ return m_stats;}
+
+        //---------------------------------------------------
+        /**
+          * resetStats : set the counters to 0
+          *
+        */
+        //---------------------------------------------------
+        void resetStats();
+
+        //---------------------------------------------------
+        /**
+          * portChanged : an expander was written
+          *
+          * @param nPort is K_KS0108_SIM_DATA_PORT or K_KS0108_SIM_CMD_PORT
+          * @param szLatch is the new latch of the expander
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void portChanged(unsigned int nPort, unsigned char szLatch, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * drivePort : levels put on the data bus by the controllers
+          *
+          * @param nPort is K_KS0108_SIM_DATA_PORT or K_KS0108_SIM_CMD_PORT
+          * @param szDriven receives the driven pins
+          * @param nTime is the virtual time in ns
+          * @return the levels of the driven pins
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char drivePort(unsigned int nPort, unsigned char& szDriven, unsigned long long nTime);
+
+    private:
+        // Expanders
+        Pcf8574Simulator m_dataPort;
+        Pcf8574Simulator m_cmdPort;
+
+        // Controllers, the first one is selected by CS1
+        KS0108SimController m_ctrl[K_KS0108_NB_CTRL];
+
+        // Control lines
+        unsigned char m_szCmd;
+        bool m_isReset;
+
+        // Virtual time of the last rising edge of EN
+        unsigned long long m_nEnRise;
+
+        unsigned int m_nBusyTime;
+
+        // Counters
+        KS0108SimStats m_stats;
+
+        //---------------------------------------------------
+        /**
+          * getPbmRow : encode a line of the displayed image
+          *
+          * @param szY is the line from 0 to 63
+          * @param pRow receives the pixels, most significant bit first, 1 is black
+          *
+        */
+        //---------------------------------------------------
+        void getPbmRow(unsigned char szY, unsigned char pRow[K_KS0108_SCREEN_WIDTH / 8]);
+
+        //---------------------------------------------------
+        /**
+          * isSelected :
+          *
+          * @param szCtrl is the controller
+          * @return true if the chip select of the controller is active
+        */
+        //---------------------------------------------------
+        bool isSelected(unsigned char szCtrl);
+
+        //---------------------------------------------------
+        /**
+          * reset : put the controllers in their reset state
+          *
+        */
+        //---------------------------------------------------
+        void reset();
+
+        //---------------------------------------------------
+        /**
+          * strobe : falling edge of EN, the controller does the operation
+          *
+          * @param szCtrl is the controller
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        void strobe(unsigned char szCtrl, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * execute : run an instruction
+          *
+          * @param szCtrl is the controller
+          * @param szData is the instruction
+          *
+        */
+        //---------------------------------------------------
+        void execute(unsigned char szCtrl, unsigned char szData);
+};
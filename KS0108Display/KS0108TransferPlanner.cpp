@@ -0,0 +1,267 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108TransferPlanner.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "KS0108TransferPlanner.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  *
+  * The planner turns the difference between two frames into the
+  * ordered list of runs that is the cheapest to send
+*/
+//---------------------------------------------------
+KS0108TransferPlanner::KS0108TransferPlanner(){
+    m_nWriteCost    = K_KS0108_COST_WRITE;
+    m_nCommandCost  = K_KS0108_COST_COMMAND;
+    m_nSelectCost   = K_KS0108_COST_SELECT;
+    m_nNbRuns       = 0;
+    memset(m_runs, 0, sizeof(m_runs));
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(m_isNeeded, 0, sizeof(m_isNeeded));
+    memset(m_isWritable, 0, sizeof(m_isWritable));
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+KS0108TransferPlanner::~KS0108TransferPlanner(){
+}
+
+//---------------------------------------------------
+/**
+  * setCostModel : set the cost of the operations
+  *
+  * @param nWriteCost is the cost of a data write
+  * @param nCommandCost is the cost of a Y address or a page command
+  * @param nSelectCost is the cost of a change of controller
+  *
+*/
+//---------------------------------------------------
+void
+KS0108TransferPlanner::setCostModel(unsigned int nWriteCost, unsigned int nCommandCost, unsigned int nSelectCost){
+    m_nWriteCost    = nWriteCost;
+    m_nCommandCost  = nCommandCost;
+    m_nSelectCost   = nSelectCost;
+}
+
+//---------------------------------------------------
+/**
+  * plan : compute the runs that change a frame into another one
+  *
+  * @param pOld is what the panel holds
+  * @param pNew is what the panel must hold
+  * @param pIsSynced tells for each page if pOld is known, NULL if all of them are known
+  * @param szPages selects the pages to plan, one bit per page
+  * @return the number of runs
+  * @note the runs are grouped by controller, broadcast runs first,
+  *       writing through a gap is chosen when it is cheaper than a jump
+  *
+*/
+//---------------------------------------------------
+unsigned int
+KS0108TransferPlanner::plan(const unsigned char pOld[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH],
+                            const unsigned char pNew[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH],
+                            const bool* pIsSynced, unsigned char szPages){
+    unsigned char szPage, szGroup, szCtrl;
+    unsigned int nSplitCost, nBroadcastCost;
+    unsigned int nFirstRun;
+    bool isSynced;
+    bool isBroadcast[K_KS0108_PAGES_PER_CTRL];
+    bool hasSelected = false;
+    unsigned char szSelected = 0;
+
+    m_nNbRuns = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    // Each page is written either by controller, or with the columns
+    // identical in both halves broadcast and the others by controller
+    for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+        isBroadcast[szPage] = false;
+        if(0 == (szPages & (1 << szPage))){
+            continue;
+        }
+        isSynced = (NULL == pIsSynced) || pIsSynced[szPage];
+
+        preparePage(pOld[szPage], pNew[szPage], isSynced, false);
+        nSplitCost = 0;
+        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+            nSplitCost += planGroup(szCtrl, szPage, false);
+        }
+
+        preparePage(pOld[szPage], pNew[szPage], isSynced, true);
+        nBroadcastCost = planGroup(K_KS0108_ALL_CTRL, szPage, false);
+        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+            nBroadcastCost += planGroup(szCtrl, szPage, false);
+        }
+
+        isBroadcast[szPage] = (nBroadcastCost < nSplitCost);
+        if((0 != nSplitCost) || (0 != nBroadcastCost)){
+            m_stats.nPages++;
+        }
+    }
+
+    // Controller major order : the chip selects only change between groups
+    for(szGroup = 0; szGroup <= K_KS0108_NB_CTRL; szGroup++){
+        // Broadcast group first, the controllers then
+        szCtrl = (0 == szGroup) ? K_KS0108_ALL_CTRL : szGroup - 1;
+        nFirstRun = m_nNbRuns;
+        for(szPage = 0; szPage < K_KS0108_PAGES_PER_CTRL; szPage++){
+            if(0 == (szPages & (1 << szPage))){
+                continue;
+            }
+            if((K_KS0108_ALL_CTRL == szCtrl) && (false == isBroadcast[szPage])){
+                continue;
+            }
+            isSynced = (NULL == pIsSynced) || pIsSynced[szPage];
+            preparePage(pOld[szPage], pNew[szPage], isSynced, isBroadcast[szPage]);
+            m_stats.nCost += planGroup(szCtrl, szPage, true);
+        }
+        if((m_nNbRuns != nFirstRun) && ((false == hasSelected) || (szSelected != szCtrl))){
+            hasSelected = true;
+            szSelected  = szCtrl;
+            m_stats.nSelects++;
+            m_stats.nCost += m_nSelectCost;
+        }
+    }
+    m_stats.nRuns = m_nNbRuns;
+    return m_nNbRuns;
+}
+
+//---------------------------------------------------
+/**
+  * getRun :
+  *
+  * @param nRun is the run number, in the order they must be sent
+  * @return the run
+*/
+//---------------------------------------------------
+const KS0108TransferRun&
+KS0108TransferPlanner::getRun(unsigned int nRun){
+    if(nRun >= m_nNbRuns){
+        throw std::invalid_argument("[Error] getRun arg out of range");
+    }
+    return m_runs[nRun];
+}
+
+//---------------------------------------------------
+/**
+  * preparePage : fill the columns to write of each group for a page
+  *
+  * @param pOld is the page the panel holds
+  * @param pNew is the page the panel must hold
+  * @param isSynced if false, pOld is not known
+  * @param isBroadcast if true, the columns identical in both halves go to the broadcast group
+  *
+*/
+//---------------------------------------------------
+void
+KS0108TransferPlanner::preparePage(const unsigned char* pOld, const unsigned char* pNew, bool isSynced, bool isBroadcast){
+    unsigned char szY, szCtrl;
+    unsigned int nX;
+    bool isShared;
+
+    for(szY = 0; szY < K_KS0108_X_PIXELS_PER_CTRL; szY++){
+        // Writing the same byte to both controllers is right when both halves hold it
+        isShared = (true == isBroadcast) && (pNew[szY] == pNew[szY + K_KS0108_X_PIXELS_PER_CTRL]);
+        m_isNeeded[K_KS0108_ALL_CTRL][szY]      = false;
+        m_isWritable[K_KS0108_ALL_CTRL][szY]    = isShared;
+        for(szCtrl = 0; szCtrl < K_KS0108_NB_CTRL; szCtrl++){
+            nX = szY + szCtrl * K_KS0108_X_PIXELS_PER_CTRL;
+            m_isNeeded[szCtrl][szY]     = (false == isSynced) || (pOld[nX] != pNew[nX]);
+            m_isWritable[szCtrl][szY]   = true;
+            if((true == isShared) && (true == m_isNeeded[szCtrl][szY])){
+                m_isNeeded[K_KS0108_ALL_CTRL][szY] = true;
+                m_isNeeded[szCtrl][szY] = false;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * planGroup : cut the columns to write of a group into runs
+  *
+  * @param szGroup is the controller, K_KS0108_ALL_CTRL for the broadcast group
+  * @param szPage is the page
+  * @param isEmitted if false, the cost is computed but no run is added
+  * @return the cost of the runs, page command included
+  *
+*/
+//---------------------------------------------------
+unsigned int
+KS0108TransferPlanner::planGroup(unsigned char szGroup, unsigned char szPage, bool isEmitted){
+    const bool* pIsNeeded   = m_isNeeded[szGroup];
+    const bool* pIsWritable = m_isWritable[szGroup];
+    unsigned int nY, nEnd, nNext, nGap, nI;
+    unsigned int nCost = 0;
+    bool isThrough;
+
+    nY = 0;
+    while(nY < K_KS0108_X_PIXELS_PER_CTRL){
+        if(false == pIsNeeded[nY]){
+            nY++;
+            continue;
+        }
+        // The page register is set before the first run of the page
+        if(0 == nCost){
+            nCost += m_nCommandCost;
+            if(true == isEmitted){
+                m_stats.nPageSets++;
+            }
+        }
+        // Extend the run while writing the gap to the next column is cheaper than a jump
+        nEnd = nY;
+        while(true){
+            for(nNext = nEnd + 1; (nNext < K_KS0108_X_PIXELS_PER_CTRL) && (false == pIsNeeded[nNext]); nNext++){
+            }
+            if(nNext >= K_KS0108_X_PIXELS_PER_CTRL){
+                break;
+            }
+            nGap = nNext - nEnd - 1;
+            isThrough = (nGap * m_nWriteCost < m_nCommandCost);
+            for(nI = nEnd + 1; (true == isThrough) && (nI < nNext); nI++){
+                isThrough = pIsWritable[nI];
+            }
+            if(false == isThrough){
+                break;
+            }
+            if(true == isEmitted){
+                m_stats.nGapWrites += nGap;
+            }
+            nEnd = nNext;
+        }
+
+        nCost += m_nCommandCost + (nEnd - nY + 1) * m_nWriteCost;
+        if(true == isEmitted){
+            m_runs[m_nNbRuns].szCtrl    = szGroup;
+            m_runs[m_nNbRuns].szPage    = szPage;
+            m_runs[m_nNbRuns].szY       = nY;
+            m_runs[m_nNbRuns].szLength  = nEnd - nY + 1;
+            m_nNbRuns++;
+            m_stats.nWrites += nEnd - nY + 1;
+            if(K_KS0108_ALL_CTRL == szGroup){
+                m_stats.nBroadcastWrites += nEnd - nY + 1;
+            }
+        }
+        nY = nEnd + 1;
+    }
+    return nCost;
+}
@@ -0,0 +1,180 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: KS0108TransferPlanner.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "KS0108Display.h"
+
+// Default cost of the operations, in PCF8574 writes
+// A data byte : RS, data and the two edges of EN, plus a chip select from time to time
+const unsigned int  K_KS0108_COST_WRITE             = 5;
+// A command (Y address or page) : same sequence plus RS going back to data
+const unsigned int  K_KS0108_COST_COMMAND           = 8;
+// A change of the selected controller
+const unsigned int  K_KS0108_COST_SELECT            = 1;
+
+// Runs are separated by at least one column, so a controller page holds at most 32 runs
+const unsigned int  K_KS0108_MAX_RUNS_PER_PAGE      = (K_KS0108_X_PIXELS_PER_CTRL / 2);
+// Runs of the broadcast group and of each controller for all the pages
+const unsigned int  K_KS0108_MAX_TRANSFER_RUNS      = ((K_KS0108_NB_CTRL + 1) * K_KS0108_PAGES_PER_CTRL * K_KS0108_MAX_RUNS_PER_PAGE);
+
+// Bytes written after a single addressing of a controller
+struct KS0108TransferRun{
+    // Controller, K_KS0108_ALL_CTRL for a broadcast
+    unsigned char szCtrl;
+    unsigned char szPage;
+    // First column in the controller from 0 to 63
+    unsigned char szY;
+    unsigned char szLength;
+};
+
+// What the last plan does
+struct KS0108TransferStats{
+    // Pages with at least one byte to write
+    unsigned int nPages;
+    // Runs, each one needs a Y address command
+    unsigned int nRuns;
+    // Page register commands
+    unsigned int nPageSets;
+    // Changes of the selected controller
+    unsigned int nSelects;
+    // Data writes, a broadcast write counts once
+    unsigned int nWrites;
+    // Data writes done to both controllers at once
+    unsigned int nBroadcastWrites;
+    // Data writes of bytes the panel already holds, to avoid a jump
+    unsigned int nGapWrites;
+    // Estimated cost of the plan with the cost model
+    unsigned int nCost;
+};
+
+class KS0108TransferPlanner{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          *
+          * The planner turns the difference between two frames into the
+          * ordered list of runs that is the cheapest to send
+        */
+        //---------------------------------------------------
+        KS0108TransferPlanner();
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~KS0108TransferPlanner();
+
+        //---------------------------------------------------
+        /**
+          * setCostModel : set the cost of the operations
+          *
+          * @param nWriteCost is the cost of a data write
+          * @param nCommandCost is the cost of a Y address or a page command
+          * @param nSelectCost is the cost of a change of controller
+          *
+        */
+        //---------------------------------------------------
+        void setCostModel(unsigned int nWriteCost, unsigned int nCommandCost, unsigned int nSelectCost);
+
+        //---------------------------------------------------
+        /**
+          * plan : compute the runs that change a frame into another one
+          *
+          * @param pOld is what the panel holds
+          * @param pNew is what the panel must hold
+          * @param pIsSynced tells for each page if pOld is known, NULL if all of them are known
+          * @param szPages selects the pages to plan, one bit per page
+          * @return the number of runs
+          * @note the runs are grouped by controller, broadcast runs first,
+          *       writing through a gap is chosen when it is cheaper than a jump
+          *
+        */
+        //---------------------------------------------------
+        unsigned int plan(const unsigned char pOld[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH],
+                          const unsigned char pNew[K_KS0108_PAGES_PER_CTRL][K_KS0108_SCREEN_WIDTH],
+                          const bool* pIsSynced = NULL, unsigned char szPages = 0xFF);
+
+        //---------------------------------------------------
+        /**
+          * getNbRuns :
+          *
+          * @return the number of runs of the last plan
+        */
+        //---------------------------------------------------
+        inline unsigned int getNbRuns(){ return m_nNbRuns;}
+
+        //---------------------------------------------------
+        /**
+          * getRun :
+          *
+          * @param nRun is the run number, in the order they must be sent
+          * @return the run
+        */
+        //---------------------------------------------------
+        const KS0108TransferRun& getRun(unsigned int nRun);
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the statistics of the last plan
+        */
+        //---------------------------------------------------
+        inline const KS0108TransferStats& getStats(){ return m_stats;}
+
+    private:
+        // Cost model
+        unsigned int m_nWriteCost;
+        unsigned int m_nCommandCost;
+        unsigned int m_nSelectCost;
+
+        // Runs of the last plan, in the order they must be sent
+        KS0108TransferRun m_runs[K_KS0108_MAX_TRANSFER_RUNS];
+        unsigned int m_nNbRuns;
+
+        // Statistics of the last plan
+        KS0108TransferStats m_stats;
+
+        // Columns of the page being planned : to write and allowed to be written, per group
+        bool m_isNeeded[K_KS0108_NB_CTRL + 1][K_KS0108_X_PIXELS_PER_CTRL];
+        bool m_isWritable[K_KS0108_NB_CTRL + 1][K_KS0108_X_PIXELS_PER_CTRL];
+
+        //---------------------------------------------------
+        /**
+          * preparePage : fill the columns to write of each group for a page
+          *
+          * @param pOld is the page the panel holds
+          * @param pNew is the page the panel must hold
+          * @param isSynced if false, pOld is not known
+          * @param isBroadcast if true, the columns identical in both halves go to the broadcast group
+          *
+        */
+        //---------------------------------------------------
+        void preparePage(const unsigned char* pOld, const unsigned char* pNew, bool isSynced, bool isBroadcast);
+
+        //---------------------------------------------------
+        /**
+          * planGroup : cut the columns to write of a group into runs
+          *
+          * @param szGroup is the controller, K_KS0108_ALL_CTRL for the broadcast group
+          * @param szPage is the page
+          * @param isEmitted if false, the cost is computed but no run is added
+          * @return the cost of the runs, page command included
+          *
+        */
+        //---------------------------------------------------
+        unsigned int planGroup(unsigned char szGroup, unsigned char szPage, bool isEmitted);
+};
@@ -37,10 +37,12 @@
 #ifndef ARIAL_BOLD_14_H
 #define ARIAL_BOLD_14_H
 
+#include "KS0108Font.h"
+
 #define ARIAL_BOLD_14_WIDTH 10
 #define ARIAL_BOLD_14_HEIGHT 14
 
-static const unsigned char Arial_Bold_14[]= {
+static constexpr unsigned char Arial_Bold_14[]= {
     0x22, 0x08, // size
     0x0A, // width
     0x0E, // height
@@ -159,4 +161,9 @@ static const unsigned char Arial_Bold_14[]= {
     
 };
 
+// Descriptor and glyph offsets computed at compile time
+static constexpr const KS0108Font& Arial_Bold_14_Font = KS0108FontTable<Arial_Bold_14>::font;
+static_assert(sizeof(Arial_Bold_14) == KS0108FontTable<Arial_Bold_14>::getSize(), "Arial_Bold_14 widths do not match its data");
+
+
 #endif
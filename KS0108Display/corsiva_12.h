@@ -39,10 +39,12 @@
 #ifndef CORSIVA_12_H
 #define CORSIVA_12_H
 
+#include "KS0108Font.h"
+
 #define CORSIVA_12_WIDTH 10
 #define CORSIVA_12_HEIGHT 11
 
-static const unsigned char Corsiva_12[]={
+static constexpr unsigned char Corsiva_12[]={
     0x16, 0x3A, // size
     0x0A, // width
     0x0B, // height
@@ -161,4 +163,9 @@ static const unsigned char Corsiva_12[]={
     
 };
 
+// Descriptor and glyph offsets computed at compile time
+static constexpr const KS0108Font& Corsiva_12_Font = KS0108FontTable<Corsiva_12>::font;
+static_assert(sizeof(Corsiva_12) == KS0108FontTable<Corsiva_12>::getSize(), "Corsiva_12 widths do not match its data");
+
+
 #endif
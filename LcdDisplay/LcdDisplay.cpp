@@ -11,26 +11,48 @@
  *--------------------------------------------------------
  */
 
-#include <wiringPiI2C.h>
 #include <exception>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
 #include "LcdDisplay.h"
+#include "../I2cBus/I2cProfiler.h"
 
 //---------------------------------------------------
 /**
   * Constructor
+  * @param bus is the I2C bus the device is connected to
   * @param szAddres is the I2C addres of the device
+  * @param panel is the geometry of the panel
   *
   * In this mode, only LCD pins D4 - D7 are used, D0 - D3 are grounded.
   * Interface is done with a PCF8574
 */
 //---------------------------------------------------
-LcdDisplay::LcdDisplay(unsigned char szAddres){
+LcdDisplay::LcdDisplay(I2cBus& bus, unsigned char szAddres, const LcdPanel& panel){
+    // Descriptors not built by LcdGeometry are checked here
+    if((NULL == panel.pRowOffsets) || (0 == panel.szCols) || ((2 != panel.szRows) && (4 != panel.szRows))
+       || (panel.szCols * panel.szRows > K_LCD_MAX_CHARS)){
+        throw std::invalid_argument("[Error] unsupported panel geometry");
+    }
+    m_panel = panel;
+    m_pBus = &bus;
     m_szAddres = szAddres;
     m_isDeviceInitialized = false;
+    // Until the bus is measured, the whole execution times are waited for
+    m_szTimingMode = K_LCD_TIMING_CALIBRATED;
+    m_nByteTime = 0;
+    m_nStreamLength = 0;
+    m_isStateKnown = false;
+    m_szAddressCounter = 0;
+    m_szDisplayControl = 0;
+    m_isRetainedMode = false;
+    m_isPanelSynced = false;
+    m_szCursorAddres = 0;
+    m_szCursorControl = 0;
+    clearBuffers();
+    computeTiming();
 }
 
 //---------------------------------------------------
@@ -49,24 +71,38 @@ LcdDisplay::~LcdDisplay(){
 //---------------------------------------------------
 void
 LcdDisplay::init(){
+    M_I2C_PROFILE_SCOPE("LcdDisplay::init")
     // Setup the device
-    m_nDeviceFD = wiringPiI2CSetup (m_szAddres) ;
-    if( -1 != m_nDeviceFD){
+    if(true == m_pBus->isDeviceUp()){
+        // The init sequence waits for every instruction, whatever the timing mode
+        unsigned char szMode = m_szTimingMode;
+        if(K_LCD_TIMING_ZERO_SLEEP == szMode){
+            m_szTimingMode = K_LCD_TIMING_CALIBRATED;
+        }
         try{
+            m_isStateKnown = false;
+            calibrateTiming();
+
+            // Until 4 bits mode is set, each nibble is a whole instruction
+            if(K_LCD_TIMING_FIXED != m_szTimingMode){
+                m_timing.nNibbleDelay = getDelay(K_LCD_COMMAND_TIME);
+            }
+
             // Init pattern
             // Function set 0011XXXX,
             write(0x03);
             // Wait 4,1ms
-            usleep(4100);
+            wait(4100);
             // Function set 0011XXXX,
             write(0x03);
             // Wait 100µs
-            usleep(100);
+            wait(100);
             // Function set 0011XXXX,
             write(0x03);
 
             // Activate 4 bits mode
             write(0x02);
+            computeTiming();
 
             // Function SET
             // 0    0   1   DL  N   F   -   -
@@ -103,11 +139,22 @@ LcdDisplay::init(){
             // Here we set the cursor to be moved on the right with no display shifting
             write(K_LCD_ENTRYMODESET | K_LCD_ENTRYRIGHT);
 
-            usleep(2000);
+            wait(2000);
+            // Clear display moved the address counter to 0
+            m_szAddressCounter = 0;
+            m_szDisplayControl = K_LCD_DISPLAYCONTROL | K_LCD_DISPLAYON;
+            m_isStateKnown = true;
+            m_szCursorAddres = 0;
+            m_szCursorControl = 0;
+            clearBuffers();
+            m_isPanelSynced = true;
             m_isDeviceInitialized = true;
         }catch(std::exception const& e){
+            m_nStreamLength = 0;
             printf("[LCD] %s\n",e.what());
         }
+        m_szTimingMode = szMode;
+        computeTiming();
     }
 }
 
@@ -119,12 +166,22 @@ LcdDisplay::init(){
 //---------------------------------------------------
 void
 LcdDisplay::cls(){
+    M_I2C_PROFILE_SCOPE("LcdDisplay::cls")
 
     // Sanity check
     M_LCD_IS_DEVICE_UP
 
+    m_szCursorAddres = 0;
+    if(true == m_isRetainedMode){
+        memset(m_szFrameBuffer, K_LCD_BLANK, sizeof(m_szFrameBuffer));
+        return;
+    }
+    // Clear display also moves the cursor home
     write(K_LCD_CLEARDISPLAY);
-    write(K_LCD_RETURNHOME);
+    flushStream();
+    m_szAddressCounter = 0;
+    clearBuffers();
+    m_isPanelSynced = true;
 }
 
 //---------------------------------------------------
@@ -139,12 +196,15 @@ LcdDisplay::cls(){
 //---------------------------------------------------
 void
 LcdDisplay::displayStringAtPosition(const char* pData, char szLine, char szCol){
+    M_I2C_PROFILE_SCOPE("LcdDisplay::displayStringAtPosition")
 
     // Sanity check
     M_LCD_IS_DEVICE_UP
 
-    setCursorAtPosition(szLine,szCol,false,false);
-    displayString(pData);
+    displayString(pData, szLine, szCol);
+    // Writing text hides the cursor
+    m_szCursorControl = K_LCD_CURSOROFF | K_LCD_BLINKOFF;
+    update();
 }
 
 //---------------------------------------------------
@@ -160,41 +220,182 @@ LcdDisplay::displayStringAtPosition(const char* pData, char szLine, char szCol){
 //---------------------------------------------------
 void
 LcdDisplay::setCursorAtPosition(char szLine, char szCol,bool isVisible, bool isBlinking){
-    unsigned char cmdArg;
+    M_I2C_PROFILE_SCOPE("LcdDisplay::setCursorAtPosition")
 
     // Sanity check
     M_LCD_IS_DEVICE_UP
 
-    if(true == isVisible){
-        cmdArg = K_LCD_CURSORON;
-    }else{
-        cmdArg = K_LCD_CURSOROFF;
-    }
-    if(true == isBlinking){
-        cmdArg |= K_LCD_BLINKON;
-    }else{
-        cmdArg |= K_LCD_BLINKOFF;
+    checkPosition(szLine, szCol);
+    m_szCursorAddres = m_panel.pRowOffsets[szLine - 1] + szCol;
+    m_szCursorControl = (true == isVisible) ? K_LCD_CURSORON : K_LCD_CURSOROFF;
+    m_szCursorControl |= (true == isBlinking) ? K_LCD_BLINKON : K_LCD_BLINKOFF;
+    update();
+}
+
+//---------------------------------------------------
+/**
+  * setRetainedMode : select when the text is sent to the panel
+  *
+  * @param isRetained if true, the text is kept in the frame buffer until flush() is called
+  *                   if false, each call is sent to the panel at once
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::setRetainedMode(bool isRetained){
+    m_isRetainedMode = isRetained;
+    if(false == m_isRetainedMode){
+        update();
     }
+}
 
-    // Move cursor home
-    write(K_LCD_RETURNHOME);
+//---------------------------------------------------
+/**
+  * flush : send the modified characters of the frame buffer to the panel
+  *
+  * @note each run of changed characters costs one address command
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::flush(){
+    M_I2C_PROFILE_SCOPE("LcdDisplay::flush")
 
-    // Set the line position
-    setLinePosition(szLine);
+    // Sanity check
+    M_LCD_IS_DEVICE_UP
 
-    // Now move the cursor
-    for(unsigned char szIndex= 0; szIndex < K_LCD_MAX_CHAR_PER_LINE; szIndex++){
-        if(szIndex == szCol){
-            break;
+    unsigned char szLine, szCol;
+    unsigned int nIndex = 0;
+
+    for(szLine = 0; szLine < m_panel.szRows; szLine++){
+        for(szCol = 0; szCol < m_panel.szCols; szCol++, nIndex++){
+            if((true == m_isPanelSynced) && (m_szFrameBuffer[nIndex] == m_szPanelBuffer[nIndex])){
+                continue;
+            }
+            // Nothing is sent when the address counter already follows the previous character
+            setAddress(m_panel.pRowOffsets[szLine] + szCol);
+            write(m_szFrameBuffer[nIndex], K_LCD_RS_MASK);
+            moveAddressCounter();
+            m_szPanelBuffer[nIndex] = m_szFrameBuffer[nIndex];
         }
-        write(K_LCD_CURSORSHIFT | K_LCD_CURSORMOVE | K_LCD_MOVERIGHT);
     }
 
-    write(K_LCD_DISPLAYCONTROL | K_LCD_DISPLAYON | cmdArg);
+    // A visible cursor goes back to its position
+    if(0 != m_szCursorControl){
+        setAddress(m_szCursorAddres);
+    }
+    setDisplayControl(K_LCD_DISPLAYCONTROL | K_LCD_DISPLAYON | m_szCursorControl);
+    flushStream();
+    m_isPanelSynced = true;
+}
+
+//---------------------------------------------------
+/**
+  * setTimingMode : select how the end of an instruction is waited for
+  *
+  * @param szMode is K_LCD_TIMING_FIXED, K_LCD_TIMING_CALIBRATED or K_LCD_TIMING_ZERO_SLEEP
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::setTimingMode(unsigned char szMode){
+    if(szMode > K_LCD_TIMING_ZERO_SLEEP){
+        throw std::invalid_argument("[Error] unknown timing mode");
+    }
+    m_szTimingMode = szMode;
+    computeTiming();
+}
+
+//---------------------------------------------------
+/**
+  * calibrateTiming : measure the time of a byte on the bus
+  *
+  * @return the time of a byte of a multi-byte write in ns
+  * @note the delays of the timing mode are computed again
+  *
+*/
+//---------------------------------------------------
+unsigned long long
+LcdDisplay::calibrateTiming(){
+    M_I2C_PROFILE_SCOPE("LcdDisplay::calibrateTiming")
+    unsigned char szBlock[K_LCD_CALIBRATION_BYTES];
+    unsigned long long nStart, nWrite, nBlock, nByteTime;
+    unsigned char szI;
+
+    if(false == m_pBus->isDeviceUp()){
+        return 0;
+    }
+    flushStream();
+    // EN stays low, the controller does not see these writes
+    memset(szBlock, K_LCD_BACKLIGHT, sizeof(szBlock));
+    for(szI = 0; szI < K_LCD_CALIBRATION_LOOPS; szI++){
+        nStart = m_pBus->getTime();
+        m_pBus->write(m_szAddres, K_LCD_BACKLIGHT);
+        nWrite = m_pBus->getTime() - nStart;
+        nStart = m_pBus->getTime();
+        m_pBus->writeBlock(m_szAddres, szBlock, sizeof(szBlock));
+        nBlock = m_pBus->getTime() - nStart;
+        // The cost of the message is paid once in both writes
+        nByteTime = (nBlock > nWrite) ? (nBlock - nWrite) / (K_LCD_CALIBRATION_BYTES - 1) : 0;
+        // The fastest byte gives the longest delays
+        if((0 == szI) || (nByteTime < m_nByteTime)){
+            m_nByteTime = nByteTime;
+        }
+    }
+    computeTiming();
+    return m_nByteTime;
 }
 
 //************* PRIVATE SECTION *************************
 
+//---------------------------------------------------
+/**
+  * computeTiming : set the delays of the timing mode
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::computeTiming(){
+    if(K_LCD_TIMING_FIXED == m_szTimingMode){
+        m_timing.nEnDelay       = K_LCD_FIXED_EN_DELAY;
+        m_timing.nNibbleDelay   = K_LCD_FIXED_NIBBLE_DELAY;
+        m_timing.nCommandDelay  = 0;
+        m_timing.nDataDelay     = 0;
+        // The next nibble is latched after the nibble delay and the EN delay
+        m_timing.nClearDelay    = K_LCD_FIXED_CLEAR_DELAY;
+        return;
+    }
+    // The byte lowering EN comes after the one raising it
+    m_timing.nEnDelay       = (m_nByteTime >= K_LCD_EN_PULSE_TIME) ? 0 : 1;
+    m_timing.nNibbleDelay   = 0;
+    m_timing.nCommandDelay  = getDelay(K_LCD_COMMAND_TIME);
+    m_timing.nDataDelay     = getDelay(K_LCD_DATA_TIME);
+    m_timing.nClearDelay    = getDelay(K_LCD_CLEAR_TIME);
+    if(K_LCD_TIMING_ZERO_SLEEP == m_szTimingMode){
+        m_timing.nCommandDelay  = 0;
+        m_timing.nDataDelay     = 0;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * getDelay : time left to wait after the bytes of the next nibble
+  *
+  * @param nTime is the execution time in ns
+  * @return the delay in us
+*/
+//---------------------------------------------------
+unsigned int
+LcdDisplay::getDelay(unsigned int nTime){
+    // The next nibble is written, then EN is raised before being lowered
+    unsigned long long nCovered = 2 * m_nByteTime;
+
+    if(nTime <= nCovered){
+        return 0;
+    }
+    return (unsigned int)((nTime - nCovered + 999) / 1000);
+}
+
 //---------------------------------------------------
 /**
   * write : write a command to lcd
@@ -206,10 +407,24 @@ LcdDisplay::setCursorAtPosition(char szLine, char szCol,bool isVisible, bool isB
 //---------------------------------------------------
 void
 LcdDisplay::write(char szData, char szMode){
+    unsigned int nDelay;
+
     // Write Hi Nibble
     writeNibble(szMode | (szData & 0xF0));
     // Write Low Nibble
     writeNibble(szMode | ((szData << 4) & 0xF0));
+
+    // Wait for the end of the instruction
+    if(0 != (szMode & K_LCD_RS_MASK)){
+        nDelay = m_timing.nDataDelay;
+    }else if(0 == (szData & ~(K_LCD_CLEARDISPLAY | K_LCD_RETURNHOME))){
+        nDelay = m_timing.nClearDelay;
+    }else{
+        nDelay = m_timing.nCommandDelay;
+    }
+    if(0 != nDelay){
+        wait(nDelay);
+    }
 }
 
 //---------------------------------------------------
@@ -237,61 +452,86 @@ LcdDisplay::writeNibble(char szData){
 void
 LcdDisplay::strobe(char szData){
     writei2c(szData | K_LCD_EN_MASK | K_LCD_BACKLIGHT);
-    usleep(800);
+    if(0 != m_timing.nEnDelay){
+        wait(m_timing.nEnDelay);
+    }
     writei2c(((szData & ~K_LCD_EN_MASK) | K_LCD_BACKLIGHT));
-    usleep(400);
+    if(0 != m_timing.nNibbleDelay){
+        wait(m_timing.nNibbleDelay);
+    }
 }
 
 //---------------------------------------------------
 /**
-  * setLinePosition : Set the cursor at the given line position
+  * setAddress : move the address counter, unless it is already there
   *
-  * @param szLine is the line where to put the cursor
+  * @param szAddres is the DDRAM addres
   *
 */
 //---------------------------------------------------
 void
-LcdDisplay::setLinePosition(char szLine){
-    char szCmdLine;
-
-    switch(szLine){
-            case 1:
-                szCmdLine=0x80;
-                break;
-
-            case 2:
-                szCmdLine=0xC0;
-                break;
-
-            case 3:
-                szCmdLine=0x94;
-                break;
+LcdDisplay::setAddress(unsigned char szAddres){
+    if((true == m_isStateKnown) && (szAddres == m_szAddressCounter)){
+        return;
+    }
+    write(K_LCD_SETDDRAMADDR | szAddres);
+    m_szAddressCounter = szAddres;
+}
 
-            case 4:
-                szCmdLine=0xD4;
-                break;
+//---------------------------------------------------
+/**
+  * setDisplayControl : send a display control, unless it is the current one
+  *
+  * @param szControl is the display control command
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::setDisplayControl(unsigned char szControl){
+    if((true == m_isStateKnown) && (szControl == m_szDisplayControl)){
+        return;
+    }
+    write(szControl);
+    m_szDisplayControl = szControl;
+}
 
-            default:
-                throw std::out_of_range("[Error] line number is out of range");
-                break;
+//---------------------------------------------------
+/**
+  * moveAddressCounter : follow the controller after a data write
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::moveAddressCounter(){
+    // The end of a line of the controller goes on with the other one
+    if(K_LCD_DDRAM_LINE_LENGTH - 1 == m_szAddressCounter){
+        m_szAddressCounter = K_LCD_DDRAM_LINE2_ADDRES;
+    }else if(K_LCD_DDRAM_LINE2_ADDRES + K_LCD_DDRAM_LINE_LENGTH - 1 == m_szAddressCounter){
+        m_szAddressCounter = 0;
+    }else{
+        m_szAddressCounter++;
     }
-    write(szCmdLine);
 }
 
 //---------------------------------------------------
 /**
-  * displayString : display a string at the current cursor position
+  * displayString : copy a string into the frame buffer
   *
   * @param pData is the pointer the data to write
+  * @param szLine is the line number
+  * @param szCol is the colum number
   *
 */
 //---------------------------------------------------
 void
-LcdDisplay::displayString(const char* pData){
+LcdDisplay::displayString(const char* pData, char szLine, char szCol){
     if(NULL != pData){
+        checkPosition(szLine, szCol);
+        unsigned char* pLine = m_szFrameBuffer + (szLine - 1) * m_panel.szCols;
         int nIndex = 0;
-        while((0 != pData[nIndex]) && (nIndex < K_LCD_MAX_CHAR_PER_LINE)){
-            write(pData[nIndex],K_LCD_RS_MASK);
+        // The end of the string is clipped, it does not go on with another line
+        while((0 != pData[nIndex]) && (szCol + nIndex < m_panel.szCols)){
+            pLine[szCol + nIndex] = pData[nIndex];
             nIndex++;
         };
     }else{
@@ -301,7 +541,53 @@ LcdDisplay::displayString(const char* pData){
 
 //---------------------------------------------------
 /**
-  * writei2c : write at low level
+  * checkPosition : throw if a position is not on the panel
+  *
+  * @param szLine is the line number
+  * @param szCol is the colum number
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::checkPosition(char szLine, char szCol){
+    if((szLine < 1) || (szLine > m_panel.szRows)){
+        throw std::out_of_range("[Error] line number is out of range");
+    }
+    if((szCol < 0) || (szCol >= m_panel.szCols)){
+        throw std::out_of_range("[Error] column number is out of range");
+    }
+}
+
+//---------------------------------------------------
+/**
+  * clearBuffers : fill the frame and panel buffers with blanks
+  *
+  * @note called when the display RAM was cleared
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::clearBuffers(){
+    memset(m_szFrameBuffer, K_LCD_BLANK, sizeof(m_szFrameBuffer));
+    memset(m_szPanelBuffer, K_LCD_BLANK, sizeof(m_szPanelBuffer));
+}
+
+//---------------------------------------------------
+/**
+  * update : send the text to the panel if not in retained mode
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::update(){
+    if(false == m_isRetainedMode){
+        flush();
+    }
+}
+
+//---------------------------------------------------
+/**
+  * writei2c : queue a write at low level
   *
   * @param szData is the data to write
   *
@@ -309,9 +595,51 @@ LcdDisplay::displayString(const char* pData){
 //---------------------------------------------------
 void
 LcdDisplay::writei2c(unsigned char szData){
-    int nRes;
-    nRes = wiringPiI2CWrite(m_nDeviceFD,szData);
-    if(0 != nRes){
-        throw std::runtime_error("[Error] i2c write error");
+    if(K_LCD_STREAM_SIZE == m_nStreamLength){
+        flushStream();
     }
+    m_szStream[m_nStreamLength++] = szData;
+}
+
+//---------------------------------------------------
+/**
+  * flushStream : send the queued writes in one message
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::flushStream(){
+    unsigned int nLength = m_nStreamLength;
+
+    if(0 == nLength){
+        return;
+    }
+    // The queue is emptied even if the write fails
+    m_nStreamLength = 0;
+    try{
+        if(1 == nLength){
+            m_pBus->write(m_szAddres, m_szStream[0]);
+        }else{
+            m_pBus->writeBlock(m_szAddres, m_szStream, nLength);
+        }
+    }catch(std::exception const&){
+        // The controller may have seen a part of the writes
+        m_isStateKnown = false;
+        m_isPanelSynced = false;
+        throw;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * wait : send the queued writes, then wait
+  *
+  * @param nMicroSeconds is the time to wait
+  *
+*/
+//---------------------------------------------------
+void
+LcdDisplay::wait(unsigned int nMicroSeconds){
+    flushStream();
+    m_pBus->delay(nMicroSeconds);
 }
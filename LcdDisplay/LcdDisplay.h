@@ -13,7 +13,12 @@
 
 #pragma once
 
+#include "../I2cBus/I2cBus.h"
+#include "LcdGeometry.h"
+
+// Default panel
 const unsigned char K_LCD_MAX_CHAR_PER_LINE     = 20;
+const unsigned char K_LCD_NB_LINES              = 4;
 
 // Commands
 const unsigned char K_LCD_CLEARDISPLAY          = 0x01;
@@ -66,6 +71,46 @@ const unsigned char K_LCD_RW_MASK               = 0x02;
 const unsigned char K_LCD_RS_MASK               = 0x01;
 
 
+// Timing modes
+// Fixed delays of 800 us and 400 us around each EN pulse
+const unsigned char K_LCD_TIMING_FIXED          = 0;
+// Delays derived from the execution times and the measured bus speed
+const unsigned char K_LCD_TIMING_CALIBRATED     = 1;
+// As calibrated, but only clear and home are waited for
+const unsigned char K_LCD_TIMING_ZERO_SLEEP     = 2;
+
+// Execution times of the HD44780 at 270 kHz, in ns
+const unsigned int  K_LCD_CLEAR_TIME            = 1520000;
+const unsigned int  K_LCD_COMMAND_TIME          = 37000;
+const unsigned int  K_LCD_DATA_TIME             = 41000;
+// Minimum width of the EN pulse, in ns
+const unsigned int  K_LCD_EN_PULSE_TIME         = 450;
+// Delays of the fixed mode, in us
+const unsigned int  K_LCD_FIXED_EN_DELAY        = 800;
+const unsigned int  K_LCD_FIXED_NIBBLE_DELAY    = 400;
+// Part of the clear time not covered by the fixed delays, in us
+const unsigned int  K_LCD_FIXED_CLEAR_DELAY     = (K_LCD_CLEAR_TIME + 999) / 1000 - K_LCD_FIXED_NIBBLE_DELAY - K_LCD_FIXED_EN_DELAY;
+// Number of measures done by calibrateTiming, and bytes of the block it writes
+const unsigned char K_LCD_CALIBRATION_LOOPS     = 4;
+const unsigned char K_LCD_CALIBRATION_BYTES     = 8;
+// The writes to the backpack are queued and sent in one message,
+// up to the next delay or the end of the call
+const unsigned int  K_LCD_STREAM_SIZE           = 256;
+// Character of the cleared display RAM
+const unsigned char K_LCD_BLANK                 = ' ';
+
+// Delays used around the EN pulses, in us
+struct LcdTiming{
+    // After EN is raised
+    unsigned int nEnDelay;
+    // After EN is lowered, for each nibble
+    unsigned int nNibbleDelay;
+    // After an instruction or a data, and after clear or home
+    unsigned int nCommandDelay;
+    unsigned int nDataDelay;
+    unsigned int nClearDelay;
+};
+
 #define M_LCD_IS_DEVICE_UP                      if(false == m_isDeviceInitialized) return;
 
 class LcdDisplay{
@@ -73,10 +118,12 @@ class LcdDisplay{
         //---------------------------------------------------
         /**
           * Constructor
+          * @param bus is the I2C bus the device is connected to
           * @param szAddres is the I2C addres of the device
+          * @param panel is the geometry of the panel
         */
         //---------------------------------------------------
-        LcdDisplay(unsigned char szAddres);
+        LcdDisplay(I2cBus& bus, unsigned char szAddres, const LcdPanel& panel = LcdGeometry20x4::panel);
 
         //---------------------------------------------------
         /**
@@ -102,6 +149,15 @@ class LcdDisplay{
         //---------------------------------------------------
         inline bool isDeviceUp(){ return m_isDeviceInitialized;}
 
+        //---------------------------------------------------
+        /**
+          * getPanel :
+          *
+          * @return the geometry of the panel
+        */
+        //---------------------------------------------------
+        inline const LcdPanel& getPanel(){ return m_panel;}
+
         //---------------------------------------------------
         /**
           * cls : clear lcd and set cursor to home
@@ -118,6 +174,7 @@ class LcdDisplay{
           * @param szLine is the line number
           * @param szCol is the colum number
           *
+          * @note the string is clipped at the end of the line, and the cursor is hidden
         */
         //---------------------------------------------------
         void displayStringAtPosition(const char* pData, char szLine, char szCol = 0);
@@ -135,6 +192,75 @@ class LcdDisplay{
         //---------------------------------------------------
         void setCursorAtPosition(char szLine, char szCol,bool isVisible, bool isBlinking);
 
+        //---------------------------------------------------
+        /**
+          * setRetainedMode : select when the text is sent to the panel
+          *
+          * @param isRetained if true, the text is kept in the frame buffer until flush() is called
+          *                   if false, each call is sent to the panel at once
+          *
+        */
+        //---------------------------------------------------
+        void setRetainedMode(bool isRetained);
+
+        //---------------------------------------------------
+        /**
+          * isRetainedMode :
+          *
+          * @return true if the text is kept until flush() is called
+        */
+        //---------------------------------------------------
+        inline bool isRetainedMode(){ return m_isRetainedMode;}
+
+        //---------------------------------------------------
+        /**
+          * flush : send the modified characters of the frame buffer to the panel
+          *
+          * @note each run of changed characters costs one address command
+          *
+        */
+        //---------------------------------------------------
+        void flush();
+
+        //---------------------------------------------------
+        /**
+          * setTimingMode : select how the end of an instruction is waited for
+          *
+          * @param szMode is K_LCD_TIMING_FIXED, K_LCD_TIMING_CALIBRATED or K_LCD_TIMING_ZERO_SLEEP
+          *
+        */
+        //---------------------------------------------------
+        void setTimingMode(unsigned char szMode);
+
+        //---------------------------------------------------
+        /**
+          * getTimingMode :
+          *
+          * @return the timing mode
+        */
+        //---------------------------------------------------
+        inline unsigned char getTimingMode(){ return m_szTimingMode;}
+
+        //---------------------------------------------------
+        /**
+          * getTiming :
+          *
+          * @return the delays of the timing mode
+        */
+        //---------------------------------------------------
+        inline const LcdTiming& getTiming(){ return m_timing;}
+
+        //---------------------------------------------------
+        /**
+          * calibrateTiming : measure the time of a byte on the bus
+          *
+          * @return the time of a byte of a multi-byte write in ns
+          * @note the delays of the timing mode are computed again
+          *
+        */
+        //---------------------------------------------------
+        unsigned long long calibrateTiming();
+
     private:
         // Flag to know if operations are valid or not
         bool m_isDeviceInitialized;
@@ -142,8 +268,57 @@ class LcdDisplay{
         // I2C Addres of the device
         unsigned char m_szAddres;
 
-        // File descriptor of the device
-        int m_nDeviceFD;
+        // I2C bus of the device
+        I2cBus* m_pBus;
+
+        // Geometry of the panel
+        LcdPanel m_panel;
+
+        // Timing
+        unsigned char m_szTimingMode;
+        unsigned long long m_nByteTime;
+        LcdTiming m_timing;
+
+        // State of the controller, valid if m_isStateKnown is true
+        bool m_isStateKnown;
+        unsigned char m_szAddressCounter;
+        unsigned char m_szDisplayControl;
+
+        // If true, the text is only sent by flush()
+        bool m_isRetainedMode;
+
+        // Host copy of the display RAM, one character per column and per line, line by line
+        unsigned char m_szFrameBuffer[K_LCD_MAX_CHARS];
+        // What was last written to the panel
+        unsigned char m_szPanelBuffer[K_LCD_MAX_CHARS];
+        // true when the panel buffer reflects the display RAM
+        bool m_isPanelSynced;
+
+        // Cursor set by setCursorAtPosition, put back by flush()
+        unsigned char m_szCursorAddres;
+        unsigned char m_szCursorControl;
+
+        // Bytes not yet sent to the backpack
+        unsigned char m_szStream[K_LCD_STREAM_SIZE];
+        unsigned int m_nStreamLength;
+
+        //---------------------------------------------------
+        /**
+          * computeTiming : set the delays of the timing mode
+          *
+        */
+        //---------------------------------------------------
+        void computeTiming();
+
+        //---------------------------------------------------
+        /**
+          * getDelay : time left to wait after the bytes of the next nibble
+          *
+          * @param nTime is the execution time in ns
+          * @return the delay in us
+        */
+        //---------------------------------------------------
+        unsigned int getDelay(unsigned int nTime);
 
         //---------------------------------------------------
         /**
@@ -178,27 +353,76 @@ class LcdDisplay{
 
         //---------------------------------------------------
         /**
-          * setLinePosition : Set the cursor at the given line position
+          * setAddress : move the address counter, unless it is already there
           *
-          * @param szLine is the line where to put the cursor
+          * @param szAddres is the DDRAM addres
           *
         */
         //---------------------------------------------------
-        void setLinePosition(char szLine);
+        void setAddress(unsigned char szAddres);
 
         //---------------------------------------------------
         /**
-          * displayString : display a string at the current cursor position
+          * setDisplayControl : send a display control, unless it is the current one
+          *
+          * @param szControl is the display control command
+          *
+        */
+        //---------------------------------------------------
+        void setDisplayControl(unsigned char szControl);
+
+        //---------------------------------------------------
+        /**
+          * moveAddressCounter : follow the controller after a data write
+          *
+        */
+        //---------------------------------------------------
+        void moveAddressCounter();
+
+        //---------------------------------------------------
+        /**
+          * displayString : copy a string into the frame buffer
           *
           * @param pData is the pointer the data to write
+          * @param szLine is the line number
+          * @param szCol is the colum number
           *
          */
         //---------------------------------------------------
-        void displayString(const char* pData);
+        void displayString(const char* pData, char szLine, char szCol);
+
+        //---------------------------------------------------
+        /**
+          * checkPosition : throw if a position is not on the panel
+          *
+          * @param szLine is the line number
+          * @param szCol is the colum number
+          *
+        */
+        //---------------------------------------------------
+        void checkPosition(char szLine, char szCol);
 
         //---------------------------------------------------
         /**
-          * writei2c : write at low level
+          * clearBuffers : fill the frame and panel buffers with blanks
+          *
+          * @note called when the display RAM was cleared
+          *
+        */
+        //---------------------------------------------------
+        void clearBuffers();
+
+        //---------------------------------------------------
+        /**
+          * update : send the text to the panel if not in retained mode
+          *
+        */
+        //---------------------------------------------------
+        void update();
+
+        //---------------------------------------------------
+        /**
+          * writei2c : queue a write at low level
           *
           * @param szData is the data to write
           *
@@ -206,4 +430,84 @@ class LcdDisplay{
         //---------------------------------------------------
         void writei2c(unsigned char szData);
 
+        //---------------------------------------------------
+        /**
+          * flushStream : send the queued writes in one message
+          *
+        */
+        //---------------------------------------------------
+        void flushStream();
+
+        //---------------------------------------------------
+        /**
+          * wait : send the queued writes, then wait
+          *
+          * @param nMicroSeconds is the time to wait
+          *
+        */
+        //---------------------------------------------------
+        void wait(unsigned int nMicroSeconds);
+
+};
+
+//---------------------------------------------------
+/**
+  * LcdPanelDisplay : LcdDisplay of a panel known at compile time
+  *
+  * @param G is the geometry of the panel, a LcdGeometry
+  * @note the positions given as template arguments are checked at compile time
+  *
+*/
+//---------------------------------------------------
+template<class G>
+class LcdPanelDisplay : public LcdDisplay{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param bus is the I2C bus the device is connected to
+          * @param szAddres is the I2C addres of the device
+        */
+        //---------------------------------------------------
+        LcdPanelDisplay(I2cBus& bus, unsigned char szAddres) : LcdDisplay(bus, szAddres, G::panel){
+        }
+
+        //---------------------------------------------------
+        /**
+          * displayStringAt : display a string at the given position
+          *
+          * @param L is the line number
+          * @param C is the colum number
+          * @param pData is the pointer the data to write
+          *
+        */
+        //---------------------------------------------------
+        template<unsigned char L, unsigned char C>
+        void displayStringAt(const char* pData){
+            static_assert(G::isPosition(L, C), "position is out of the panel");
+            displayStringAtPosition(pData, L, C);
+        }
+
+        //---------------------------------------------------
+        /**
+          * setCursorAt : setCursor
+          *
+          * @param L is the line number
+          * @param C is the colum number
+          * @param isVisible if true, enable the cursor
+          * @param isBlinking if true, enable cursor blinking
+          *
+        */
+        //---------------------------------------------------
+        template<unsigned char L, unsigned char C>
+        void setCursorAt(bool isVisible, bool isBlinking){
+            static_assert(G::isPosition(L, C), "position is out of the panel");
+            setCursorAtPosition(L, C, isVisible, isBlinking);
+        }
 };
+
+// Common panels
+typedef LcdPanelDisplay<LcdGeometry16x2> LcdDisplay16x2;
+typedef LcdPanelDisplay<LcdGeometry16x4> LcdDisplay16x4;
+typedef LcdPanelDisplay<LcdGeometry20x4> LcdDisplay20x4;
+typedef LcdPanelDisplay<LcdGeometry40x2> LcdDisplay40x2;
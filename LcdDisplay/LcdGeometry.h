@@ -0,0 +1,107 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: LcdGeometry.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stdexcept>
+
+// In 2 lines mode, the controller line 1 goes from 0x00 to 0x27, line 2 from 0x40 to 0x67
+const unsigned char K_LCD_DDRAM_LINE_LENGTH     = 40;
+const unsigned char K_LCD_DDRAM_LINE2_ADDRES    = 0x40;
+// Largest panel driven by one controller
+const unsigned char K_LCD_MAX_ROWS              = 4;
+const unsigned char K_LCD_MAX_CHARS             = 2 * K_LCD_DDRAM_LINE_LENGTH;
+
+// Descriptor of a panel
+struct LcdPanel{
+    unsigned char szCols;
+    unsigned char szRows;
+    // DDRAM addres of the first character of each row
+    const unsigned char* pRowOffsets;
+};
+
+//---------------------------------------------------
+/**
+  * LcdGeometry : row offsets and bounds of a panel
+  *
+  * @param C is the number of columns
+  * @param R is the number of rows, 2 or 4
+  * @note everything is computed at compile time, the addres of a position is a table lookup
+  *
+*/
+//---------------------------------------------------
+template<unsigned char C, unsigned char R>
+struct LcdGeometry{
+    static_assert((2 == R) || (4 == R), "a panel has 2 or 4 rows");
+    static_assert((0 < C) && (C * R <= K_LCD_MAX_CHARS), "the panel does not fit in the display RAM");
+
+    //---------------------------------------------------
+    /**
+      * getRowOffset :
+      *
+      * @param szRow is the row from 0
+      * @return the DDRAM addres of the first character of the row
+    */
+    //---------------------------------------------------
+    static constexpr unsigned char getRowOffset(unsigned char szRow){
+        // Rows 3 and 4 are the ends of the 2 lines of the controller
+        return (szRow % 2) * K_LCD_DDRAM_LINE2_ADDRES + (szRow / 2) * C;
+    }
+
+    //---------------------------------------------------
+    /**
+      * isPosition :
+      *
+      * @param szLine is the line number, from 1
+      * @param szCol is the colum number, from 0
+      * @return true if the position is on the panel
+    */
+    //---------------------------------------------------
+    static constexpr bool isPosition(unsigned char szLine, unsigned char szCol){
+        return (0 < szLine) && (szLine <= R) && (szCol < C);
+    }
+
+    //---------------------------------------------------
+    /**
+      * getAddress :
+      *
+      * @param szLine is the line number, from 1
+      * @param szCol is the colum number, from 0
+      * @return the DDRAM addres of the position
+      * @note a position out of the panel does not compile in a constant expression, it throws otherwise
+    */
+    //---------------------------------------------------
+    static constexpr unsigned char getAddress(unsigned char szLine, unsigned char szCol){
+        return isPosition(szLine, szCol) ? getRowOffset(szLine - 1) + szCol
+                                         : throw std::out_of_range("[Error] position is out of the panel");
+    }
+
+    // Unused rows are never read
+    static constexpr unsigned char szRowOffsets[K_LCD_MAX_ROWS] = {
+        getRowOffset(0), getRowOffset(1), getRowOffset(2), getRowOffset(3)
+    };
+
+    static constexpr LcdPanel panel = { C, R, szRowOffsets };
+};
+
+template<unsigned char C, unsigned char R>
+constexpr unsigned char LcdGeometry<C, R>::szRowOffsets[K_LCD_MAX_ROWS];
+
+template<unsigned char C, unsigned char R>
+constexpr LcdPanel LcdGeometry<C, R>::panel;
+
+// Common panels
+typedef LcdGeometry<16, 2> LcdGeometry16x2;
+typedef LcdGeometry<16, 4> LcdGeometry16x4;
+typedef LcdGeometry<20, 4> LcdGeometry20x4;
+typedef LcdGeometry<40, 2> LcdGeometry40x2;
@@ -0,0 +1,451 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: LcdSimulator.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LcdSimulator.h"
+
+//---------------------------------------------------
+/**
+  * Constructor
+  * @param szCols is the number of columns of the panel
+  * @param szRows is the number of rows of the panel, 1, 2 or 4
+  *
+  * A PCF8574 backpack drives the HD44780: RS, R/W, EN and the backlight
+  * on P0-P3, D4-D7 on P4-P7, D0-D3 are grounded
+*/
+//---------------------------------------------------
+LcdSimulator::LcdSimulator(unsigned char szCols, unsigned char szRows){
+    if((0 == szCols) || (szCols > K_LCD_SIM_2LINE_LENGTH) || ((1 != szRows) && (2 != szRows) && (4 != szRows))
+       || (szCols * szRows > K_LCD_SIM_1LINE_LENGTH)){
+        throw std::invalid_argument("[Error] unsupported panel geometry");
+    }
+    m_szCols            = szCols;
+    m_szRows            = szRows;
+    m_port.connect(this, 0);
+    m_szPort            = m_port.getLatch();
+
+    // Power on reset : 8 bits, 1 line, display off, increment
+    memset(m_szDdram, ' ', sizeof(m_szDdram));
+    memset(m_szCgram, 0, sizeof(m_szCgram));
+    m_szAddressCounter  = 0;
+    m_isCgram           = false;
+    m_szShift           = 0;
+    m_is8Bit            = true;
+    m_is2Lines          = false;
+    m_isIncrement       = true;
+    m_isShiftOnWrite    = false;
+    m_isDisplayOn       = false;
+    m_isCursorOn        = false;
+    m_isBlinkOn         = false;
+    m_isLowNibble       = false;
+    m_szHighNibble      = 0;
+    m_isNibbleLate      = false;
+    m_nBusyUntil        = 0;
+    m_nEnRise           = 0;
+    resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * Destructor
+*/
+//---------------------------------------------------
+LcdSimulator::~LcdSimulator(){
+}
+
+//---------------------------------------------------
+/**
+  * attach : connect the backpack to a bus
+  *
+  * @param bus is the simulated bus
+  * @param szAddres is the I2C addres of the backpack
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::attach(SimulatedBus& bus, unsigned char szAddres){
+    bus.attach(szAddres, &m_port);
+}
+
+//---------------------------------------------------
+/**
+  * getChar : get a displayed character
+  *
+  * @param szRow is the row from 0
+  * @param szCol is the column from 0
+  * @return the character code, display shift applied
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::getChar(unsigned char szRow, unsigned char szCol){
+    if((szRow >= m_szRows) || (szCol >= m_szCols)){
+        throw std::invalid_argument("[Error] getChar arg out of range");
+    }
+    return m_szDdram[getRowAddress(szRow, szCol)];
+}
+
+//---------------------------------------------------
+/**
+  * getText : get a displayed row
+  *
+  * @param szRow is the row from 0
+  * @param pText receives the row and a terminating 0, it must hold szCols + 1 characters
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::getText(unsigned char szRow, char* pText){
+    unsigned char szCol;
+
+    for(szCol = 0; szCol < m_szCols; szCol++){
+        pText[szCol] = getChar(szRow, szCol);
+    }
+    pText[m_szCols] = 0;
+}
+
+//---------------------------------------------------
+/**
+  * getDdram :
+  *
+  * @param szAddres is the DDRAM addres
+  * @return the content of the display RAM
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::getDdram(unsigned char szAddres){
+    if(szAddres >= K_LCD_SIM_DDRAM_SIZE){
+        throw std::invalid_argument("[Error] getDdram arg out of range");
+    }
+    return m_szDdram[szAddres];
+}
+
+//---------------------------------------------------
+/**
+  * getCgram :
+  *
+  * @param szAddres is the CGRAM addres
+  * @return the content of the character generator RAM
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::getCgram(unsigned char szAddres){
+    if(szAddres >= K_LCD_SIM_CGRAM_SIZE){
+        throw std::invalid_argument("[Error] getCgram arg out of range");
+    }
+    return m_szCgram[szAddres];
+}
+
+//---------------------------------------------------
+/**
+  * resetStats : set the counters to 0
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::resetStats(){
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_port.resetStats();
+}
+
+//---------------------------------------------------
+/**
+  * portChanged : the backpack was written
+  *
+  * @param nPort is the port number, unused
+  * @param szLatch is the new latch of the expander
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::portChanged(unsigned int, unsigned char szLatch, unsigned long long nTime){
+    unsigned char szOld = m_szPort;
+
+    m_szPort = szLatch;
+    // Rising edge of EN
+    if((0 == (szOld & K_LCD_EN_MASK)) && (0 != (m_szPort & K_LCD_EN_MASK))){
+        if((0 != m_nEnRise) && (nTime - m_nEnRise < K_LCD_SIM_MIN_EN_CYCLE)){
+            m_stats.nPulseViolations++;
+        }
+        m_nEnRise = nTime;
+    }
+    // Falling edge of EN
+    if((0 != (szOld & K_LCD_EN_MASK)) && (0 == (m_szPort & K_LCD_EN_MASK))){
+        if(nTime - m_nEnRise < K_LCD_SIM_MIN_EN_PULSE){
+            m_stats.nPulseViolations++;
+        }
+        // RS, R/W and the data are the ones of the pulse
+        strobe(nTime);
+    }
+}
+
+//---------------------------------------------------
+/**
+  * drivePort : levels put on D4-D7 by the controller
+  *
+  * @param nPort is the port number, unused
+  * @param szDriven receives the driven pins
+  * @param nTime is the virtual time in ns
+  * @return the levels of the driven pins
+  *
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::drivePort(unsigned int, unsigned char& szDriven, unsigned long long nTime){
+    unsigned char szValue;
+
+    szDriven = 0;
+    if((0 == (m_szPort & K_LCD_EN_MASK)) || (0 == (m_szPort & K_LCD_RW_MASK))){
+        return 0xFF;
+    }
+    if(0 != (m_szPort & K_LCD_RS_MASK)){
+        szValue = readData();
+    }else{
+        // BF AC6 AC5 AC4 AC3 AC2 AC1 AC0
+        szValue = m_szAddressCounter & 0x7F;
+        if(nTime < m_nBusyUntil){
+            szValue |= K_LCD_SIM_BUSY_FLAG;
+        }
+    }
+    szDriven = K_LCD_SIM_DATA_MASK;
+    // In 4 bits mode the low nibble comes with the second pulse
+    if((false == m_is8Bit) && (true == m_isLowNibble)){
+        return (szValue << 4) & K_LCD_SIM_DATA_MASK;
+    }
+    return szValue & K_LCD_SIM_DATA_MASK;
+}
+
+//************* PRIVATE SECTION *************************
+
+//---------------------------------------------------
+/**
+  * strobe : falling edge of EN
+  *
+  * @param nTime is the virtual time in ns
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::strobe(unsigned long long nTime){
+    bool isData = (0 != (m_szPort & K_LCD_RS_MASK));
+    bool isRead = (0 != (m_szPort & K_LCD_RW_MASK));
+    unsigned char szByte;
+    unsigned int nExecTime;
+
+    m_stats.nEnPulses++;
+    // The busy flag can be read during an instruction
+    if((true == isRead) && (false == isData)){
+        m_isLowNibble = (false == m_is8Bit) && (false == m_isLowNibble);
+        return;
+    }
+    // A nibble coming during an instruction makes the whole byte lost
+    if(nTime < m_nBusyUntil){
+        m_isNibbleLate = true;
+    }
+    if(false == m_is8Bit){
+        if(false == m_isLowNibble){
+            m_szHighNibble  = m_szPort & K_LCD_SIM_DATA_MASK;
+            m_isLowNibble   = true;
+            return;
+        }
+        m_isLowNibble = false;
+        szByte = m_szHighNibble | ((m_szPort & K_LCD_SIM_DATA_MASK) >> 4);
+    }else{
+        // D0-D3 are grounded
+        szByte = m_szPort & K_LCD_SIM_DATA_MASK;
+    }
+    if(true == m_isNibbleLate){
+        m_isNibbleLate = false;
+        m_stats.nBusyViolations++;
+        return;
+    }
+
+    if(true == isRead){
+        m_stats.nReads++;
+        moveAddress(m_isIncrement);
+        nExecTime = K_LCD_SIM_DATA_TIME;
+    }else if(true == isData){
+        m_stats.nDataWrites++;
+        writeData(szByte);
+        nExecTime = K_LCD_SIM_DATA_TIME;
+    }else{
+        m_stats.nCommands++;
+        nExecTime = execute(szByte);
+    }
+    m_nBusyUntil = nTime + nExecTime;
+    m_stats.nExecTime += nExecTime;
+}
+
+//---------------------------------------------------
+/**
+  * execute : run an instruction
+  *
+  * @param szData is the instruction
+  * @return the execution time in ns
+  *
+*/
+//---------------------------------------------------
+unsigned int
+LcdSimulator::execute(unsigned char szData){
+    unsigned int nLength = m_is2Lines ? K_LCD_SIM_2LINE_LENGTH : K_LCD_SIM_1LINE_LENGTH;
+
+    if(0 != (szData & K_LCD_SETDDRAMADDR)){
+        m_szAddressCounter  = szData & 0x7F;
+        m_isCgram           = false;
+        m_stats.nAddresses++;
+    }else if(0 != (szData & K_LCD_SETCGRAMADDR)){
+        m_szAddressCounter  = szData & 0x3F;
+        m_isCgram           = true;
+        m_stats.nAddresses++;
+    }else if(0 != (szData & K_LCD_FUNCTIONSET)){
+        m_is8Bit            = (0 != (szData & K_LCD_8BITMODE));
+        m_is2Lines          = (0 != (szData & K_LCD_2LINE));
+        m_isLowNibble       = false;
+    }else if(0 != (szData & K_LCD_CURSORSHIFT)){
+        m_stats.nShifts++;
+        if(0 != (szData & K_LCD_DISPLAYMOVE)){
+            // Moving the display to the right shows the characters on the left
+            m_szShift = (m_szShift + ((0 != (szData & K_LCD_MOVERIGHT)) ? nLength - 1 : 1)) % nLength;
+        }else{
+            moveAddress(0 != (szData & K_LCD_MOVERIGHT));
+        }
+    }else if(0 != (szData & K_LCD_DISPLAYCONTROL)){
+        m_isDisplayOn       = (0 != (szData & K_LCD_DISPLAYON));
+        m_isCursorOn        = (0 != (szData & K_LCD_CURSORON));
+        m_isBlinkOn         = (0 != (szData & K_LCD_BLINKON));
+    }else if(0 != (szData & K_LCD_ENTRYMODESET)){
+        m_isIncrement       = (0 != (szData & K_LCD_ENTRYRIGHT));
+        m_isShiftOnWrite    = (0 != (szData & K_LCD_ENTRYSHIFTINCREMENT));
+    }else if(0 != (szData & K_LCD_RETURNHOME)){
+        m_szAddressCounter  = 0;
+        m_isCgram           = false;
+        m_szShift           = 0;
+        m_stats.nHomes++;
+        return K_LCD_SIM_CLEAR_TIME;
+    }else if(0 != (szData & K_LCD_CLEARDISPLAY)){
+        memset(m_szDdram, ' ', sizeof(m_szDdram));
+        m_szAddressCounter  = 0;
+        m_isCgram           = false;
+        m_szShift           = 0;
+        m_isIncrement       = true;
+        m_stats.nClears++;
+        return K_LCD_SIM_CLEAR_TIME;
+    }
+    return K_LCD_SIM_COMMAND_TIME;
+}
+
+//---------------------------------------------------
+/**
+  * writeData : write a byte at the addres counter
+  *
+  * @param szData is the data
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::writeData(unsigned char szData){
+    unsigned int nLength = m_is2Lines ? K_LCD_SIM_2LINE_LENGTH : K_LCD_SIM_1LINE_LENGTH;
+
+    if(true == m_isCgram){
+        m_szCgram[m_szAddressCounter & (K_LCD_SIM_CGRAM_SIZE - 1)] = szData;
+    }else if(m_szAddressCounter < K_LCD_SIM_DDRAM_SIZE){
+        m_szDdram[m_szAddressCounter] = szData;
+    }
+    moveAddress(m_isIncrement);
+    // The display follows the cursor
+    if((true == m_isShiftOnWrite) && (false == m_isCgram)){
+        m_szShift = (m_szShift + (m_isIncrement ? 1 : nLength - 1)) % nLength;
+    }
+}
+
+//---------------------------------------------------
+/**
+  * readData :
+  *
+  * @return the byte at the addres counter
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::readData(){
+    if(true == m_isCgram){
+        return m_szCgram[m_szAddressCounter & (K_LCD_SIM_CGRAM_SIZE - 1)];
+    }
+    if(m_szAddressCounter < K_LCD_SIM_DDRAM_SIZE){
+        return m_szDdram[m_szAddressCounter];
+    }
+    return ' ';
+}
+
+//---------------------------------------------------
+/**
+  * moveAddress : move the addres counter by one
+  *
+  * @param isRight if true, the counter is incremented
+  *
+*/
+//---------------------------------------------------
+void
+LcdSimulator::moveAddress(bool isRight){
+    unsigned char szLast;
+
+    if(true == m_isCgram){
+        m_szAddressCounter = (m_szAddressCounter + (isRight ? 1 : K_LCD_SIM_CGRAM_SIZE - 1)) % K_LCD_SIM_CGRAM_SIZE;
+        return;
+    }
+    if(false == m_is2Lines){
+        m_szAddressCounter = (m_szAddressCounter + (isRight ? 1 : K_LCD_SIM_1LINE_LENGTH - 1)) % K_LCD_SIM_1LINE_LENGTH;
+        return;
+    }
+    // In 2 lines mode the end of a line goes on with the other one
+    szLast = K_LCD_SIM_LINE2_ADDRES + K_LCD_SIM_2LINE_LENGTH - 1;
+    if(true == isRight){
+        if(K_LCD_SIM_2LINE_LENGTH - 1 == m_szAddressCounter){
+            m_szAddressCounter = K_LCD_SIM_LINE2_ADDRES;
+        }else if(szLast == m_szAddressCounter){
+            m_szAddressCounter = 0;
+        }else{
+            m_szAddressCounter++;
+        }
+    }else{
+        if(0 == m_szAddressCounter){
+            m_szAddressCounter = szLast;
+        }else if(K_LCD_SIM_LINE2_ADDRES == m_szAddressCounter){
+            m_szAddressCounter = K_LCD_SIM_2LINE_LENGTH - 1;
+        }else{
+            m_szAddressCounter--;
+        }
+    }
+}
+
+//---------------------------------------------------
+/**
+  * getRowAddress : DDRAM addres of a position of the panel
+  *
+  * @param szRow is the row from 0
+  * @param szCol is the column from 0
+  * @return the addres, display shift applied
+*/
+//---------------------------------------------------
+unsigned char
+LcdSimulator::getRowAddress(unsigned char szRow, unsigned char szCol){
+    if(false == m_is2Lines){
+        return (szRow * m_szCols + szCol + m_szShift) % K_LCD_SIM_1LINE_LENGTH;
+    }
+    // Rows 3 and 4 of a 4 rows panel are the ends of the 2 lines of the controller
+    return (szRow % 2) * K_LCD_SIM_LINE2_ADDRES
+           + ((szRow / 2) * m_szCols + szCol + m_szShift) % K_LCD_SIM_2LINE_LENGTH;
+}
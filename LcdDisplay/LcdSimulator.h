@@ -0,0 +1,323 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: LcdSimulator.h
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#pragma once
+
+#include "../I2cBus/SimulatedBus.h"
+#include "../I2cBus/Pcf8574Simulator.h"
+#include "LcdDisplay.h"
+
+// Execution times of the HD44780 at 270 kHz, in ns
+const unsigned int  K_LCD_SIM_CLEAR_TIME            = 1520000;
+const unsigned int  K_LCD_SIM_COMMAND_TIME          = 37000;
+// A data write also updates the address counter
+const unsigned int  K_LCD_SIM_DATA_TIME             = 41000;
+// Minimum width of the EN pulse and of the EN cycle, in ns
+const unsigned int  K_LCD_SIM_MIN_EN_PULSE          = 230;
+const unsigned int  K_LCD_SIM_MIN_EN_CYCLE          = 500;
+
+// Display and character generator RAM, the DDRAM addresses go up to 0x67 in 2 lines mode
+const unsigned int  K_LCD_SIM_DDRAM_SIZE            = 0x68;
+const unsigned int  K_LCD_SIM_CGRAM_SIZE            = 0x40;
+// Characters of a line of the controller in 1 and 2 lines mode
+const unsigned int  K_LCD_SIM_1LINE_LENGTH          = 80;
+const unsigned int  K_LCD_SIM_2LINE_LENGTH          = 40;
+// DDRAM addres of the second line in 2 lines mode
+const unsigned char K_LCD_SIM_LINE2_ADDRES          = 0x40;
+// D4-D7 are wired to the high nibble of the expander
+const unsigned char K_LCD_SIM_DATA_MASK             = 0xF0;
+// Busy flag of the status
+const unsigned char K_LCD_SIM_BUSY_FLAG             = 0x80;
+
+// Protocol events seen by the controller
+struct LcdSimStats{
+    // Falling edges of EN
+    unsigned long long nEnPulses;
+    unsigned long long nCommands;
+    unsigned long long nClears;
+    unsigned long long nHomes;
+    unsigned long long nShifts;
+    unsigned long long nAddresses;
+    unsigned long long nDataWrites;
+    unsigned long long nReads;
+    // Instructions dropped because a nibble came while the controller was busy
+    unsigned long long nBusyViolations;
+    // EN pulses or cycles shorter than the minimum
+    unsigned long long nPulseViolations;
+    // Sum of the execution times, in ns
+    unsigned long long nExecTime;
+};
+
+class LcdSimulator : public Pcf8574Peripheral{
+    public:
+        //---------------------------------------------------
+        /**
+          * Constructor
+          * @param szCols is the number of columns of the panel
+          * @param szRows is the number of rows of the panel, 1, 2 or 4
+          *
+          * A PCF8574 backpack drives the HD44780: RS, R/W, EN and the backlight
+          * on P0-P3, D4-D7 on P4-P7, D0-D3 are grounded
+        */
+        //---------------------------------------------------
+        LcdSimulator(unsigned char szCols = K_LCD_MAX_CHAR_PER_LINE, unsigned char szRows = 4);
+
+        //---------------------------------------------------
+        /**
+          * Destructor
+        */
+        //---------------------------------------------------
+        virtual ~LcdSimulator();
+
+        //---------------------------------------------------
+        /**
+          * attach : connect the backpack to a bus
+          *
+          * @param bus is the simulated bus
+          * @param szAddres is the I2C addres of the backpack
+          *
+        */
+        //---------------------------------------------------
+        void attach(SimulatedBus& bus, unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * getChar : get a displayed character
+          *
+          * @param szRow is the row from 0
+          * @param szCol is the column from 0
+          * @return the character code, display shift applied
+        */
+        //---------------------------------------------------
+        unsigned char getChar(unsigned char szRow, unsigned char szCol);
+
+        //---------------------------------------------------
+        /**
+          * getText : get a displayed row
+          *
+          * @param szRow is the row from 0
+          * @param pText receives the row and a terminating 0, it must hold szCols + 1 characters
+          *
+        */
+        //---------------------------------------------------
+        void getText(unsigned char szRow, char* pText);
+
+        //---------------------------------------------------
+        /**
+          * getDdram :
+          *
+          * @param szAddres is the DDRAM addres
+          * @return the content of the display RAM
+        */
+        //---------------------------------------------------
+        unsigned char getDdram(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * getCgram :
+          *
+          * @param szAddres is the CGRAM addres
+          * @return the content of the character generator RAM
+        */
+        //---------------------------------------------------
+        unsigned char getCgram(unsigned char szAddres);
+
+        //---------------------------------------------------
+        /**
+          * getAddressCounter :
+          *
+          * @return the addres counter, in CGRAM if isCgramAddres() is true
+        */
+        //---------------------------------------------------
+        inline unsigned char getAddressCounter(){ return m_szAddressCounter;}
+
+        //---------------------------------------------------
+        /**
+          * isCgramAddres :
+          *
+          * @return true if the addres counter points to the CGRAM
+        */
+        //---------------------------------------------------
+        inline bool isCgramAddres(){ return m_isCgram;}
+
+        //---------------------------------------------------
+        /**
+          * getDisplayShift :
+          *
+          * @return the number of characters the display is shifted to the left
+        */
+        //---------------------------------------------------
+        inline unsigned char getDisplayShift(){ return m_szShift;}
+
+        //---------------------------------------------------
+        /**
+          * isDisplayOn / isCursorOn / isBlinkOn / isBacklightOn / is4BitMode :
+          *
+          * @return the state of the controller
+        */
+        //---------------------------------------------------
+        inline bool isDisplayOn(){ return m_isDisplayOn;}
+        inline bool isCursorOn(){ return m_isCursorOn;}
+        inline bool isBlinkOn(){ return m_isBlinkOn;}
+        inline bool isBacklightOn(){ return (0 != (m_szPort & K_LCD_BACKLIGHT));}
+        inline bool is4BitMode(){ return (false == m_is8Bit);}
+
+        //---------------------------------------------------
+        /**
+          * getReadyTime :
+          *
+          * @return the virtual time in ns when the last instruction ends
+        */
+        //---------------------------------------------------
+        inline unsigned long long getReadyTime(){ return m_nBusyUntil;}
+
+        //---------------------------------------------------
+        /**
+          * getStats :
+          *
+          * @return the protocol events seen by the controller
+        */
+        //---------------------------------------------------
+        inline const LcdSimStats& getStats(){ return m_stats;}
+
+        //---------------------------------------------------
+        /**
+          * resetStats : set the counters to 0
+          *
+        */
+        //---------------------------------------------------
+        void resetStats();
+
+        //---------------------------------------------------
+        /**
+          * portChanged : the backpack was written
+          *
+          * @param nPort is the port number, unused
+          * @param szLatch is the new latch of the expander
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        virtual void portChanged(unsigned int nPort, unsigned char szLatch, unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * drivePort : levels put on D4-D7 by the controller
+          *
+          * @param nPort is the port number, unused
+          * @param szDriven receives the driven pins
+          * @param nTime is the virtual time in ns
+          * @return the levels of the driven pins
+          *
+        */
+        //---------------------------------------------------
+        virtual unsigned char drivePort(unsigned int nPort, unsigned char& szDriven, unsigned long long nTime);
+
+    private:
+        // Backpack
+        Pcf8574Simulator m_port;
+        unsigned char m_szPort;
+
+        // Geometry of the panel
+        unsigned char m_szCols;
+        unsigned char m_szRows;
+
+        // Memories
+        unsigned char m_szDdram[K_LCD_SIM_DDRAM_SIZE];
+        unsigned char m_szCgram[K_LCD_SIM_CGRAM_SIZE];
+
+        // Registers
+        unsigned char m_szAddressCounter;
+        bool m_isCgram;
+        unsigned char m_szShift;
+        bool m_is8Bit;
+        bool m_is2Lines;
+        bool m_isIncrement;
+        bool m_isShiftOnWrite;
+        bool m_isDisplayOn;
+        bool m_isCursorOn;
+        bool m_isBlinkOn;
+
+        // 4 bits transfers : true when the high nibble was received
+        bool m_isLowNibble;
+        unsigned char m_szHighNibble;
+        bool m_isNibbleLate;
+
+        // Timing
+        unsigned long long m_nBusyUntil;
+        unsigned long long m_nEnRise;
+
+        // Counters
+        LcdSimStats m_stats;
+
+        //---------------------------------------------------
+        /**
+          * strobe : falling edge of EN
+          *
+          * @param nTime is the virtual time in ns
+          *
+        */
+        //---------------------------------------------------
+        void strobe(unsigned long long nTime);
+
+        //---------------------------------------------------
+        /**
+          * execute : run an instruction
+          *
+          * @param szData is the instruction
+          * @return the execution time in ns
+          *
+        */
+        //---------------------------------------------------
+        unsigned int execute(unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * writeData : write a byte at the addres counter
+          *
+          * @param szData is the data
+          *
+        */
+        //---------------------------------------------------
+        void writeData(unsigned char szData);
+
+        //---------------------------------------------------
+        /**
+          * readData :
+          *
+          * @return the byte at the addres counter
+        */
+        //---------------------------------------------------
+        unsigned char readData();
+
+        //---------------------------------------------------
+        /**
+          * moveAddress : move the addres counter by one
+          *
+          * @param isRight if true, the counter is incremented
+          *
+        */
+        //---------------------------------------------------
+        void moveAddress(bool isRight);
+
+        //---------------------------------------------------
+        /**
+          * getRowAddress : DDRAM addres of a position of the panel
+          *
+          * @param szRow is the row from 0
+          * @param szCol is the column from 0
+          * @return the addres, display shift applied
+        */
+        //---------------------------------------------------
+        unsigned char getRowAddress(unsigned char szRow, unsigned char szCol);
+};
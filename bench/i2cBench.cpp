@@ -0,0 +1,486 @@
+/*--------------------------------------------------------
+ *
+ *--------------------------------------------------------
+ * Project    : I2C
+ * Sub-Project: i2cBench.cpp
+ *
+ * This code is distributed under the GNU Public License
+ * which can be found at http://www.gnu.org/licenses/gpl.txt
+ *
+ * Author Patrick DELVENNE and ProcessUX 2018
+ *--------------------------------------------------------
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../I2cBus/SimulatedBus.h"
+#include "../KS0108Display/KS0108Display.h"
+#include "../KS0108Display/KS0108Simulator.h"
+#include "../KS0108Display/KS0108Renderer.h"
+#include "../LcdDisplay/LcdDisplay.h"
+#include "../LcdDisplay/LcdSimulator.h"
+#include "../Ds1621/Ds1621.h"
+#include "../Ds1621/Ds1621Simulator.h"
+#include "../KS0108Display/wintzx.h"
+
+// Devices
+const unsigned char K_I2C_KS0108_DATA_ADDRES    = 0x20;
+const unsigned char K_I2C_KS0108_CMD_ADDRES     = 0x21;
+const unsigned char K_I2C_LCD_ADDRES            = 0x27;
+const unsigned char K_I2C_DS1621_ADDRES         = 0x48;
+// The 3 address pins of the DS1621 give 8 sensors on a bus
+const unsigned int  K_BENCH_NB_DS1621           = 8;
+// Temperature of the sensors, in C
+const float         K_BENCH_DS1621_TEMP         = 23.5;
+// Time of the first run of the LCD dashboard, in s
+const unsigned int  K_BENCH_DASHBOARD_START     = 12 * 3600 + 34 * 60 + 56;
+
+// Lines of the fan, queued at once they never fill the renderer queue
+const unsigned char K_BENCH_NB_LINES            = K_KS0108_SCREEN_WIDTH / 16;
+
+// Runs of each benchmark
+const unsigned int  K_BENCH_DEFAULT_ITERATIONS  = 20;
+// SCL frequencies of the standard and fast modes
+const unsigned int  K_BENCH_CLOCKS[]            = {100000, 400000};
+const unsigned int  K_BENCH_NB_CLOCKS           = sizeof(K_BENCH_CLOCKS) / sizeof(K_BENCH_CLOCKS[0]);
+
+// Drivers and devices of a run
+struct I2cBenchContext{
+    SimulatedBus* pBus;
+    KS0108Display* pKS0108;
+    // Created by the renderer benchmarks only, it owns the KS0108 until deleted
+    KS0108Renderer* pRenderer;
+    LcdDisplay* pLcd;
+    Ds1621* pDs1621[K_BENCH_NB_DS1621];
+    unsigned int nIteration;
+    // Time spent in the renderer calls and their number
+    unsigned long long nEnqueueTime;
+    unsigned long long nEnqueues;
+};
+
+// A benchmark : the setup is not measured
+struct I2cBenchCase{
+    const char* pName;
+    // true if the KS0108 image is saved or checked at the end
+    bool isImaged;
+    void (*pSetup)(I2cBenchContext& context);
+    void (*pRun)(I2cBenchContext& context);
+};
+
+// Per operation results
+struct I2cBenchResult{
+    double dWallTime;
+    double dTransfers;
+    double dMessages;
+    double dBytesWritten;
+    double dBytesRead;
+    double dBusTime;
+    double dVirtualTime;
+    // EN pulses and operations lost because a controller was busy or NVB was set
+    double dEnPulses;
+    double dLostOperations;
+    // Age of the read temperatures, from the end of their conversion
+    double dSampleAge;
+    // Time of a renderer call, the panel is updated by its worker thread
+    double dEnqueueTime;
+};
+
+//---------------------------------------------------
+/**
+  * getWallTime :
+  *
+  * @return the monotonic time in ns
+*/
+//---------------------------------------------------
+static unsigned long long getWallTime(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//---------------------------------------------------
+static void noSetup(I2cBenchContext&){
+}
+
+//---------------------------------------------------
+static void fillScreen(I2cBenchContext& context){
+    context.pKS0108->fillRect(0, 0, K_KS0108_SCREEN_WIDTH, K_KS0108_SCREEN_HEIGHT);
+}
+
+//---------------------------------------------------
+static void clearScreen(I2cBenchContext& context){
+    context.pKS0108->cls();
+}
+
+//---------------------------------------------------
+static void startRenderer(I2cBenchContext& context){
+    if(NULL == context.pRenderer){
+        context.pRenderer = new KS0108Renderer(*context.pKS0108);
+    }
+    context.pRenderer->cls();
+    context.pRenderer->waitIdle();
+}
+
+//---------------------------------------------------
+static void setLcdFixedTiming(I2cBenchContext& context){
+    context.pLcd->setTimingMode(K_LCD_TIMING_FIXED);
+}
+
+//---------------------------------------------------
+static void setLcdZeroSleep(I2cBenchContext& context){
+    context.pLcd->setTimingMode(K_LCD_TIMING_ZERO_SLEEP);
+}
+
+//---------------------------------------------------
+static void drawLcdDashboard(I2cBenchContext& context){
+    context.pLcd->setRetainedMode(true);
+    if(0 == context.nIteration){
+        context.pLcd->displayStringAtPosition("Time", 1);
+        context.pLcd->displayStringAtPosition("Temp", 2);
+        context.pLcd->displayStringAtPosition("Dashboard", 4);
+        context.pLcd->flush();
+    }
+}
+
+//---------------------------------------------------
+static void runKS0108Cls(I2cBenchContext& context){
+    context.pKS0108->cls();
+}
+
+//---------------------------------------------------
+static void runKS0108Text(I2cBenchContext& context){
+    unsigned char szLine;
+    char szText[K_KS0108_MAX_TXT_COL + 1];
+
+    // A different character on each run, so nothing is skipped
+    memset(szText, 'A' + context.nIteration % 26, K_KS0108_MAX_TXT_COL);
+    szText[K_KS0108_MAX_TXT_COL] = 0;
+    for(szLine = 0; szLine < K_KS0108_PAGES_PER_CTRL; szLine++){
+        context.pKS0108->displayStringAtPosition(szText, szLine);
+    }
+}
+
+//---------------------------------------------------
+static void runKS0108Lines(I2cBenchContext& context){
+    unsigned char szX;
+
+    // A fan of lines over the whole screen
+    for(szX = 0; szX < K_KS0108_SCREEN_WIDTH; szX += 16){
+        context.pKS0108->drawLine(szX, 0, K_KS0108_SCREEN_WIDTH - 1 - szX, K_KS0108_SCREEN_HEIGHT - 1);
+    }
+}
+
+//---------------------------------------------------
+static void runKS0108RenderLines(I2cBenchContext& context){
+    unsigned char szX;
+    unsigned long long nStart;
+
+    // The same fan as ks0108_lines, only the calls are timed
+    for(szX = 0; szX < K_KS0108_SCREEN_WIDTH; szX += 16){
+        nStart = getWallTime();
+        context.pRenderer->drawLine(szX, 0, K_KS0108_SCREEN_WIDTH - 1 - szX, K_KS0108_SCREEN_HEIGHT - 1);
+        context.nEnqueueTime += getWallTime() - nStart;
+    }
+    context.nEnqueues += K_BENCH_NB_LINES;
+    // The bus is counted once the worker is done
+    context.pRenderer->waitIdle();
+}
+
+//---------------------------------------------------
+static void runKS0108Blit(I2cBenchContext& context){
+    // XOR changes every byte the logo covers on each run
+    context.pKS0108->blit(ours, K_KS0108_SCREEN_WIDTH, 0, 0, K_KS0108_SCREEN_WIDTH, K_KS0108_SCREEN_HEIGHT, K_KS0108_ROP_XOR);
+}
+
+//---------------------------------------------------
+static void runLcdText(I2cBenchContext& context){
+    char szLine;
+    char szText[K_LCD_MAX_CHAR_PER_LINE + 1];
+
+    memset(szText, 'A' + context.nIteration % 26, K_LCD_MAX_CHAR_PER_LINE);
+    szText[K_LCD_MAX_CHAR_PER_LINE] = 0;
+    for(szLine = 1; szLine <= 4; szLine++){
+        context.pLcd->displayStringAtPosition(szText, szLine);
+    }
+}
+
+//---------------------------------------------------
+static void runLcdClsText(I2cBenchContext& context){
+    // The address command comes right after the clear, it is lost if the clear is not waited for
+    context.pLcd->cls();
+    context.pLcd->displayStringAtPosition("HELLO", 2, 5);
+}
+
+//---------------------------------------------------
+static void runLcdDashboard(I2cBenchContext& context){
+    char szText[K_LCD_MAX_CHAR_PER_LINE + 1];
+    unsigned int nSeconds = K_BENCH_DASHBOARD_START + context.nIteration;
+
+    // A 1 Hz clock : usually only the last digit changes
+    snprintf(szText, sizeof(szText), "%02u:%02u:%02u", nSeconds / 3600 % 24, nSeconds / 60 % 60, nSeconds % 60);
+    context.pLcd->displayStringAtPosition(szText, 1, 6);
+    snprintf(szText, sizeof(szText), "%.1f C", K_BENCH_DS1621_TEMP);
+    context.pLcd->displayStringAtPosition(szText, 2, 6);
+    context.pLcd->flush();
+}
+
+//---------------------------------------------------
+static void runDs1621HRTemp(I2cBenchContext& context){
+    context.pDs1621[0]->getHRTemp();
+}
+
+//---------------------------------------------------
+static void runDs1621LRTemps(I2cBenchContext& context){
+    unsigned int nSensor;
+
+    // One sample of each sensor of the bus
+    for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+        context.pDs1621[nSensor]->getLRTemp();
+    }
+}
+
+const I2cBenchCase K_BENCH_CASES[] = {
+    {"ks0108_cls",      true,   fillScreen,     runKS0108Cls},
+    {"ks0108_text",     true,   noSetup,        runKS0108Text},
+    {"ks0108_lines",    true,   clearScreen,    runKS0108Lines},
+    {"ks0108_blit",     true,   noSetup,        runKS0108Blit},
+    {"ks0108_render_lines", true, startRenderer, runKS0108RenderLines},
+    {"lcd_text",        false,  noSetup,        runLcdText},
+    {"lcd_text_fixed",  false,  setLcdFixedTiming, runLcdText},
+    {"lcd_text_zero_sleep", false, setLcdZeroSleep, runLcdText},
+    {"lcd_cls_text",    false,  noSetup,        runLcdClsText},
+    {"lcd_cls_text_fixed", false, setLcdFixedTiming, runLcdClsText},
+    {"lcd_dashboard",   false,  drawLcdDashboard, runLcdDashboard},
+    {"ds1621_hr_temp",  false,  noSetup,        runDs1621HRTemp},
+    {"ds1621_lr_temp_x8", false, noSetup,       runDs1621LRTemps},
+};
+const unsigned int  K_BENCH_NB_CASES            = sizeof(K_BENCH_CASES) / sizeof(K_BENCH_CASES[0]);
+
+//---------------------------------------------------
+/**
+  * runCase : run a benchmark on a new bus
+  *
+  * @param benchCase is the benchmark
+  * @param nClock is the SCL frequency in Hz
+  * @param nIterations is the number of runs
+  * @param pImageDir is where the KS0108 image is saved, NULL if not saved
+  * @param pGoldenDir is where the golden KS0108 image is, NULL if not checked
+  * @param result receives the per operation results
+  * @return false if the KS0108 image is not the golden one
+  *
+*/
+//---------------------------------------------------
+static bool runCase(const I2cBenchCase& benchCase, unsigned int nClock, unsigned int nIterations,
+                    const char* pImageDir, const char* pGoldenDir, I2cBenchResult& result){
+    SimulatedBus bus(nClock);
+    KS0108Simulator panel;
+    LcdSimulator lcdPanel;
+    Ds1621Simulator sensors[K_BENCH_NB_DS1621];
+    I2cBenchContext context;
+    I2cSimStats before;
+    KS0108SimStats panelBefore;
+    LcdSimStats lcdBefore;
+    Ds1621SimStats sensorsBefore[K_BENCH_NB_DS1621];
+    unsigned long long nWallTime = 0, nVirtualTime = 0, nStart, nTime;
+    unsigned long long nSampleAge = 0, nTempReads = 0;
+    unsigned int nSensor;
+    char szFileName[256];
+    bool isMatching = true;
+
+    panel.attach(bus, K_I2C_KS0108_DATA_ADDRES, K_I2C_KS0108_CMD_ADDRES);
+    lcdPanel.attach(bus, K_I2C_LCD_ADDRES);
+    for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+        sensors[nSensor].setTemperature(K_BENCH_DS1621_TEMP);
+        bus.attach(K_I2C_DS1621_ADDRES + nSensor, &sensors[nSensor]);
+    }
+    bus.init();
+
+    KS0108Display ks0108(bus, K_I2C_KS0108_DATA_ADDRES, K_I2C_KS0108_CMD_ADDRES);
+    LcdDisplay lcd(bus, K_I2C_LCD_ADDRES);
+    ks0108.init();
+    lcd.init();
+    for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+        context.pDs1621[nSensor] = new Ds1621(bus, K_I2C_DS1621_ADDRES + nSensor);
+        context.pDs1621[nSensor]->init();
+    }
+    context.pBus        = &bus;
+    context.pKS0108     = &ks0108;
+    context.pRenderer   = NULL;
+    context.pLcd        = &lcd;
+    context.nEnqueueTime = 0;
+    context.nEnqueues   = 0;
+
+    memset(&result, 0, sizeof(result));
+    for(context.nIteration = 0; context.nIteration < nIterations; context.nIteration++){
+        benchCase.pSetup(context);
+        before      = bus.getStats();
+        panelBefore = panel.getStats();
+        lcdBefore   = lcdPanel.getStats();
+        for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+            sensorsBefore[nSensor] = sensors[nSensor].getStats();
+        }
+        nTime       = bus.getTime();
+        nStart  = getWallTime();
+        benchCase.pRun(context);
+        nWallTime       += getWallTime() - nStart;
+        nVirtualTime    += bus.getTime() - nTime;
+        result.dTransfers       += bus.getStats().nTransfers - before.nTransfers;
+        result.dMessages        += bus.getStats().nMessages - before.nMessages;
+        result.dBytesWritten    += bus.getStats().nBytesWritten - before.nBytesWritten;
+        result.dBytesRead       += bus.getStats().nBytesRead - before.nBytesRead;
+        result.dBusTime         += bus.getStats().nBusTime - before.nBusTime;
+        result.dEnPulses        += panel.getStats().nEnPulses - panelBefore.nEnPulses
+                                   + lcdPanel.getStats().nEnPulses - lcdBefore.nEnPulses;
+        result.dLostOperations  += panel.getStats().nBusyViolations - panelBefore.nBusyViolations
+                                   + lcdPanel.getStats().nBusyViolations - lcdBefore.nBusyViolations;
+        for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+            result.dLostOperations  += sensors[nSensor].getStats().nEepromViolations - sensorsBefore[nSensor].nEepromViolations;
+            nSampleAge              += sensors[nSensor].getStats().nSampleAge - sensorsBefore[nSensor].nSampleAge;
+            nTempReads              += sensors[nSensor].getStats().nTempReads - sensorsBefore[nSensor].nTempReads;
+        }
+    }
+    // Gives the KS0108 back before its image is read
+    delete context.pRenderer;
+    for(nSensor = 0; nSensor < K_BENCH_NB_DS1621; nSensor++){
+        delete context.pDs1621[nSensor];
+    }
+    // Times in us
+    result.dWallTime        = nWallTime / 1000.0 / nIterations;
+    result.dVirtualTime     = nVirtualTime / 1000.0 / nIterations;
+    result.dBusTime         = result.dBusTime / 1000.0 / nIterations;
+    result.dTransfers       /= nIterations;
+    result.dMessages        /= nIterations;
+    result.dBytesWritten    /= nIterations;
+    result.dBytesRead       /= nIterations;
+    result.dEnPulses        /= nIterations;
+    result.dLostOperations  /= nIterations;
+    if(0 != nTempReads){
+        result.dSampleAge   = nSampleAge / 1000.0 / nTempReads;
+    }
+    if(0 != context.nEnqueues){
+        result.dEnqueueTime = context.nEnqueueTime / 1000.0 / context.nEnqueues;
+    }
+
+    if(true == benchCase.isImaged){
+        if(NULL != pImageDir){
+            snprintf(szFileName, sizeof(szFileName), "%s/%s.pbm", pImageDir, benchCase.pName);
+            panel.writePbm(szFileName);
+        }
+        if(NULL != pGoldenDir){
+            snprintf(szFileName, sizeof(szFileName), "%s/%s.pbm", pGoldenDir, benchCase.pName);
+            isMatching = panel.isMatchingPbm(szFileName);
+        }
+    }
+    return isMatching;
+}
+
+//---------------------------------------------------
+int main (int argc, char *argv[]){
+//---------------------------------------------------
+
+    int nRet;
+    bool isCsv = false;
+    unsigned int nIterations = K_BENCH_DEFAULT_ITERATIONS;
+    unsigned int nCase, nClock;
+    const char* pFilter = NULL;
+    const char* pImageDir = NULL;
+    const char* pGoldenDir = NULL;
+    bool isFirst = true;
+    bool isMatching = true;
+    I2cBenchResult result;
+
+    while ((nRet = getopt (argc, argv, "f:n:b:i:g:h")) != -1){
+        switch(nRet){
+            case 'f':
+                if(0 == strcmp(optarg, "csv")){
+                    isCsv = true;
+                }else if(0 != strcmp(optarg, "json")){
+                    fprintf(stderr,"Unknown format %s\n", optarg);
+                    return -1;
+                }
+            break;
+
+            case 'n':
+                nIterations = atoi(optarg);
+                if(0 == nIterations){
+                    fprintf(stderr,"The number of runs must be positive\n");
+                    return -1;
+                }
+            break;
+
+            case 'b':
+                pFilter = optarg;
+            break;
+
+            case 'i':
+                pImageDir = optarg;
+            break;
+
+            case 'g':
+                pGoldenDir = optarg;
+            break;
+
+            default:
+                fprintf(stderr, "Usage: i2cBench [options]\n"
+                                "Runs the drivers on a simulated bus at 100 kHz and 400 kHz.\n"
+                                "Options:\n"
+                                "  -f fmt     Output format, json (default) or csv.\n"
+                                "  -n n       Runs of each benchmark.\n"
+                                "  -b name    Only run the benchmarks whose name contains name.\n"
+                                "  -i dir     Save the final KS0108 image of each benchmark as dir/name.pbm.\n"
+                                "  -g dir     Check the final KS0108 images against the golden dir/name.pbm.\n"
+                                "All values are per operation, times are in us.\n"
+                       );
+                return ('h' == nRet) ? 0 : -1;
+        }
+    }
+
+    if(true == isCsv){
+        printf("bench,clock_hz,iterations,wall_us,transfers,messages,bytes_written,bytes_read,bus_us,virtual_us,en_pulses,lost_ops,sample_age_us,enqueue_us\n");
+    }else{
+        printf("[\n");
+    }
+    for(nCase = 0; nCase < K_BENCH_NB_CASES; nCase++){
+        if((NULL != pFilter) && (NULL == strstr(K_BENCH_CASES[nCase].pName, pFilter))){
+            continue;
+        }
+        for(nClock = 0; nClock < K_BENCH_NB_CLOCKS; nClock++){
+            try{
+                if(false == runCase(K_BENCH_CASES[nCase], K_BENCH_CLOCKS[nClock], nIterations, pImageDir, pGoldenDir, result)){
+                    fprintf(stderr,"[%s] image differs from the golden one at %u Hz\n", K_BENCH_CASES[nCase].pName, K_BENCH_CLOCKS[nClock]);
+                    isMatching = false;
+                }
+            }catch(std::exception const& e){
+                fprintf(stderr,"[%s] %s\n", K_BENCH_CASES[nCase].pName, e.what());
+                return -1;
+            }
+            if(true == isCsv){
+                printf("%s,%u,%u,%.3f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.2f,%.2f,%.3f,%.3f\n",
+                       K_BENCH_CASES[nCase].pName, K_BENCH_CLOCKS[nClock], nIterations, result.dWallTime,
+                       result.dTransfers, result.dMessages, result.dBytesWritten, result.dBytesRead,
+                       result.dBusTime, result.dVirtualTime, result.dEnPulses, result.dLostOperations, result.dSampleAge,
+                       result.dEnqueueTime);
+            }else{
+                printf("%s  {\"bench\": \"%s\", \"clock_hz\": %u, \"iterations\": %u, \"wall_us\": %.3f, "
+                       "\"transfers\": %.2f, \"messages\": %.2f, \"bytes_written\": %.2f, \"bytes_read\": %.2f, "
+                       "\"bus_us\": %.3f, \"virtual_us\": %.3f, \"en_pulses\": %.2f, \"lost_ops\": %.2f, \"sample_age_us\": %.3f, \"enqueue_us\": %.3f}",
+                       (true == isFirst) ? "" : ",\n",
+                       K_BENCH_CASES[nCase].pName, K_BENCH_CLOCKS[nClock], nIterations, result.dWallTime,
+                       result.dTransfers, result.dMessages, result.dBytesWritten, result.dBytesRead,
+                       result.dBusTime, result.dVirtualTime, result.dEnPulses, result.dLostOperations, result.dSampleAge,
+                       result.dEnqueueTime);
+            }
+            isFirst = false;
+        }
+    }
+    if(false == isCsv){
+        printf("%s]\n", (true == isFirst) ? "" : "\n");
+    }
+    return (true == isMatching) ? 0 : 1;
+}
@@ -25,10 +25,15 @@
 #include <unistd.h>
 
 #include <wiringPi.h>
-#include <wiringPiI2C.h>
 #include "LcdDisplay/LcdDisplay.h"
 #include "KS0108Display/KS0108Display.h"
+#include "KS0108Display/KS0108Console.h"
+#include "KS0108Display/KS0108Renderer.h"
 #include "Ds1621/Ds1621.h"
+#include "I2cBus/WiringPiBus.h"
+#include "I2cBus/I2cRdwrBus.h"
+#include "I2cBus/I2cTraceBus.h"
+#include "I2cBus/I2cProfiler.h"
 #include "KS0108Display/wintzx.h"
 
 // Devices
@@ -36,6 +41,19 @@ const unsigned char K_I2C_KS0108_DATA_ADDRES    = 0x20;
 const unsigned char K_I2C_KS0108_CMD_ADDRES     = 0x21;
 const unsigned char K_I2C_KS0108_MAX_CHAR       = 0xFF;
 
+//---------------------------------------------------
+/**
+  * getWallTime :
+  *
+  * @return the monotonic time in ns
+*/
+//---------------------------------------------------
+static unsigned long long getWallTime(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
 //---------------------------------------------------
 int main (int argc, char *argv[]){
 //---------------------------------------------------
@@ -48,12 +66,45 @@ int main (int argc, char *argv[]){
     int szFont=-1;
     int szStartLine=-1;
     char szLine[K_I2C_KS0108_MAX_CHAR];
-    wiringPiSetup();
-    KS0108Display *pDis = new KS0108Display(K_I2C_KS0108_DATA_ADDRES,K_I2C_KS0108_CMD_ADDRES);
+    ssize_t nRead;
+    unsigned long long nStart, nEnqueueTime;
+    const char* pOptions = "B:ptcx:y:X:Y:s:d:D:b:rlo:eu:TRh";
+    I2cBus *pBus = NULL;
+    I2cTraceBus *pTrace = NULL;
+    bool isProfiled = false;
+
+    // The bus must be known before the display is created
+    while ((nRet = getopt (argc, argv, pOptions)) != -1){
+        if(('B' == nRet) && (NULL == pBus)){
+            pBus = new I2cRdwrBus(atoi(optarg));
+        }
+        if('p' == nRet){
+            isProfiled = true;
+        }
+    }
+    optind = 1;
+
+    if(NULL == pBus){
+        wiringPiSetup();
+        pBus = new WiringPiBus();
+    }
+    pBus->init();
+    if(true == isProfiled){
+        // Every bus operation is counted in the display call doing it
+        pTrace = new I2cTraceBus(*pBus);
+        I2cProfiler::setEnabled(true);
+    }
+    KS0108Display *pDis = new KS0108Display((NULL != pTrace) ? *pTrace : *pBus,K_I2C_KS0108_DATA_ADDRES,K_I2C_KS0108_CMD_ADDRES);
     pDis->init();
     szLine[0]=0;
-    while ((nRet = getopt (argc, argv, "cx:y:X:Y:s:d:rlu:h")) != -1){
+    while ((nRet = getopt (argc, argv, pOptions)) != -1){
         switch(nRet){
+            case 't':
+                if(false == pDis->calibrateTiming()){
+                    fprintf(stderr,"Trusted timing not available, busy flag is polled\n");
+                }
+            break;
+
             case 'c':
                 pDis->cls();
             break;
@@ -96,6 +147,27 @@ int main (int argc, char *argv[]){
                 pDis->displayStringWithFontAtPosition(szLine,szFont,szX,szY);
             break;
 
+            case 'D':
+                szFont = atoi(optarg);
+                if((-1 == szX) || (-1 == szY)){
+                    fprintf(stderr,"You must set -x and -y\n");
+                    return -1;
+                }
+                if(0 == strlen(szLine)){
+                    fprintf(stderr,"You must set -s\n");
+                    return -1;
+                }
+                pDis->displayStringWithFontAtPixel(szLine,szFont,szY,szX);
+            break;
+
+            case 'b':
+                if((-1 == szX) || (-1 == szY)){
+                    fprintf(stderr,"You must set -x and -y\n");
+                    return -1;
+                }
+                pDis->blit(ours,K_KS0108_SCREEN_WIDTH,szY,szX,K_KS0108_SCREEN_WIDTH,K_KS0108_SCREEN_HEIGHT,atoi(optarg));
+            break;
+
             case 'r':
                 if((-1 == szX) || (-1 == szY) || (-1 == szdX) || (-1 == szdY)){
                     fprintf(stderr,"You must set -x, -y -X and -Y\n");
@@ -112,6 +184,49 @@ int main (int argc, char *argv[]){
                 pDis->drawLine(szY,szX,szdX,szdY);
             break;
 
+            case 'o':
+                if((-1 == szX) || (-1 == szY)){
+                    fprintf(stderr,"You must set -x and -y\n");
+                    return -1;
+                }
+                pDis->drawCircle(szY,szX,atoi(optarg));
+            break;
+
+            case 'e':
+                if((-1 == szX) || (-1 == szY) || (-1 == szdX) || (-1 == szdY)){
+                    fprintf(stderr,"You must set -x, -y -X and -Y\n");
+                    return -1;
+                }
+                pDis->drawEllipse(szY,szX,szdX,szdY);
+            break;
+
+            case 'T':
+                {
+                    // Tail the standard input on the screen
+                    KS0108Console console(*pDis);
+                    console.clear();
+                    while((nRead = read(STDIN_FILENO, szLine, sizeof(szLine))) > 0){
+                        console.write(szLine, nRead);
+                    }
+                    szLine[0] = 0;
+                }
+            break;
+
+            case 'R':
+                {
+                    // The calls only queue the drawings, the panel is updated by the worker thread
+                    KS0108Renderer renderer(*pDis);
+                    nStart = getWallTime();
+                    renderer.cls();
+                    renderer.drawRect(0, 0, K_KS0108_SCREEN_WIDTH, K_KS0108_SCREEN_HEIGHT);
+                    renderer.drawCircle(K_KS0108_SCREEN_WIDTH / 2, K_KS0108_SCREEN_HEIGHT / 2, K_KS0108_SCREEN_HEIGHT / 4);
+                    renderer.displayStringAtPosition((0 != strlen(szLine)) ? szLine : "KS0108Renderer", 0, 1);
+                    nEnqueueTime = getWallTime() - nStart;
+                    renderer.waitIdle();
+                    printf("4 calls queued in %llu ns, drawn in %llu ns\n", nEnqueueTime, getWallTime() - nStart);
+                }
+            break;
+
             case 'h':
                 // On affiche l'aide et on termine.
                 fprintf(stderr, "Usage: i2cTest [options] [function]\n"
@@ -119,9 +234,19 @@ int main (int argc, char *argv[]){
                                 "  -c         Clear screen.\n"
                                 "  -u n       Scroll text up to n lines.\n"
                                 "  -d n       Display string with selected font.\n"
+                                "  -D n       Display string with selected font at pixel (X,Y).\n"
+                                "  -b n       Draw the logo at (X,Y) with raster op n (0=copy 1=or 2=and 3=xor).\n"
                                 "  -r         Draw rectangle starting at (X,Y) to (X+DX),(Y+DY).\n"
                                 "  -l         Draw line starting at (X,Y) to (X+DX),(Y+DY).\n"
+                                "  -o n       Draw circle centered at (X,Y) with radius n.\n"
+                                "  -e         Draw ellipse centered at (X,Y) with radii DX and DY.\n"
+                                "  -T         Display the standard input as a scrolling console.\n"
+                                "  -R         Draw a frame, a circle and the string through the background renderer\n"
+                                "             and print the time of the calls.\n"
                                 "Options:\n"
+                                "  -B n       Use /dev/i2c-n with combined I2C_RDWR transfers.\n"
+                                "  -p         Profile the I2C operations of each call and print them at exit.\n"
+                                "  -t         Use trusted timing if the calibration succeeds.\n"
                                 "  -y n       Y position.\n"
                                 "  -x n       X position.\n"
                                 "  -dy n      Y delta position.\n"
@@ -133,4 +258,9 @@ int main (int argc, char *argv[]){
         }
     }
     delete(pDis);
+    if(NULL != pTrace){
+        I2cProfiler::dump(stdout);
+        delete(pTrace);
+    }
+    delete(pBus);
 }